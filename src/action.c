@@ -323,6 +323,12 @@ Note;
 static int defer_updates = 0;
 static int defer_needs_update = 0;
 
+/* BeginBatch() nesting depth and the AddRats() request postponed
+ * until the batch commits */
+static int batch_depth = 0;
+static enum { BATCH_RATS_NONE, BATCH_RATS_SELECTED, BATCH_RATS_ALL }
+  batch_rats = BATCH_RATS_NONE;
+
 static Cardinal polyIndex = 0;
 static bool saved_mode = false;
 #ifdef HAVE_LIBSTROKE
@@ -1839,6 +1845,122 @@ ActionAtomic (int argc, char **argv, Coord x, Coord y)
   return 0;
 }
 
+/* --------------------------------------------------------------------------- */
+
+/*!
+ * \brief Open a batch: coalesce undo into one serial number and defer
+ * drawing and polygon clipping until the outermost CommitBatch().
+ */
+static void
+OpenBatch (void)
+{
+  if (batch_depth++ > 0)
+    return;
+
+  BeginUndoBatch ();
+  SuspendDraw ();
+  DeferPolygonClipping ();
+  batch_rats = BATCH_RATS_NONE;
+}
+
+/*!
+ * \brief Run an AddRats() that was postponed by the current batch.
+ *
+ * Rat lines are found through the polygons, so their clipping is
+ * brought up to date first.
+ */
+static void
+FlushBatchRats (void)
+{
+  if (batch_rats == BATCH_RATS_NONE)
+    return;
+
+  FlushPolygonClipping ();
+  if (AddAllRats (batch_rats == BATCH_RATS_SELECTED, NULL))
+    SetChangedFlag (true);
+  DeferPolygonClipping ();
+  batch_rats = BATCH_RATS_NONE;
+}
+
+/*!
+ * \brief Close a batch; the outermost call re-clips the touched
+ * polygons, adds the postponed rat lines, closes the undo step and
+ * invalidates everything drawn in the meantime at once.
+ *
+ * \return False if there was no open batch.
+ */
+static bool
+CommitBatch (void)
+{
+  if (batch_depth == 0)
+    return false;
+  if (--batch_depth > 0)
+    return true;
+
+  FlushBatchRats ();
+  FlushPolygonClipping ();
+  EndUndoBatch ();
+  ResumeDraw ();
+  Draw ();
+  return true;
+}
+
+static const char beginbatch_syntax[] = N_("BeginBatch()");
+
+static const char beginbatch_help[] =
+  N_("Start a batch of actions that are applied as one step.");
+
+/* %start-doc actions BeginBatch
+
+Until the matching @code{EndBatch()}, all actions are recorded as a
+single undo step, nothing is redrawn, polygons are not re-clipped
+after each change and @code{AddRats(AllRats|SelectedRats)} is
+postponed.  This makes scripts with many edits a lot faster.
+
+While a batch is open, polygon clearances and connection lookups may
+not reflect the latest edits, and @code{Undo()} and @code{Redo()} only
+step through changes made since the batch began.  Batches may be
+nested; only the outermost @code{EndBatch()} commits.  See also the
+@code{--batch-scripts} option.
+
+%end-doc */
+
+static int
+ActionBeginBatch (int argc, char **argv, Coord x, Coord y)
+{
+  if (argc != 0)
+    AFAIL (beginbatch);
+
+  OpenBatch ();
+  return 0;
+}
+
+static const char endbatch_syntax[] = N_("EndBatch()");
+
+static const char endbatch_help[] =
+  N_("Commit the batch started with BeginBatch().");
+
+/* %start-doc actions EndBatch
+
+Re-clips the polygons touched by the batch, adds the postponed rat
+lines and redraws the changed area.
+
+%end-doc */
+
+static int
+ActionEndBatch (int argc, char **argv, Coord x, Coord y)
+{
+  if (argc != 0)
+    AFAIL (endbatch);
+
+  if (!CommitBatch ())
+    {
+      Message (_("EndBatch() without BeginBatch()\n"));
+      return 1;
+    }
+  return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 
 static const char drc_syntax[] = N_("DRC()");
@@ -1897,6 +2019,7 @@ ActionDumpLibrary (int argc, char **argv, Coord x, Coord y)
 {
   int i, j;
 
+  EnsureLibraryContents ();
   printf ("**** Do not count on this format.  It will change ****\n\n");
   printf ("MenuN   = %d\n", (int) Library.MenuN);
   printf ("MenuMax = %d\n", (int) Library.MenuMax);
@@ -3789,15 +3912,20 @@ ActionAddRats (int argc, char **argv, Coord x, Coord y)
       switch (GetFunctionID (function))
 	{
 	case F_AllRats:
-	  if (AddAllRats (false, NULL))
+	  if (batch_depth)
+	    batch_rats = BATCH_RATS_ALL;
+	  else if (AddAllRats (false, NULL))
 	    SetChangedFlag (true);
 	  break;
 	case F_SelectedRats:
 	case F_Selected:
-	  if (AddAllRats (true, NULL))
+	  if (batch_depth)
+	    batch_rats = MAX (batch_rats, BATCH_RATS_SELECTED);
+	  else if (AddAllRats (true, NULL))
 	    SetChangedFlag (true);
 	  break;
 	case F_Close:
+	  FlushBatchRats ();
 	  small = SQUARE (MAX_COORD);
 	  shorty = NULL;
 	  RAT_LOOP (PCB->Data);
@@ -3868,10 +3996,12 @@ ActionDelete (int argc, char **argv, Coord x, Coord y)
       RemoveSelected();
       break;
     case F_AllRats:
+      FlushBatchRats ();
       if (DeleteRats (false))
 	SetChangedFlag (true);
       break;
     case F_SelectedRats:
+      FlushBatchRats ();
       if (DeleteRats (true))
 	SetChangedFlag (true);
       break;
@@ -3899,6 +4029,7 @@ ActionDeleteRats (int argc, char **argv, Coord x, Coord y)
     {
       if (Settings.RatWarn)
 	ClearWarnings ();
+      FlushBatchRats ();
       switch (GetFunctionID (function))
 	{
 	case F_AllRats:
@@ -3943,7 +4074,8 @@ ActionAutoPlaceSelected (int argc, char **argv, Coord x, Coord y)
 
 /* --------------------------------------------------------------------------- */
 
-static const char autoroute_syntax[] = N_("AutoRoute(AllRats|SelectedRats)");
+static const char autoroute_syntax[] =
+  N_("AutoRoute(AllRats|SelectedRats[, StatsFile])");
 
 static const char autoroute_help[] = N_("Auto-route some or all rat lines.");
 
@@ -3959,6 +4091,16 @@ Attempt to autoroute the selected rats.
 
 @end table
 
+If a second argument is given, statistics for every net routed in
+every pass are written to that file as comma separated values: the
+pass, a pin of the net, whether its old traces were ripped up, the
+number of searches and how many of them found a route, found one only
+with conflicts or failed, the edges expanded, the edges dropped for
+leaving the search window, the peak size of the search heap, the via
+sites tried, the wall time in seconds, the cost of the routes and
+whether the net was completely routed.  This helps to find the nets
+that take most of the routing time.
+
 Before autorouting, it's important to set up a few things.  First,
 make sure any layers you aren't using are disabled, else the
 autorouter may use them.  Next, make sure the current line and via
@@ -3974,18 +4116,19 @@ static int
 ActionAutoRoute (int argc, char **argv, Coord x, Coord y)
 {
   char *function = ARG (0);
+  char *stats_file = ARG (1);
   hid_action("Busy");
   if (function)			/* one parameter */
     {
       switch (GetFunctionID (function))
 	{
 	case F_AllRats:
-	  if (AutoRoute (false))
+	  if (AutoRoute (false, stats_file))
 	    SetChangedFlag (true);
 	  break;
 	case F_SelectedRats:
 	case F_Selected:
-	  if (AutoRoute (true))
+	  if (AutoRoute (true, stats_file))
 	    SetChangedFlag (true);
 	  break;
 	}
@@ -6900,6 +7043,7 @@ ActionExecuteFile (int argc, char **argv, Coord x, Coord y)
   char *fname;
   char line[256];
   int n = 0;
+  int depth;
   char *sp;
 
   if (argc != 1)
@@ -6913,6 +7057,10 @@ ActionExecuteFile (int argc, char **argv, Coord x, Coord y)
       return 1;
     }
 
+  depth = batch_depth;
+  if (Settings.BatchScripts)
+    OpenBatch ();
+
   defer_updates = 1;
   defer_needs_update = 0;
   while (fgets (line, sizeof (line), fp) != NULL)
@@ -6942,6 +7090,12 @@ ActionExecuteFile (int argc, char **argv, Coord x, Coord y)
 	}
     }
 
+  if (batch_depth > depth + (Settings.BatchScripts ? 1 : 0))
+    Message (_("%s: BeginBatch() without EndBatch(), committing it\n"),
+	     fname);
+  while (batch_depth > depth)
+    CommitBatch ();
+
   defer_updates = 0;
   if (defer_needs_update)
     {
@@ -8089,6 +8243,9 @@ HID_Action action_action_list[] = {
   {"AutoRoute", 0, ActionAutoRoute,
    autoroute_help, autoroute_syntax}
   ,
+  {"BeginBatch", 0, ActionBeginBatch,
+   beginbatch_help, beginbatch_syntax}
+  ,
   {"ChangeClearSize", 0, ActionChangeClearSize,
    changeclearsize_help, changeclearsize_syntax}
   ,
@@ -8146,6 +8303,9 @@ HID_Action action_action_list[] = {
   {"DumpLibrary", 0, ActionDumpLibrary,
    dumplibrary_help, dumplibrary_syntax}
   ,
+  {"EndBatch", 0, ActionEndBatch,
+   endbatch_help, endbatch_syntax}
+  ,
   {"ExecuteFile", 0, ActionExecuteFile,
    executefile_help, executefile_syntax}
   ,
@@ -0,0 +1,149 @@
+/*!
+ * \file src/arena.c
+ *
+ * \brief Arena allocator for short-lived objects of the same lifetime.
+ *
+ * Objects are carved out of large chunks and are never freed one by
+ * one.  arena_reset() makes all the memory of an arena available again
+ * in constant time, keeping the chunks for the next round, so code that
+ * builds and throws away many small objects over and over does not pay
+ * for malloc() and free() on each of them and does not fragment the
+ * heap.  arena_destroy() returns the chunks to the system.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+/*!
+ * \brief Size of the chunks, unless a single allocation needs more.
+ */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/*!
+ * \brief Alignment of the returned memory.
+ */
+#define ARENA_ALIGN (2 * sizeof (void *))
+
+struct arena_chunk
+{
+  arena_chunk_t *next;
+  size_t size;			/*!< Usable bytes in data. */
+  size_t used;
+  /* the data follows, aligned to ARENA_ALIGN */
+};
+
+#define CHUNK_HEADER \
+  ((sizeof (arena_chunk_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define CHUNK_DATA(c) ((char *) (c) + CHUNK_HEADER)
+
+static arena_chunk_t *
+new_chunk (size_t size)
+{
+  arena_chunk_t *c;
+
+  if (size < ARENA_CHUNK_SIZE)
+    size = ARENA_CHUNK_SIZE;
+  c = (arena_chunk_t *) malloc (CHUNK_HEADER + size);
+  if (c == NULL)
+    abort ();
+  c->next = NULL;
+  c->size = size;
+  c->used = 0;
+  return c;
+}
+
+/*!
+ * \brief Returns \a size bytes of zeroed memory from the arena.
+ *
+ * The memory stays valid until the next arena_reset() or
+ * arena_destroy().
+ */
+void *
+arena_alloc (arena_t *arena, size_t size)
+{
+  arena_chunk_t *c = arena->current;
+  void *p;
+
+  size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+  if (c == NULL)
+    arena->first = arena->current = c = new_chunk (size);
+
+  /* move on to the next chunk that has room, reusing chunks kept by
+     arena_reset() */
+  while (c->used + size > c->size)
+    {
+      if (c->next == NULL)
+	c->next = new_chunk (size);
+      c = arena->current = c->next;
+      c->used = 0;
+    }
+
+  p = CHUNK_DATA (c) + c->used;
+  c->used += size;
+  arena->allocated += size;
+  memset (p, 0, size);
+  return p;
+}
+
+/*!
+ * \brief Releases everything allocated from the arena.
+ *
+ * The chunks are kept, so this takes constant time.
+ */
+void
+arena_reset (arena_t *arena)
+{
+  arena->current = arena->first;
+  if (arena->first != NULL)
+    arena->first->used = 0;
+  arena->allocated = 0;
+}
+
+/*!
+ * \brief Releases everything allocated from the arena and frees its
+ * chunks.
+ */
+void
+arena_destroy (arena_t *arena)
+{
+  arena_chunk_t *c, *next;
+
+  for (c = arena->first; c != NULL; c = next)
+    {
+      next = c->next;
+      free (c);
+    }
+  arena->first = arena->current = NULL;
+  arena->allocated = 0;
+}
@@ -0,0 +1,50 @@
+/*!
+ * \file src/arena.h
+ *
+ * \brief Prototypes for the arena allocator.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PCB_ARENA_H
+#define PCB_ARENA_H
+
+#include <stddef.h>
+
+typedef struct arena_chunk arena_chunk_t;
+
+/*!
+ * \brief An arena hands out memory that is released all at once.
+ *
+ * A zero-initialized arena_t is a valid, empty arena.
+ */
+typedef struct arena
+{
+  arena_chunk_t *first;		/*!< All chunks, kept across resets. */
+  arena_chunk_t *current;	/*!< Chunk allocations are taken from. */
+  size_t allocated;		/*!< Bytes handed out since the last reset. */
+} arena_t;
+
+void *arena_alloc (arena_t *, size_t);
+void arena_reset (arena_t *);
+void arena_destroy (arena_t *);
+
+#endif /* PCB_ARENA_H */
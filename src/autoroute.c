@@ -65,11 +65,13 @@
 #include "global.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <setjmp.h>
 
 #include "data.h"
 #include "macro.h"
 #include "autoroute.h"
+#include "arena.h"
 #include "box.h"
 #include "create.h"
 #include "draw.h"
@@ -88,6 +90,13 @@
 #include "vector.h"
 #include "pcb-printf.h"
 #include "hid_draw.h"
+#include "perf.h"
+
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H)
+#define ROUTE_WORKERS 1
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
@@ -312,6 +321,8 @@ typedef struct routebox
   direction_t came_from;
   /* circular lists with connectivity information. */
   routebox_list same_net, same_subnet, original_subnet, different_net;
+  /* next obstacle made from the same board object */
+  struct routebox *same_object;
   union {
     PinType *via;
     LineType *line;
@@ -377,7 +388,9 @@ static struct
     JogPenalty,			/* additional "length" cost for changing direction */
     CongestionPenalty,		/* (rational) length multiplier for routing in */
     NewLayerPenalty,		/* penalty for routing on a previously unused layer */
-    MinPenalty;			/* smallest Direction Penalty */
+    MinPenalty,			/* smallest Direction Penalty */
+    MinXPenalty,		/* smallest horizontal Direction Penalty */
+    MinYPenalty;		/* smallest vertical Direction Penalty */
   /* maximum conflict incidence before calling it "no path found" */
   int hi_conflict;
   /* are vias allowed? */
@@ -402,6 +415,12 @@ struct routeone_state
   /* information about the best path found so far. */
   routebox_t *best_path, *best_target;
   cost_t best_cost;
+  /* via site areas turned into via edges */
+  int vias_tried;
+  /* edges leaving 'window' are dropped, if 'use_window' is set */
+  bool use_window;
+  BoxType window;
+  int edges_pruned;
 };
 
 
@@ -443,9 +462,78 @@ static bool is_layer_group_active[MAX_GROUP];
 static int ro = 0;
 static int smoothes = 1;
 static int passes = 12;
+/*!
+ * \brief Refinement passes allowed in negotiated congestion mode.
+ */
+#define NEGOTIATED_PASSES 40
 static int routing_layers = 0;
 static float total_wire_length = 0;
 static int total_via_count = 0;
+/*!
+ * \brief Fixed obstacles of the route database, released in one go by
+ * AutoRouteForget(), or by ReleaseRouteData() once a run that had to
+ * forget the database is over.
+ */
+static arena_t session_arena;
+/*!
+ * \brief Edges and expansion areas of the current RouteOne() search,
+ * reset in one go when the search is done.
+ */
+static arena_t search_arena;
+/*!
+ * \brief Where RouteAll() writes its per-net statistics, if anywhere.
+ */
+static FILE *route_stats = NULL;
+
+/*!
+ * \brief What the obstacles of the route database were made for.
+ */
+struct route_db_key
+{
+  PCBType *pcb;
+  Cardinal groups;
+  LayerGroupType layer_groups;
+  bool active[MAX_GROUP];
+  bool vias;
+  Coord style[NUM_STYLES + 1][4];
+};
+
+/*!
+ * \brief A board object that changed since the last run.
+ */
+struct route_db_change
+{
+  int type;
+  void *ptr1;			/*!< The element, for pins and pads. */
+  bool removed;
+};
+
+/*!
+ * \brief The fixed obstacles of the board, kept from one AutoRoute()
+ * to the next.
+ *
+ * The undo code reports every board object it records to
+ * AutoRouteObjectChanged(), and CreateRouteData() then only remakes the
+ * obstacles of those objects instead of those of the whole board.
+ * Anything that changes the obstacles everywhere, like other route
+ * styles or layers being switched off, starts over from scratch.
+ */
+static struct
+{
+  routedata_t *rd;		/*!< NULL until the first AutoRoute(). */
+  struct route_db_key key;
+  GHashTable *objects;		/*!< Board object -> its obstacles. */
+  GHashTable *changed;		/*!< Board object -> route_db_change. */
+  GArray *members;		/*!< Connections on nets in the last run. */
+  int live, stale;		/*!< Obstacles in use and dropped ones. */
+  bool busy;			/*!< Between CreateRouteData() and
+				   ReleaseRouteData(). */
+  bool flush;			/*!< Forget the database once not busy. */
+} route_db;
+/* set in the worker processes of the parallel mode, which must not
+   touch the GUI, along with the traces of other nets they marked bad */
+static bool in_route_worker = false;
+static vector_t *worker_bad = NULL;
 
 /* assertion helper for routeboxen */
 #ifndef NDEBUG
@@ -647,6 +735,19 @@ point_in_shrunk_box (const routebox_t * box, Coord X, Coord Y)
  * routedata initialization functions.
  */
 
+/*!
+ * \brief Files the fixed obstacle \a rb under the board object it was
+ * made from, so that it can be found again when \a object changes.
+ */
+static void
+RememberObstacle (routebox_t * rb, void *object)
+{
+  rb->same_object =
+    (routebox_t *) g_hash_table_lookup (route_db.objects, object);
+  g_hash_table_insert (route_db.objects, object, rb);
+  route_db.live++;
+}
+
 static routebox_t *
 AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
 	RouteStyleType * style)
@@ -657,8 +758,7 @@ AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
   for (i = 0; i < max_group; i++)
     {
       rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[i]);
-      *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-      memset ((void *) *rbpp, 0, sizeof (**rbpp));
+      *rbpp = (routebox_t *)arena_alloc (&session_arena, sizeof (**rbpp));
       (*rbpp)->group = i;
       ht = HALF_THICK (MAX (pin->Thickness, pin->DrillingHole));
       init_const_box (*rbpp,
@@ -683,6 +783,7 @@ AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
       (*rbpp)->flags.circular = !TEST_FLAG (SQUAREFLAG, pin);
       /* circular lists */
       InitLists (*rbpp);
+      RememberObstacle (*rbpp, pin);
       /* link together */
       if (lastrb)
 	{
@@ -705,9 +806,7 @@ AddPad (PointerListType layergroupboxes[],
   assert (PCB->LayerGroups.Number[layergroup] > 0);
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
   assert (rbpp);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  assert (*rbpp);
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *)arena_alloc (&session_arena, sizeof (**rbpp));
   (*rbpp)->group = layergroup;
   halfthick = HALF_THICK (pad->Thickness);
   init_const_box (*rbpp,
@@ -727,6 +826,7 @@ AddPad (PointerListType layergroupboxes[],
   (*rbpp)->style = style;
   /* circular lists */
   InitLists (*rbpp);
+  RememberObstacle (*rbpp, pad);
   return *rbpp;
 }
 static routebox_t *
@@ -739,8 +839,7 @@ AddLine (PointerListType layergroupboxes[], int layergroup, LineType *line,
   assert (PCB->LayerGroups.Number[layergroup] > 0);
 
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *)arena_alloc (&session_arena, sizeof (**rbpp));
   (*rbpp)->group = layergroup;
   init_const_box (*rbpp,
 		  /*X1 */ MIN (line->Point1.X,
@@ -771,6 +870,7 @@ AddLine (PointerListType layergroupboxes[], int layergroup, LineType *line,
   (*rbpp)->style = style;
   /* circular lists */
   InitLists (*rbpp);
+  RememberObstacle (*rbpp, ptr);
   return *rbpp;
 }
 static routebox_t *
@@ -787,8 +887,7 @@ AddIrregularObstacle (PointerListType layergroupboxes[],
   assert (PCB->LayerGroups.Number[layergroup] > 0);
 
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *)arena_alloc (&session_arena, sizeof (**rbpp));
   (*rbpp)->group = layergroup;
   init_const_box (*rbpp, X1, Y1, X2, Y2, keep);
   (*rbpp)->flags.nonstraight = 1;
@@ -798,6 +897,7 @@ AddIrregularObstacle (PointerListType layergroupboxes[],
   (*rbpp)->style = style;
   /* circular lists */
   InitLists (*rbpp);
+  RememberObstacle (*rbpp, parent);
   return *rbpp;
 }
 
@@ -941,13 +1041,349 @@ DumpRouteBox (routebox_t * rb)
 }
 #endif
 
+/*!
+ * \brief Adds a line that is not on any net; non-straight lines are
+ * diced up into many tiny obstacles.
+ */
+static void
+AddPlainLine (routedata_t * rd, PointerListType layergroupboxes[],
+	      Cardinal layergroup, LineType *line)
+{
+  if (line->Point1.X != line->Point2.X && line->Point1.Y != line->Point2.Y)
+    {
+      LineType fake_line = *line;
+      Coord dx = (line->Point2.X - line->Point1.X);
+      Coord dy = (line->Point2.Y - line->Point1.Y);
+      int segs = MAX (ABS (dx), ABS (dy)) / (4 * rd->max_bloat + 1);
+      int qq;
+      segs = CLAMP (segs, 1, 32);	/* don't go too crazy */
+      dx /= segs;
+      dy /= segs;
+      for (qq = 0; qq < segs - 1; qq++)
+	{
+	  fake_line.Point2.X = fake_line.Point1.X + dx;
+	  fake_line.Point2.Y = fake_line.Point1.Y + dy;
+	  if (fake_line.Point2.X == line->Point2.X
+	      && fake_line.Point2.Y == line->Point2.Y)
+	    break;
+	  AddLine (layergroupboxes, layergroup, &fake_line, line,
+		   rd->styles[NUM_STYLES]);
+	  fake_line.Point1 = fake_line.Point2;
+	}
+      fake_line.Point2 = line->Point2;
+      AddLine (layergroupboxes, layergroup, &fake_line, line,
+	       rd->styles[NUM_STYLES]);
+    }
+  else
+    AddLine (layergroupboxes, layergroup, line, line, rd->styles[NUM_STYLES]);
+}
+
+/*!
+ * \brief Adds the obstacles of all board objects that are not on any
+ * net, that is, which were not marked with DRCFLAG on the way.
+ */
+static void
+AddOtherObstacles (routedata_t * rd, PointerListType layergroupboxes[])
+{
+  int i;
+
+  /* add pins and pads of elements */
+  ALLPIN_LOOP (PCB->Data);
+  {
+    if (TEST_FLAG (DRCFLAG, pin))
+      CLEAR_FLAG (DRCFLAG, pin);
+    else
+      AddPin (layergroupboxes, pin, false, rd->styles[NUM_STYLES]);
+  }
+  ENDALL_LOOP;
+  ALLPAD_LOOP (PCB->Data);
+  {
+    if (TEST_FLAG (DRCFLAG, pad))
+      CLEAR_FLAG (DRCFLAG, pad);
+    else
+      AddPad (layergroupboxes, element, pad, rd->styles[NUM_STYLES]);
+  }
+  ENDALL_LOOP;
+  /* add all vias */
+  VIA_LOOP (PCB->Data);
+  {
+    if (TEST_FLAG (DRCFLAG, via))
+      CLEAR_FLAG (DRCFLAG, via);
+    else
+      AddPin (layergroupboxes, via, true, rd->styles[NUM_STYLES]);
+  }
+  END_LOOP;
+
+  for (i = 0; i < max_copper_layer; i++)
+    {
+      int layergroup = GetLayerGroupNumberByNumber (i);
+      /* add all (non-rat) lines */
+      LINE_LOOP (LAYER_PTR (i));
+      {
+	if (TEST_FLAG (DRCFLAG, line))
+	  {
+	    CLEAR_FLAG (DRCFLAG, line);
+	    continue;
+	  }
+	AddPlainLine (rd, layergroupboxes, layergroup, line);
+      }
+      END_LOOP;
+      /* add all polygons */
+      POLYGON_LOOP (LAYER_PTR (i));
+      {
+	if (TEST_FLAG (DRCFLAG, polygon))
+	  CLEAR_FLAG (DRCFLAG, polygon);
+	else
+	  AddPolygon (layergroupboxes, i, polygon, rd->styles[NUM_STYLES]);
+      }
+      END_LOOP;
+      /* add all copper text */
+      TEXT_LOOP (LAYER_PTR (i));
+      {
+	AddText (layergroupboxes, layergroup, text, rd->styles[NUM_STYLES]);
+      }
+      END_LOOP;
+      /* add all arcs */
+      ARC_LOOP (LAYER_PTR (i));
+      {
+	AddArc (layergroupboxes, layergroup, arc, rd->styles[NUM_STYLES]);
+      }
+      END_LOOP;
+    }
+}
+
+static int
+__match_object (const BoxType * box, void *cl)
+{
+  return box == cl;
+}
+
+/*!
+ * \brief Finds the copper layer that \a object of type \a type is on.
+ *
+ * \return the layer number, or -1 if it is not on a copper layer.
+ */
+static int
+FindObjectLayer (int type, void *object)
+{
+  BoxType query = bloat_box (&((AnyObjectType *) object)->BoundingBox, 1);
+  int i;
+
+  for (i = 0; i < max_copper_layer; i++)
+    {
+      LayerType *layer = LAYER_PTR (i);
+      rtree_t *tree;
+
+      switch (type)
+	{
+	case LINE_TYPE:
+	  tree = layer->line_tree;
+	  break;
+	case ARC_TYPE:
+	  tree = layer->arc_tree;
+	  break;
+	case TEXT_TYPE:
+	  tree = layer->text_tree;
+	  break;
+	default:
+	  tree = layer->polygon_tree;
+	  break;
+	}
+      if (tree && r_search (tree, &query, NULL, __match_object, object))
+	return i;
+    }
+  return -1;
+}
+
+/*!
+ * \brief Adds the obstacles of a single board object that is not on
+ * any net.
+ */
+static void
+AddObstacle (routedata_t * rd, PointerListType layergroupboxes[],
+	     int type, void *ptr1, void *ptr2)
+{
+  RouteStyleType *style = rd->styles[NUM_STYLES];
+  int layer;
+
+  switch (type)
+    {
+    case PIN_TYPE:
+    case VIA_TYPE:
+      AddPin (layergroupboxes, (PinType *) ptr2, type == VIA_TYPE, style);
+      return;
+    case PAD_TYPE:
+      AddPad (layergroupboxes, (ElementType *) ptr1, (PadType *) ptr2,
+	      style);
+      return;
+    }
+  /* the object may have been moved to another layer */
+  layer = FindObjectLayer (type, ptr2);
+  if (layer < 0)
+    return;
+  switch (type)
+    {
+    case LINE_TYPE:
+      AddPlainLine (rd, layergroupboxes, GetLayerGroupNumberByNumber (layer),
+		    (LineType *) ptr2);
+      break;
+    case POLYGON_TYPE:
+      AddPolygon (layergroupboxes, layer, (PolygonType *) ptr2, style);
+      break;
+    case TEXT_TYPE:
+      AddText (layergroupboxes, GetLayerGroupNumberByNumber (layer),
+	       (TextType *) ptr2, style);
+      break;
+    case ARC_TYPE:
+      AddArc (layergroupboxes, GetLayerGroupNumberByNumber (layer),
+	      (ArcType *) ptr2, style);
+      break;
+    }
+}
+
+static void
+MakeRouteDBKey (struct route_db_key *key)
+{
+  int i;
+
+  memset (key, 0, sizeof (*key));
+  key->pcb = PCB;
+  key->groups = max_group;
+  memcpy (&key->layer_groups, &PCB->LayerGroups, sizeof (key->layer_groups));
+  memcpy (key->active, is_layer_group_active, sizeof (key->active));
+  key->vias = AutoRouteParameters.use_vias;
+  for (i = 0; i < NUM_STYLES; i++)
+    {
+      key->style[i][0] = PCB->RouteStyle[i].Thick;
+      key->style[i][1] = PCB->RouteStyle[i].Diameter;
+      key->style[i][2] = PCB->RouteStyle[i].Hole;
+      key->style[i][3] = PCB->RouteStyle[i].Keepaway;
+    }
+  key->style[NUM_STYLES][0] = Settings.LineThickness;
+  key->style[NUM_STYLES][1] = Settings.ViaThickness;
+  key->style[NUM_STYLES][2] = Settings.ViaDrillingHole;
+  key->style[NUM_STYLES][3] = Settings.Keepaway;
+}
+
+/*!
+ * \brief Takes the obstacles of \a object out of the route database.
+ *
+ * They stay in the session arena until the database is made anew.
+ */
+static void
+DropObstacles (routedata_t * rd, void *object)
+{
+  routebox_t *p;
+
+  p = (routebox_t *) g_hash_table_lookup (route_db.objects, object);
+  for (; p; p = p->same_object)
+    {
+      r_delete_entry (rd->layergrouptree[p->group], &p->box);
+      if (rd->mtspace && !p->flags.clear_poly)
+	mtspace_remove (rd->mtspace, &p->box, FIXED, p->style->Keepaway);
+      route_db.live--;
+      route_db.stale++;
+    }
+  g_hash_table_remove (route_db.objects, object);
+}
+
+static void
+DropChangedObstacles (routedata_t * rd)
+{
+  GHashTableIter iter;
+  gpointer object;
+
+  g_hash_table_iter_init (&iter, route_db.changed);
+  while (g_hash_table_iter_next (&iter, &object, NULL))
+    DropObstacles (rd, object);
+}
+
+/*!
+ * \brief Readies the obstacles kept for \a object for another run.
+ *
+ * Their connectivity is reset to that of a freshly made object; the
+ * pieces of a diced line are only linked up if \a on_net is set.
+ *
+ * \return the obstacles, or NULL if there are none or they were made
+ * for another route style.
+ */
+static routebox_t *
+ReuseObstacles (void *object, RouteStyleType * style, bool on_net)
+{
+  routebox_t *rb, *p;
+
+  rb = (routebox_t *) g_hash_table_lookup (route_db.objects, object);
+  if (!rb)
+    return NULL;
+  if (rb->style != style)
+    {
+      DropObstacles (route_db.rd, object);
+      return NULL;
+    }
+  for (p = rb; p; p = p->same_object)
+    {
+      p->flags.source = p->flags.target = p->flags.nobloat = 0;
+      p->flags.touched = p->flags.subnet_processed = p->flags.is_bad = 0;
+      InitLists (p);
+      if (p == rb || (p->type == LINE && !on_net))
+	continue;
+      MergeNets (p, rb, NET);
+      MergeNets (p, rb, ORIGINAL);
+      if (p->type != LINE)
+	MergeNets (p, rb, SUBNET);
+    }
+  return rb;
+}
+
+/*!
+ * \brief Remakes the obstacles of the board objects that changed since
+ * the last run, and of those that were on a net then but no longer are.
+ *
+ * \a members are the connections on nets now, which are marked with
+ * DRCFLAG; the flags are cleared again here.
+ */
+static void
+AddChangedObstacles (routedata_t * rd, PointerListType layergroupboxes[],
+		     GArray * members)
+{
+  GHashTableIter iter;
+  gpointer object, value;
+  guint i;
+
+  g_hash_table_iter_init (&iter, route_db.changed);
+  while (g_hash_table_iter_next (&iter, &object, &value))
+    {
+      struct route_db_change *c = (struct route_db_change *) value;
+
+      if (!c->removed && !TEST_FLAG (DRCFLAG, (AnyObjectType *) object))
+	AddObstacle (rd, layergroupboxes, c->type, c->ptr1, object);
+    }
+  g_hash_table_remove_all (route_db.changed);
+
+  for (i = 0; i < route_db.members->len; i++)
+    {
+      ConnectionType *c = &g_array_index (route_db.members, ConnectionType, i);
+
+      /* removed objects have no obstacles left, so look those up first */
+      if (g_hash_table_lookup (route_db.objects, c->ptr2)
+	  && !TEST_FLAG (DRCFLAG, (AnyObjectType *) c->ptr2)
+	  && !ReuseObstacles (c->ptr2, rd->styles[NUM_STYLES], false))
+	AddObstacle (rd, layergroupboxes, c->type, c->ptr1, c->ptr2);
+    }
+  for (i = 0; i < members->len; i++)
+    CLEAR_FLAG (DRCFLAG, (AnyObjectType *)
+		g_array_index (members, ConnectionType, i).ptr2);
+}
+
 static routedata_t *
 CreateRouteData ()
 {
   NetListListType Nets;
   PointerListType layergroupboxes[MAX_GROUP];
-  BoxType bbox;
+  struct route_db_key key;
+  GArray *members;
   routedata_t *rd;
+  bool fresh;
   int group, i;
 
   /* check which layers are active first */
@@ -989,26 +1425,46 @@ CreateRouteData ()
 	  y_cost[i] = 2;
 	}
     }
-  /* create routedata */
-  rd = (routedata_t *)malloc (sizeof (*rd));
-  memset ((void *) rd, 0, sizeof (*rd));
-  /* create default style */
-  rd->defaultstyle.Thick = Settings.LineThickness;
-  rd->defaultstyle.Diameter = Settings.ViaThickness;
-  rd->defaultstyle.Hole = Settings.ViaDrillingHole;
-  rd->defaultstyle.Keepaway = Settings.Keepaway;
-  rd->max_bloat = BLOAT (&rd->defaultstyle);
-  rd->max_keep = Settings.Keepaway;
-  /* create styles structures */
-  bbox.X1 = bbox.Y1 = 0;
-  bbox.X2 = PCB->MaxWidth;
-  bbox.Y2 = PCB->MaxHeight;
-  for (i = 0; i < NUM_STYLES + 1; i++)
+  /* start over if the obstacles kept from the last run were made for
+   * something else, or if too many of them were dropped since */
+  MakeRouteDBKey (&key);
+  if (route_db.rd && (memcmp (&key, &route_db.key, sizeof (key)) != 0
+		      || route_db.stale > route_db.live))
+    AutoRouteForget ();
+  fresh = (route_db.rd == NULL);
+  if (fresh)
     {
-      RouteStyleType *style =
-	(i < NUM_STYLES) ? &PCB->RouteStyle[i] : &rd->defaultstyle;
-      rd->styles[i] = style;
+      /* create routedata */
+      rd = (routedata_t *)malloc (sizeof (*rd));
+      memset ((void *) rd, 0, sizeof (*rd));
+      /* create default style */
+      rd->defaultstyle.Thick = Settings.LineThickness;
+      rd->defaultstyle.Diameter = Settings.ViaThickness;
+      rd->defaultstyle.Hole = Settings.ViaDrillingHole;
+      rd->defaultstyle.Keepaway = Settings.Keepaway;
+      /* create styles structures */
+      for (i = 0; i < NUM_STYLES + 1; i++)
+	{
+	  RouteStyleType *style =
+	    (i < NUM_STYLES) ? &PCB->RouteStyle[i] : &rd->defaultstyle;
+	  rd->styles[i] = style;
+	}
+      route_db.rd = rd;
+      route_db.key = key;
+      route_db.objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+      route_db.changed = g_hash_table_new_full (g_direct_hash,
+						g_direct_equal, NULL, g_free);
+      route_db.members = g_array_new (FALSE, FALSE, sizeof (ConnectionType));
+    }
+  else
+    {
+      rd = route_db.rd;
+      rd->first_net = NULL;
+      DropChangedObstacles (rd);
     }
+  route_db.busy = true;
+  rd->max_bloat = BLOAT (&rd->defaultstyle);
+  rd->max_keep = Settings.Keepaway;
 
   /* initialize pointerlisttype */
   for (i = 0; i < max_group; i++)
@@ -1033,6 +1489,7 @@ CreateRouteData ()
    * this saves on searching the trees to find the nets
    */
   /* use the DRCFLAG to mark objects as they are entered */
+  members = g_array_new (FALSE, FALSE, sizeof (ConnectionType));
   Nets = CollectSubnets (false);
   {
     routebox_t *last_net = NULL;
@@ -1051,7 +1508,15 @@ CreateRouteData ()
 	{
 	  routebox_t *rb = NULL;
 	  SET_FLAG (DRCFLAG, (PinType *) connection->ptr2);
-	  if (connection->type == LINE_TYPE)
+	  g_array_append_val (members, *connection);
+	  if (!fresh && (rb = ReuseObstacles (connection->ptr2,
+					      rd->styles[j], true)))
+	    {
+	      /* lines are listed at each end, so skip one */
+	      if (connection->type == LINE_TYPE)
+		n--;
+	    }
+	  else if (connection->type == LINE_TYPE)
 	    {
 	      LineType *line = (LineType *) connection->ptr2;
 
@@ -1156,113 +1621,34 @@ CreateRouteData ()
     END_LOOP;
   }
 
-  /* add pins and pads of elements */
-  ALLPIN_LOOP (PCB->Data);
-  {
-    if (TEST_FLAG (DRCFLAG, pin))
-      CLEAR_FLAG (DRCFLAG, pin);
-    else
-      AddPin (layergroupboxes, pin, false, rd->styles[NUM_STYLES]);
-  }
-  ENDALL_LOOP;
-  ALLPAD_LOOP (PCB->Data);
-  {
-    if (TEST_FLAG (DRCFLAG, pad))
-      CLEAR_FLAG (DRCFLAG, pad);
-    else
-      AddPad (layergroupboxes, element, pad, rd->styles[NUM_STYLES]);
-  }
-  ENDALL_LOOP;
-  /* add all vias */
-  VIA_LOOP (PCB->Data);
-  {
-    if (TEST_FLAG (DRCFLAG, via))
-      CLEAR_FLAG (DRCFLAG, via);
-    else
-      AddPin (layergroupboxes, via, true, rd->styles[NUM_STYLES]);
-  }
-  END_LOOP;
+  if (fresh)
+    AddOtherObstacles (rd, layergroupboxes);
+  else
+    AddChangedObstacles (rd, layergroupboxes, members);
+  g_array_free (route_db.members, TRUE);
+  route_db.members = members;
 
-  for (i = 0; i < max_copper_layer; i++)
+  /* create r-trees from pointer lists, or add to the kept ones */
+  for (i = 0; i < max_group; i++)
     {
-      int layergroup = GetLayerGroupNumberByNumber (i);
-      /* add all (non-rat) lines */
-      LINE_LOOP (LAYER_PTR (i));
-      {
-	if (TEST_FLAG (DRCFLAG, line))
-	  {
-	    CLEAR_FLAG (DRCFLAG, line);
-	    continue;
-	  }
-	/* dice up non-straight lines into many tiny obstacles */
-	if (line->Point1.X != line->Point2.X
-	    && line->Point1.Y != line->Point2.Y)
-	  {
-	    LineType fake_line = *line;
-	    Coord dx = (line->Point2.X - line->Point1.X);
-	    Coord dy = (line->Point2.Y - line->Point1.Y);
-	    int segs = MAX (ABS (dx), ABS (dy)) / (4 * rd->max_bloat + 1);
-	    int qq;
-	    segs = CLAMP (segs, 1, 32);	/* don't go too crazy */
-	    dx /= segs;
-	    dy /= segs;
-	    for (qq = 0; qq < segs - 1; qq++)
-	      {
-		fake_line.Point2.X = fake_line.Point1.X + dx;
-		fake_line.Point2.Y = fake_line.Point1.Y + dy;
-		if (fake_line.Point2.X == line->Point2.X
-		    && fake_line.Point2.Y == line->Point2.Y)
-		  break;
-		AddLine (layergroupboxes, layergroup, &fake_line, line,
-			 rd->styles[NUM_STYLES]);
-		fake_line.Point1 = fake_line.Point2;
-	      }
-	    fake_line.Point2 = line->Point2;
-	    AddLine (layergroupboxes, layergroup, &fake_line, line,
-		     rd->styles[NUM_STYLES]);
-	  }
-	else
+      if (fresh)
+	rd->layergrouptree[i] =
+	  r_create_tree ((const BoxType **) layergroupboxes[i].Ptr,
+			 layergroupboxes[i].PtrN, 0);
+      else
+	{
+	  POINTER_LOOP (&layergroupboxes[i]);
 	  {
-	    AddLine (layergroupboxes, layergroup, line, line,
-		     rd->styles[NUM_STYLES]);
+	    r_insert_entry (rd->layergrouptree[i], (const BoxType *) *ptr, 0);
 	  }
-      }
-      END_LOOP;
-      /* add all polygons */
-      POLYGON_LOOP (LAYER_PTR (i));
-      {
-	if (TEST_FLAG (DRCFLAG, polygon))
-	  CLEAR_FLAG (DRCFLAG, polygon);
-	else
-	  AddPolygon (layergroupboxes, i, polygon, rd->styles[NUM_STYLES]);
-      }
-      END_LOOP;
-      /* add all copper text */
-      TEXT_LOOP (LAYER_PTR (i));
-      {
-	AddText (layergroupboxes, layergroup, text, rd->styles[NUM_STYLES]);
-      }
-      END_LOOP;
-      /* add all arcs */
-      ARC_LOOP (LAYER_PTR (i));
-      {
-	AddArc (layergroupboxes, layergroup, arc, rd->styles[NUM_STYLES]);
-      }
-      END_LOOP;
-    }
-
-  /* create r-trees from pointer lists */
-  for (i = 0; i < max_group; i++)
-    {
-      /* create the r-tree */
-      rd->layergrouptree[i] =
-	r_create_tree ((const BoxType **) layergroupboxes[i].Ptr,
-		       layergroupboxes[i].PtrN, 1);
+	  END_LOOP;
+	}
     }
 
   if (AutoRouteParameters.use_vias)
     {
-      rd->mtspace = mtspace_create ();
+      if (fresh)
+	rd->mtspace = mtspace_create ();
 
       /* create "empty-space" structures for via placement (now that we know
        * appropriate keepaways for all the fixed elements) */
@@ -1284,18 +1670,237 @@ CreateRouteData ()
   return rd;
 }
 
-void
-DestroyRouteData (routedata_t ** rd)
+/*-----------------------------------------------------------------
+ * Negotiated congestion.
+ *
+ * In negotiated congestion mode every refinement pass records where
+ * traces still conflict in a coarse history map, and routing through a
+ * conflict costs more the more often that place was contested before.
+ * Nets that keep fighting over the same area are so made to negotiate,
+ * until one of them takes a detour, instead of ripping each other up
+ * pass after pass.
+ */
+
+/*! \brief Cells of the history map along the longer side of the board. */
+#define HISTORY_CELLS 256
+/*! \brief Extra conflict penalty for every earlier conflict in a cell. */
+#define HISTORY_WEIGHT 0.5
+
+static struct
+{
+  float *cell[MAX_GROUP];	/*!< NULL when not negotiating. */
+  int w, h;
+  Coord size;			/*!< Size of a cell. */
+} history;
+
+static void
+history_create (void)
 {
   int i;
+
+  history.size = MAX (PCB->MaxWidth, PCB->MaxHeight) / HISTORY_CELLS + 1;
+  history.w = PCB->MaxWidth / history.size + 1;
+  history.h = PCB->MaxHeight / history.size + 1;
   for (i = 0; i < max_group; i++)
-    r_destroy_tree (&(*rd)->layergrouptree[i]);
-  if (AutoRouteParameters.use_vias)
-    mtspace_destroy (&(*rd)->mtspace);
-  free (*rd);
+    history.cell[i] = (float *) calloc (history.w * history.h,
+					sizeof (float));
+}
+
+static void
+history_destroy (void)
+{
+  int i;
+
+  for (i = 0; i < MAX_GROUP; i++)
+    {
+      free (history.cell[i]);
+      history.cell[i] = NULL;
+    }
+}
+
+/*!
+ * \brief Finds the history cells covered by \a b.
+ */
+static void
+history_span (const BoxType * b, int *x1, int *y1, int *x2, int *y2)
+{
+  *x1 = CLAMP (b->X1 / history.size, 0, history.w - 1);
+  *y1 = CLAMP (b->Y1 / history.size, 0, history.h - 1);
+  *x2 = CLAMP ((b->X2 - 1) / history.size, *x1, history.w - 1);
+  *y2 = CLAMP ((b->Y2 - 1) / history.size, *y1, history.h - 1);
+}
+
+/*!
+ * \brief Records a conflict at \a rb.
+ */
+static void
+history_add (const routebox_t * rb)
+{
+  float *cell = history.cell[rb->group];
+  int x, y, x1, y1, x2, y2;
+
+  if (!cell)
+    return;
+  history_span (&rb->sbox, &x1, &y1, &x2, &y2);
+  for (y = y1; y <= y2; y++)
+    for (x = x1; x <= x2; x++)
+      cell[y * history.w + x] += 1;
+}
+
+/*!
+ * \brief Returns by how much to scale the penalty of a conflict in
+ * \a b on layer group \a group.
+ */
+static cost_t
+history_factor (const BoxType * b, Cardinal group)
+{
+  float *cell = history.cell[group];
+  float worst = 0;
+  int x, y, x1, y1, x2, y2;
+
+  if (!cell)
+    return 1;
+  history_span (b, &x1, &y1, &x2, &y2);
+  for (y = y1; y <= y2; y++)
+    for (x = x1; x <= x2; x++)
+      worst = MAX (worst, cell[y * history.w + x]);
+  return 1 + HISTORY_WEIGHT * worst;
+}
+
+/*!
+ * \brief Ends a routing session.
+ *
+ * The traces of the session are taken out of the route database again.
+ * Those that were kept are on the board by now, and come back as fixed
+ * obstacles in the next run through AutoRouteObjectChanged().
+ */
+static void
+ReleaseRouteData (routedata_t ** rd)
+{
+  routebox_t *net, *p;
+
+  if ((*rd)->first_net)
+    {
+      LIST_LOOP ((*rd)->first_net, different_net, net);
+      {
+	LIST_LOOP (net, same_net, p);
+	if (!p->flags.fixed)
+	  r_delete_entry ((*rd)->layergrouptree[p->group], &p->box);
+	END_LOOP;
+      }
+      END_LOOP;
+    }
+  if ((*rd)->mtspace)
+    {
+      mtspace_clear ((*rd)->mtspace, EVEN);
+      mtspace_clear ((*rd)->mtspace, ODD);
+    }
+  arena_destroy (&search_arena);
+  history_destroy ();
+  route_db.busy = false;
+  if (route_db.flush)
+    AutoRouteForget ();
   *rd = NULL;
 }
 
+/*!
+ * \brief Throws the route database away, so that the next AutoRoute()
+ * starts from scratch.
+ *
+ * Called whenever the board changes in ways AutoRouteObjectChanged()
+ * can not follow, like undo and redo or loading another layout.
+ */
+void
+AutoRouteForget (void)
+{
+  routedata_t *rd = route_db.rd;
+  int i;
+
+  if (route_db.busy)
+    {
+      route_db.flush = true;
+      return;
+    }
+  route_db.flush = false;
+  if (!rd)
+    return;
+  for (i = 0; i < MAX_GROUP; i++)
+    if (rd->layergrouptree[i])
+      r_destroy_tree (&rd->layergrouptree[i]);
+  if (rd->mtspace)
+    mtspace_destroy (&rd->mtspace);
+  free (rd);
+  route_db.rd = NULL;
+  arena_destroy (&session_arena);
+  g_hash_table_destroy (route_db.objects);
+  g_hash_table_destroy (route_db.changed);
+  g_array_free (route_db.members, TRUE);
+  route_db.live = route_db.stale = 0;
+}
+
+static void
+NoteChangedObject (int type, void *ptr1, void *object, bool removed)
+{
+  struct route_db_change *c = g_new (struct route_db_change, 1);
+
+  c->type = type;
+  c->ptr1 = ptr1;
+  c->removed = removed;
+  g_hash_table_replace (route_db.changed, object, c);
+}
+
+/*!
+ * \brief Tells the route database that a board object changed, or was
+ * taken off the board if \a removed is set.
+ *
+ * The arguments are those of the undo functions; points stand for the
+ * line, arc or polygon they are part of, and elements for their pins
+ * and pads.
+ */
+void
+AutoRouteObjectChanged (int Type, void *Ptr1, void *Ptr2, bool removed)
+{
+  if (!route_db.rd)
+    return;
+  switch (Type)
+    {
+    case ELEMENT_TYPE:
+      {
+	ElementType *element = (ElementType *) Ptr2;
+
+	PIN_LOOP (element);
+	{
+	  NoteChangedObject (PIN_TYPE, element, pin, removed);
+	}
+	END_LOOP;
+	PAD_LOOP (element);
+	{
+	  NoteChangedObject (PAD_TYPE, element, pad, removed);
+	}
+	END_LOOP;
+      }
+      break;
+    case LINEPOINT_TYPE:
+      NoteChangedObject (LINE_TYPE, Ptr1, Ptr2, false);
+      break;
+    case ARCPOINT_TYPE:
+      NoteChangedObject (ARC_TYPE, Ptr1, Ptr2, false);
+      break;
+    case POLYGONPOINT_TYPE:
+      NoteChangedObject (POLYGON_TYPE, Ptr1, Ptr2, false);
+      break;
+    case VIA_TYPE:
+    case PIN_TYPE:
+    case PAD_TYPE:
+    case LINE_TYPE:
+    case ARC_TYPE:
+    case TEXT_TYPE:
+    case POLYGON_TYPE:
+      NoteChangedObject (Type, Ptr1, Ptr2, removed);
+      break;
+    }
+}
+
 /*-----------------------------------------------------------------
  * routebox reference counting.
  */
@@ -1311,8 +1916,10 @@ RB_up_count (routebox_t * rb)
 }
 
 /*!
- * \brief Decrement the reference count on a routebox, freeing if this
- * box becomes unused.
+ * \brief Decrement the reference count on a routebox.
+ *
+ * The box itself lives in the search arena and goes away when the
+ * search is done.
  */
 static void
 RB_down_count (routebox_t * rb)
@@ -1324,7 +1931,6 @@ RB_down_count (routebox_t * rb)
     {
       if (rb->parent.expansion_area->flags.homeless)
 	RB_down_count (rb->parent.expansion_area);
-      free (rb);
     }
 }
 
@@ -1437,18 +2043,30 @@ cost_to_routebox (const CheapPointType * p, Cardinal point_layer,
 {
   register cost_t trial = 0;
   CheapPointType p2 = closest_point_in_routebox (p, rb);
+  cost_t dx = ABS (p2.X - p->X), dy = ABS (p2.Y - p->Y);
+  /* the cheapest way to cover the distance on any layer */
+  cost_t anywhere = dx * AutoRouteParameters.MinXPenalty +
+    dy * AutoRouteParameters.MinYPenalty;
   if (!usedGroup[point_layer] || !usedGroup[rb->group])
     trial = AutoRouteParameters.NewLayerPenalty;
-  if ((p2.X - p->X) * (p2.Y - p->Y) != 0)
+  if (dx * dy != 0)
     trial += AutoRouteParameters.JogPenalty;
   /* special case for defered via searching */
-  if (point_layer > max_group || point_layer == rb->group)
-    return trial + ABS (p2.X - p->X) + ABS (p2.Y - p->Y);
+  if (point_layer > max_group)
+    return trial + anywhere;
+  if (point_layer == rb->group)
+    {
+      /* stay on this layer, or hop to a cheaper one and back */
+      cost_t here = dx * x_cost[point_layer] + dy * y_cost[point_layer];
+      if (AutoRouteParameters.use_vias)
+	here = MIN (here, 2 * AutoRouteParameters.ViaCost + anywhere);
+      return trial + here;
+    }
   /* if this target is only a via away, then the via is cheaper than the congestion */
   if (p->X == p2.X && p->Y == p2.Y)
     return trial + 1;
   trial += AutoRouteParameters.ViaCost;
-  trial += ABS (p2.X - p->X) + ABS (p2.Y - p->Y);
+  trial += anywhere;
   return trial;
 }
 
@@ -1752,9 +2370,7 @@ CreateEdge (routebox_t * rb,
 {
   edge_t *e;
   assert (__routebox_is_good (rb));
-  e = (edge_t *)malloc (sizeof (*e));
-  memset ((void *) e, 0, sizeof (*e));
-  assert (e);
+  e = (edge_t *)arena_alloc (&search_arena, sizeof (*e));
   e->rb = rb;
   if (rb->flags.homeless)
     RB_up_count (rb);
@@ -1835,10 +2451,13 @@ CreateViaEdge (const BoxType * area, Cardinal group,
   cost_t d;
   edge_t *ne;
   cost_t scale[3];
+  double history;
 
+  /* conflicts cost more where they happened before */
+  history = history_factor (area, group);
   scale[0] = 1;
-  scale[1] = AutoRouteParameters.LastConflictPenalty;
-  scale[2] = AutoRouteParameters.ConflictPenalty;
+  scale[1] = AutoRouteParameters.LastConflictPenalty * history;
+  scale[2] = AutoRouteParameters.ConflictPenalty * history;
 
   assert (box_is_good (area));
   assert (AutoRouteParameters.with_conflicts ||
@@ -1951,7 +2570,6 @@ KillEdge (void *edge)
     RB_down_count (e->rb);
   if (e->flags.via_search)
     mtsFreeWork (&e->work);
-  free (e);
 }
 
 static void
@@ -2088,8 +2706,7 @@ CreateExpansionArea (const BoxType * area, Cardinal group,
 		     routebox_t * parent,
 		     bool relax_edge_requirements, edge_t * src_edge)
 {
-  routebox_t *rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  routebox_t *rb = (routebox_t *) arena_alloc (&search_arena, sizeof (*rb));
   assert (area && parent);
   init_const_box (rb, area->X1, area->Y1, area->X2, area->Y2, 0);
   rb->group = group;
@@ -2497,8 +3114,7 @@ blocker_to_heap (heap_t * heap, routebox_t * rb,
 static routebox_t *
 CreateBridge (const BoxType * area, routebox_t * parent, direction_t dir)
 {
-  routebox_t *rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  routebox_t *rb = (routebox_t *) arena_alloc (&search_arena, sizeof (*rb));
   assert (area && parent);
   init_const_box (rb, area->X1, area->Y1, area->X2, area->Y2, 0);
   rb->group = parent->group;
@@ -2655,7 +3271,7 @@ moveable_edge (vector_t * result, const BoxType * box, direction_t dir,
       if (!box_is_good (&b))
 	return;			/* how did this happen ? */
       nrb = CreateBridge (&b, rb, dir);
-      r_insert_entry (tree, &nrb->box, 1);
+      r_insert_entry (tree, &nrb->box, 0);
       vector_append (area_vec, nrb);
       nrb->flags.homeless = 0;	/* not homeless any more */
       /* mark this one as conflicted */
@@ -2666,7 +3282,8 @@ moveable_edge (vector_t * result, const BoxType * box, direction_t dir,
       nrb->cost +=
 	cost_to_point_on_layer (&nrb->parent.expansion_area->cost_point,
 				&nrb->cost_point,
-				nrb->group) * CONFLICT_PENALTY (blocker);
+				nrb->group) * CONFLICT_PENALTY (blocker) *
+	history_factor (&blocker->sbox, blocker->group);
 
       ne = CreateEdge (nrb, nrb->cost_point.X, nrb->cost_point.Y, nrb->cost,
 		       NULL, ALL, targets);
@@ -2719,7 +3336,7 @@ moveable_edge (vector_t * result, const BoxType * box, direction_t dir,
       assert (box_intersect (&b, &blocker->sbox));
       b = shrink_box (&b, 1);
       nrb = CreateBridge (&b, rb, dir);
-      r_insert_entry (tree, &nrb->box, 1);
+      r_insert_entry (tree, &nrb->box, 0);
       vector_append (area_vec, nrb);
       nrb->flags.homeless = 0;	/* not homeless any more */
       ne = CreateEdge (nrb, nrb->cost_point.X, nrb->cost_point.Y,
@@ -3771,9 +4388,7 @@ CreateSearchEdge (struct routeone_state *s, vetting_t * work, edge_t * parent,
   if (cost < s->best_cost)
     {
       edge_t *ne;
-      ne = (edge_t *)malloc (sizeof (*ne));
-      memset ((void *) ne, 0, sizeof (*ne));
-      assert (ne);
+      ne = (edge_t *)arena_alloc (&search_arena, sizeof (*ne));
       ne->flags.via_search = 1;
       ne->flags.in_plane = in_plane;
       ne->rb = rb;
@@ -3796,6 +4411,18 @@ CreateSearchEdge (struct routeone_state *s, vetting_t * work, edge_t * parent,
 static void
 add_or_destroy_edge (struct routeone_state *s, edge_t * e)
 {
+  if (s->use_window)
+    {
+      BoxType b = e->expand_dir == ALL ? shrink_routebox (e->rb)
+	: edge_to_box (e->rb, e->expand_dir);
+      if (!box_intersect (&b, &s->window))
+	{
+	  /* heads away from the search window */
+	  s->edges_pruned++;
+	  DestroyEdge (&e);
+	  return;
+	}
+    }
   e->cost = edge_cost (e, s->best_cost);
   assert (__edge_is_good (e));
   assert (is_layer_group_active[e->rb->group]);
@@ -3925,6 +4552,7 @@ do_via_search (edge_t * search, struct routeone_state *s,
 	    }
 	}
     }
+  s->vias_tried += count;
   /* prevent freeing of work when this edge is destroyed */
   search->flags.via_search = 0;
   if (!work)
@@ -4063,11 +4691,65 @@ struct routeone_status
   int route_had_conflicts;
   cost_t best_route_cost;
   bool net_completely_routed;
+  /* the search window kept a route from being found */
+  bool window_limited;
+  /* the search gave up after examining its budget of edges */
+  bool budget_exhausted;
+  /* --- for the per-net statistics --- */
+  int edges_expanded;
+  int edges_pruned;
+  int heap_peak;
+  int vias_tried;
 };
 
+/*!
+ * \brief Sets up the search window of a RouteOne () search.
+ *
+ * The window is the bounding box of the net plus a margin: half the
+ * size of the net, but at least a few track widths, doubled \a widen
+ * times.  A window covering the whole board is not used at all.
+ */
+static void
+init_search_window (routedata_t * rd, routebox_t * from, int widen,
+		    struct routeone_state *s)
+{
+  BoxType b;
+  routebox_t *p;
+  Coord margin;
+
+  s->use_window = false;
+  s->edges_pruned = 0;
+  if (widen < 0)
+    return;
+  b = from->sbox;
+  LIST_LOOP (from, same_net, p);
+  {
+    MAKEMIN (b.X1, p->sbox.X1);
+    MAKEMIN (b.Y1, p->sbox.Y1);
+    MAKEMAX (b.X2, p->sbox.X2);
+    MAKEMAX (b.Y2, p->sbox.Y2);
+  }
+  END_LOOP;
+  margin = MAX (MAX (b.X2 - b.X1, b.Y2 - b.Y1) / 2, 20 * rd->max_bloat);
+  /* stop before the shift overflows; such a window covers any board */
+  if (widen > 16 || margin > MAX_COORD >> widen)
+    return;
+  margin <<= widen;
+  s->window = bloat_box (&b, margin);
+  s->use_window = s->window.X1 > 0 || s->window.Y1 > 0 ||
+    s->window.X2 < PCB->MaxWidth || s->window.Y2 < PCB->MaxHeight;
+}
 
+/*!
+ * \brief Routes from the subnet of \a from to \a to, or to any other
+ * subnet of the net if \a to is \c NULL.
+ *
+ * The search doesn't leave the window set up by init_search_window ()
+ * for \a widen; a negative \a widen searches the whole board.
+ */
 static struct routeone_status
-RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
+RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges,
+	  int widen)
 {
   struct routeone_status result;
   routebox_t *p;
@@ -4085,6 +4767,10 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 
   assert (rd && from);
   result.route_had_conflicts = 0;
+  result.edges_expanded = result.heap_peak = result.vias_tried = 0;
+  result.window_limited = result.budget_exhausted = false;
+  result.edges_pruned = 0;
+  init_search_window (rd, from, widen, &s);
   /* no targets on to/from net need keepaway areas */
   LIST_LOOP (from, same_net, p);
   p->flags.nobloat = 1;
@@ -4224,6 +4910,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
   /* okay, process items from heap until it is empty! */
   s.best_path = NULL;
   s.best_cost = EXPENSIVE;
+  s.vias_tried = 0;
   area_vec = vector_create ();
   edge_vec = vector_create ();
   vss.free_space_vec = vector_create ();
@@ -4231,7 +4918,11 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
   vss.hi_conflict_space_vec = vector_create ();
   while (!heap_is_empty (s.workheap))
     {
-      edge_t *e = (edge_t *)heap_remove_smallest (s.workheap);
+      edge_t *e;
+
+      /* the heap only shrinks here, so this sees its peak size */
+      result.heap_peak = MAX (result.heap_peak, heap_size (s.workheap));
+      e = (edge_t *)heap_remove_smallest (s.workheap);
 #ifdef ROUTE_DEBUG
       if (aabort)
 	goto dontexpand;
@@ -4248,7 +4939,12 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
        * who would have guessed?
        */
       if (seen++ > max_edges)
-	goto dontexpand;
+	{
+	  /* out of budget; drop the rest of the front in one go */
+	  result.budget_exhausted = true;
+	  heap_free (s.workheap, KillEdge);
+	  goto dontexpand;
+	}
       assert (__edge_is_good (e));
       /* mark or unmark conflictors as needed */
       touch_conflicts (e->rb->conflicts_with, 1);
@@ -4344,7 +5040,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	         &e->rb->box, NULL, no_planes,0));
 	       */
 	      r_insert_entry (rd->layergrouptree[e->rb->group], &e->rb->box,
-			      1);
+			      0);
 	      e->rb->flags.homeless = 0;	/* not homeless any more */
 	      /* add to vector of all expansion areas in r-tree */
 	      vector_append (area_vec, e->rb);
@@ -4499,7 +5195,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	    goto dontexpand;
 	  nrb = CreateExpansionArea (&ans->inflated, e->rb->group, e->rb,
 				     true, e);
-	  r_insert_entry (rd->layergrouptree[nrb->group], &nrb->box, 1);
+	  r_insert_entry (rd->layergrouptree[nrb->group], &nrb->box, 0);
 	  vector_append (area_vec, nrb);
 	  nrb->flags.homeless = 0;	/* not homeless any more */
 	  broken =
@@ -4525,6 +5221,10 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
     }
   touch_conflicts (NULL, 1);
   heap_destroy (&s.workheap);
+  result.edges_expanded = MIN (seen, max_edges + 1);
+  result.vias_tried = s.vias_tried;
+  result.edges_pruned = s.edges_pruned;
+  PERF_COUNT (PERF_ROUTE_EDGES_PRUNED, s.edges_pruned);
   r_destroy_tree (&targets);
   assert (vector_is_empty (edge_vec));
   vector_destroy (&edge_vec);
@@ -4546,6 +5246,10 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	    {
 	      rb = (routebox_t *)vector_remove_last (s.best_path->conflicts_with);
 	      rb->flags.is_bad = 1;
+#ifdef ROUTE_WORKERS
+	      if (in_route_worker)
+		vector_append (worker_bad, rb);
+#endif
 	      result.route_had_conflicts++;
 	    }
 	}
@@ -4578,6 +5282,9 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 #endif
       result.best_route_cost = s.best_cost;
       result.found_route = false;
+      /* a search that ran out of budget would run out again in a
+       * wider window, so only blame the window if it was the limit */
+      result.window_limited = s.edges_pruned > 0 && !result.budget_exhausted;
     }
   /* now remove all expansion areas from the r-tree. */
   while (!vector_is_empty (area_vec))
@@ -4601,6 +5308,10 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
   vector_destroy (&vss.lo_conflict_space_vec);
   vector_destroy (&vss.hi_conflict_space_vec);
 
+  /* all edges are gone and the expansion areas are out of the r-trees,
+     so the search arena can be recycled for the next search */
+  arena_reset (&search_arena);
+
   return result;
 }
 
@@ -4624,6 +5335,8 @@ InitAutoRouteParameters (int pass,
   AutoRouteParameters.JogPenalty = 1000 * (is_smoothing ? 20 : 4);
   AutoRouteParameters.CongestionPenalty = 1e6;
   AutoRouteParameters.MinPenalty = EXPENSIVE;
+  AutoRouteParameters.MinXPenalty = EXPENSIVE;
+  AutoRouteParameters.MinYPenalty = EXPENSIVE;
   for (i = 0; i < max_group; i++)
     {
       if (is_layer_group_active[i])
@@ -4633,6 +5346,10 @@ InitAutoRouteParameters (int pass,
 						MinPenalty);
 	  AutoRouteParameters.MinPenalty =
 	    MIN (y_cost[i], AutoRouteParameters.MinPenalty);
+	  AutoRouteParameters.MinXPenalty =
+	    MIN (x_cost[i], AutoRouteParameters.MinXPenalty);
+	  AutoRouteParameters.MinYPenalty =
+	    MIN (y_cost[i], AutoRouteParameters.MinYPenalty);
 	}
     }
   AutoRouteParameters.NewLayerPenalty = is_smoothing ?
@@ -4730,262 +5447,960 @@ calculate_progress (double this_heap_item, double this_heap_size,
   return process_fraction;
 }
 
-struct routeall_status
-RouteAll (routedata_t * rd)
+/*!
+ * \brief Prepares a net for routing in pass \a pass.
+ *
+ * After the first pass, the unfixed traces of the net are ripped up if
+ * they had conflicts, or on every smoothing pass.
+ *
+ * \return false if the net keeps its traces and needs no routing.
+ */
+static bool
+prepare_net (routedata_t * rd, routebox_t * net, int pass,
+	     struct routeall_status *ras)
 {
-  struct routeall_status ras;
-  struct routeone_status ros;
+  routebox_t *p;
   bool rip;
-  int request_cancel;
-#ifdef NET_HEAP
-  heap_t *net_heap;
-#endif
-  heap_t *this_pass, *next_pass, *tmp;
-  routebox_t *net, *p, *pp;
-  cost_t total_net_cost, last_cost = 0, this_cost = 0;
-  int i;
-  int this_heap_size;
-  int this_heap_item;
 
-  /* initialize heap for first pass; 
-   * do smallest area first; that makes
-   * the subsequent costs more representative */
-  this_pass = heap_create ();
-  next_pass = heap_create ();
-#ifdef NET_HEAP
-  net_heap = heap_create ();
-#endif
-  LIST_LOOP (rd->first_net, different_net, net);
-  {
-    double area;
-    BoxType bb = shrink_routebox (net);
-    LIST_LOOP (net, same_net, p);
+  InitAutoRouteParameters (pass, net->style, pass < passes, pass > passes,
+			   pass == passes + smoothes);
+  if (pass == 0)
+    return true;
+
+  /* rip up all unfixed traces in this net ? */
+  if (AutoRouteParameters.rip_always)
+    rip = true;
+  else
     {
-      MAKEMIN (bb.X1, p->sbox.X1);
-      MAKEMIN (bb.Y1, p->sbox.Y1);
-      MAKEMAX (bb.X2, p->sbox.X2);
-      MAKEMAX (bb.Y2, p->sbox.Y2);
+      rip = false;
+      LIST_LOOP (net, same_net, p);
+      if (p->flags.is_bad)
+	{
+	  rip = true;
+	  break;
+	}
+      END_LOOP;
     }
-    END_LOOP;
-    area = (double) (bb.X2 - bb.X1) * (bb.Y2 - bb.Y1);
-    heap_insert (this_pass, area, net);
-  }
-  END_LOOP;
 
-  ras.total_nets_routed = 0;
-  /* refinement/finishing passes */
-  for (i = 0; i <= passes + smoothes; i++)
+  LIST_LOOP (net, same_net, p);
+  p->flags.is_bad = 0;
+  if (!p->flags.fixed)
     {
-#ifdef ROUTE_VERBOSE
-      if (i > 0 && i <= passes)
-	printf ("--------- STARTING REFINEMENT PASS %d ------------\n", i);
-      else if (i > passes)
-	printf ("--------- STARTING SMOOTHING PASS %d -------------\n",
-		i - passes);
+#ifndef NDEBUG
+      bool del;
 #endif
-      ras.total_subnets = ras.routed_subnets = ras.conflict_subnets =
-	ras.failed = ras.ripped = 0;
-      assert (heap_is_empty (next_pass));
-
-      this_heap_size = heap_size (this_pass);
-      for (this_heap_item = 0; !heap_is_empty (this_pass); this_heap_item++)
+      assert (!p->flags.homeless);
+      if (rip)
 	{
-#ifdef ROUTE_DEBUG
-	  if (aabort)
-	    break;
+	  RemoveFromNet (p, NET);
+	  RemoveFromNet (p, SUBNET);
+	}
+      if (AutoRouteParameters.use_vias && p->type != VIA_SHADOW
+	  && p->type != PLANE)
+	{
+	  mtspace_remove (rd->mtspace, &p->box,
+			  p->flags.is_odd ? ODD : EVEN,
+			  p->style->Keepaway);
+	  if (!rip)
+	    mtspace_add (rd->mtspace, &p->box,
+			 p->flags.is_odd ? EVEN : ODD,
+			 p->style->Keepaway);
+	}
+      if (rip)
+	{
+	  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+	    ripout_livedraw_obj (p);
+#ifndef NDEBUG
+	  del =
 #endif
-	  net = (routebox_t *) heap_remove_smallest (this_pass);
-	  InitAutoRouteParameters (i, net->style, i < passes, i > passes,
-				   i == passes + smoothes);
-	  if (i > 0)
-	    {
-	      /* rip up all unfixed traces in this net ? */
-	      if (AutoRouteParameters.rip_always)
-		rip = true;
-	      else
-		{
-		  rip = false;
-		  LIST_LOOP (net, same_net, p);
-		  if (p->flags.is_bad)
-		    {
-		      rip = true;
-		      break;
-		    }
-		  END_LOOP;
-		}
-
-	      LIST_LOOP (net, same_net, p);
-	      p->flags.is_bad = 0;
-	      if (!p->flags.fixed)
-		{
+	    r_delete_entry (rd->layergrouptree[p->group], &p->box);
 #ifndef NDEBUG
-		  bool del;
+	  assert (del);
 #endif
-		  assert (!p->flags.homeless);
-		  if (rip)
-		    {
-		      RemoveFromNet (p, NET);
-		      RemoveFromNet (p, SUBNET);
-		    }
-		  if (AutoRouteParameters.use_vias && p->type != VIA_SHADOW
-		      && p->type != PLANE)
-		    {
-		      mtspace_remove (rd->mtspace, &p->box,
-				      p->flags.is_odd ? ODD : EVEN,
-				      p->style->Keepaway);
-		      if (!rip)
-			mtspace_add (rd->mtspace, &p->box,
-				     p->flags.is_odd ? EVEN : ODD,
-				     p->style->Keepaway);
-		    }
-		  if (rip)
-		    {
-		      if (TEST_FLAG (LIVEROUTEFLAG, PCB))
-			ripout_livedraw_obj (p);
-#ifndef NDEBUG
-		      del =
+	}
+      else
+	{
+	  p->flags.is_odd = AutoRouteParameters.is_odd;
+	}
+    }
+  END_LOOP;
+  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+    Draw ();
+  /* reset to original connectivity */
+  if (!rip)
+    return false;
+  ras->ripped++;
+  ResetSubnet (net);
+  return true;
+}
+
+/*!
+ * \brief Outcome of routing one net with route_net ().
+ */
+struct routenet_result
+{
+  cost_t cost;			/*!< Summed cost of the routes found. */
+  bool skipped;			/*!< Nothing was left to route. */
+  bool completely_routed;
+  bool cancelled;
+  /* --- for the per-net statistics --- */
+  int searches;			/*!< Calls of RouteOne (). */
+  int routed, conflicts, failed;	/*!< Outcomes of those calls. */
+  int edges_expanded;
+  int edges_pruned;		/*!< Edges leaving the search window. */
+  int heap_peak;
+  int vias_tried;
+  double seconds;		/*!< Wall time spent. */
+};
+
+/*!
+ * \brief Routes the subnets of a net prepared by prepare_net ().
+ */
+static struct routenet_result
+route_net (routedata_t * rd, routebox_t * net, int pass,
+	   struct routeall_status *ras, int this_heap_item,
+	   int this_heap_size)
+{
+  struct routenet_result res;
+  struct routeone_status ros;
+  routebox_t *p, *pp;
+  double start = perf_now ();
+  int widen = 0;
+#ifdef NET_HEAP
+  heap_t *net_heap = heap_create ();
 #endif
-			r_delete_entry (rd->layergrouptree[p->group],
-					&p->box);
-#ifndef NDEBUG
-		      assert (del);
+
+  memset (&res, 0, sizeof (res));
+
+  /* count number of subnets */
+  FOREACH_SUBNET (net, p);
+  ras->total_subnets++;
+  END_FOREACH (net, p);
+  /* the first subnet doesn't require routing. */
+  ras->total_subnets--;
+  /* only route that which isn't fully routed */
+#ifdef ROUTE_DEBUG
+  if (ras->total_subnets == 0 || aabort)
+#else
+  if (ras->total_subnets == 0)
 #endif
-		    }
-		  else
-		    {
-		      p->flags.is_odd = AutoRouteParameters.is_odd;
-		    }
-		}
-	      END_LOOP;
-	      if (TEST_FLAG (LIVEROUTEFLAG, PCB))
-		Draw ();
-	      /* reset to original connectivity */
-	      if (rip)
+    {
+      res.skipped = true;
+      goto done;
+    }
+
+  /* the loop here ensures that we get to all subnets even if
+   * some of them are unreachable from the first subnet. */
+  LIST_LOOP (net, same_net, p);
+  {
+#ifdef NET_HEAP
+    BoxType b = shrink_routebox (p);
+    /* using a heap allows us to start from smaller objects and
+     * end at bigger ones. also prefer to start at planes, then pads */
+    heap_insert (net_heap, (float) (b.X2 - b.X1) *
+#if defined(ROUTE_RANDOMIZED)
+		 (0.3 + rand () / (RAND_MAX + 1.0)) *
+#endif
+		 (b.Y2 - b.Y1) * (p->type == PLANE ?
+				  -1 : (p->type ==
+					PAD ? 1 : 10)), p);
+  }
+  END_LOOP;
+  ros.net_completely_routed = 0;
+  while (!heap_is_empty (net_heap))
+    {
+      p = (routebox_t *) heap_remove_smallest (net_heap);
+#endif
+      if (!p->flags.fixed || p->flags.subnet_processed ||
+	  p->type == OTHER)
+	continue;
+
+      while (!ros.net_completely_routed)
+	{
+	  double percent;
+
+	  assert (no_expansion_boxes (rd));
+	  /* FIX ME: the number of edges to examine should be in autoroute parameters
+	   * i.e. the 2000 and 800 hard-coded below should be controllable by the user
+	   */
+	  ros =
+	    RouteOne (rd, p, NULL,
+		      ((AutoRouteParameters.
+			is_smoothing ? 2000 : 800) * (pass +
+						      1)) *
+		      routing_layers, widen);
+	  res.searches++;
+	  res.edges_expanded += ros.edges_expanded;
+	  res.edges_pruned += ros.edges_pruned;
+	  res.heap_peak = MAX (res.heap_peak, ros.heap_peak);
+	  res.vias_tried += ros.vias_tried;
+	  if (ros.window_limited)
+	    {
+	      /* the route may lie outside the window; look further out */
+	      PERF_COUNT (PERF_ROUTE_WINDOW_WIDENED, 1);
+	      widen++;
+	      continue;
+	    }
+	  widen = 0;
+	  res.cost += ros.best_route_cost;
+	  if (ros.found_route)
+	    {
+	      if (ros.route_had_conflicts)
 		{
-		  ras.ripped++;
-		  ResetSubnet (net);
+		  ras->conflict_subnets++;
+		  res.conflicts++;
 		}
 	      else
 		{
-		  heap_insert (next_pass, 0, net);
-		  continue;
+		  ras->routed_subnets++;
+		  ras->total_nets_routed++;
+		  res.routed++;
 		}
 	    }
-	  /* count number of subnets */
-	  FOREACH_SUBNET (net, p);
-	  ras.total_subnets++;
-	  END_FOREACH (net, p);
-	  /* the first subnet doesn't require routing. */
-	  ras.total_subnets--;
-	  /* and re-route! */
-	  total_net_cost = 0;
-	  /* only route that which isn't fully routed */
-#ifdef ROUTE_DEBUG
-	  if (ras.total_subnets == 0 || aabort)
-#else
-	  if (ras.total_subnets == 0)
-#endif
+	  else
 	    {
-	      heap_insert (next_pass, 0, net);
-	      continue;
+	      if (!ros.net_completely_routed)
+		{
+		  ras->failed++;
+		  res.failed++;
+		}
+	      /* don't bother trying any other source in this subnet */
+	      LIST_LOOP (p, same_subnet, pp);
+	      pp->flags.subnet_processed = 1;
+	      END_LOOP;
+	      break;
 	    }
+	  /* note that we can infer nothing about ras.total_subnets based
+	   * on the number of calls to RouteOne, because we may be unable
+	   * to route a net from a particular starting point, but perfectly
+	   * able to route it from some other. */
+	  if (in_route_worker)
+	    continue;
+	  percent = calculate_progress (this_heap_item, this_heap_size, ras);
+	  if (gui->progress (percent * 100., 100, _("Autorouting tracks")))
+	    {
+	      res.cancelled = true;
+	      goto done;
+	    }
+	}
+    }
+#ifndef NET_HEAP
+  END_LOOP;
+#endif
+  res.completely_routed = ros.net_completely_routed;
 
-	  /* the loop here ensures that we get to all subnets even if
-	   * some of them are unreachable from the first subnet. */
-	  LIST_LOOP (net, same_net, p);
-	  {
+  /* reset subnet_processed flags */
+  LIST_LOOP (net, same_net, p);
+  {
+    p->flags.subnet_processed = 0;
+  }
+  END_LOOP;
+
+done:
 #ifdef NET_HEAP
-	    BoxType b = shrink_routebox (p);
-	    /* using a heap allows us to start from smaller objects and
-	     * end at bigger ones. also prefer to start at planes, then pads */
-	    heap_insert (net_heap, (float) (b.X2 - b.X1) *
-#if defined(ROUTE_RANDOMIZED)
-			 (0.3 + rand () / (RAND_MAX + 1.0)) *
+  heap_destroy (&net_heap);
 #endif
-			 (b.Y2 - b.Y1) * (p->type == PLANE ?
-					  -1 : (p->type ==
-						PAD ? 1 : 10)), p);
+  res.seconds = perf_now () - start;
+  return res;
+}
+
+/*!
+ * \brief Names a net after one of its pins or pads.
+ */
+static const char *
+net_name (routebox_t * net)
+{
+  routebox_t *p;
+  char *name;
+
+  LIST_LOOP (net, same_net, p);
+  {
+    name = NULL;
+    if (p->type == PIN)
+      name = ConnectionName (PIN_TYPE, p->parent.pin->Element,
+			     p->parent.pin);
+    else if (p->type == PAD)
+      name = ConnectionName (PAD_TYPE, p->parent.pad->Element,
+			     p->parent.pad);
+    if (name)
+      return name;
+  }
+  END_LOOP;
+  return "";
+}
+
+/*!
+ * \brief Writes a line of per-net statistics to route_stats.
+ */
+static void
+write_net_stats (routebox_t * net, struct routenet_result *res)
+{
+  if (!route_stats || res->skipped)
+    return;
+  fprintf (route_stats,
+	   "%d,\"%s\",%d,%d,%d,%d,%d,%d,%d,%d,%d,%.6f,%.0f,%d\n",
+	   AutoRouteParameters.pass - 1, net_name (net),
+	   AutoRouteParameters.pass > 1, res->searches, res->routed,
+	   res->conflicts, res->failed, res->edges_expanded,
+	   res->edges_pruned, res->heap_peak, res->vias_tried, res->seconds,
+	   res->cost, res->completely_routed);
+}
+
+/*!
+ * \brief Queues a routed net for the next pass.
+ */
+static void
+finish_net (routebox_t * net, struct routenet_result *res,
+	    heap_t * next_pass, cost_t * this_cost)
+{
+  write_net_stats (net, res);
+  if (res->skipped)
+    {
+      heap_insert (next_pass, 0, net);
+      return;
+    }
+  if (!res->completely_routed)
+    net->flags.is_bad = 1;	/* don't skip this the next round */
+
+  /* Route easiest nets from this pass first on next pass.
+   * This works best because it's likely that the hardest
+   * is the last one routed (since it has the most obstacles)
+   * but it will do no good to rip it up and try it again
+   * without first changing any of the other routes
+   */
+  heap_insert (next_pass, res->cost, net);
+  if (res->cost < EXPENSIVE)
+    *this_cost += res->cost;
+}
+
+static BoxType
+net_bounds (routebox_t * net)
+{
+  BoxType bb = shrink_routebox (net);
+  routebox_t *p;
+
+  LIST_LOOP (net, same_net, p);
+  {
+    MAKEMIN (bb.X1, p->sbox.X1);
+    MAKEMIN (bb.Y1, p->sbox.Y1);
+    MAKEMAX (bb.X2, p->sbox.X2);
+    MAKEMAX (bb.Y2, p->sbox.Y2);
+  }
+  END_LOOP;
+  return bb;
+}
+
+#ifdef ROUTE_WORKERS
+/* ---------------------------------------------------------------------------
+ * Parallel speculative routing.
+ *
+ * With --autoroute-jobs N, RouteAll () takes up to N nets whose bounding
+ * boxes are apart from the heap and routes each of them in a forked
+ * worker process.  A worker sees the route data as it was when it was
+ * forked, routes its net exactly like the sequential code, and sends
+ * back the route boxes it added, the subnets it joined and the traces
+ * of other nets it found in conflict.
+ *
+ * The parent then commits the results in heap order.  A result is only
+ * applied if none of its boxes come close to the boxes committed
+ * earlier in the same wave; otherwise the net is routed again by the
+ * parent against the current data.  Forked processes are used instead
+ * of threads since the router keeps much of its state in static
+ * variables and mutates the shared trees even while searching.
+ */
+
+#define MAX_ROUTE_JOBS 64
+
+/*!
+ * \brief A route box added by a worker.
+ */
+struct worker_box
+{
+  BoxType box, sbox;
+  routebox_t *anchor;		/*!< Preexisting box of the same subnet. */
+  int via;			/*!< Index of the via of a VIA_SHADOW. */
+  unsigned short group, layer;
+  etype type;
+  direction_t came_from;
+  unsigned char pass;
+  unsigned is_odd:1;
+  unsigned is_bad:1;
+  unsigned circular:1;
+  unsigned nonstraight:1;
+  unsigned bl_to_ur:1;
+};
+
+/*!
+ * \brief Two preexisting boxes of the net that ended up in the same
+ * subnet.
+ */
+struct worker_merge
+{
+  routebox_t *box, *anchor;
+};
+
+struct worker_header
+{
+  struct routenet_result res;
+  int total_subnets, routed_subnets, conflict_subnets, failed;
+  int total_nets_routed;
+  int n_boxes, n_merges, n_bad;
+  unsigned long perf[PERF_COUNTER_COUNT];	/*!< Counted by the worker. */
+};
+
+struct route_worker
+{
+  routebox_t *net;
+  routebox_t **old;		/*!< Sorted boxes of the net at fork time. */
+  int n_old;
+  pid_t pid;
+  int fd;
+};
+
+static int
+ptr_cmp (const void *a, const void *b)
+{
+  const routebox_t *pa = *(routebox_t * const *) a;
+  const routebox_t *pb = *(routebox_t * const *) b;
+
+  return pa < pb ? -1 : pa > pb;
+}
+
+static int
+old_index (struct route_worker *w, routebox_t * rb)
+{
+  routebox_t **found = (routebox_t **) bsearch (&rb, w->old, w->n_old,
+						sizeof (*w->old), ptr_cmp);
+
+  return found ? found - w->old : -1;
+}
+
+static bool
+write_all (int fd, const void *buf, size_t n)
+{
+  const char *p = (const char *) buf;
+
+  while (n > 0)
+    {
+      ssize_t k = write (fd, p, n);
+
+      if (k < 0 && errno == EINTR)
+	continue;
+      if (k <= 0)
+	return false;
+      p += k;
+      n -= k;
+    }
+  return true;
+}
+
+static bool
+read_all (int fd, void *buf, size_t n)
+{
+  char *p = (char *) buf;
+
+  while (n > 0)
+    {
+      ssize_t k = read (fd, p, n);
+
+      if (k < 0 && errno == EINTR)
+	continue;
+      if (k <= 0)
+	return false;
+      p += k;
+      n -= k;
+    }
+  return true;
+}
+
+/*!
+ * \brief Body of a worker process: routes the net and writes the
+ * result to \a w->fd.
+ */
+static void
+route_worker_main (routedata_t * rd, struct route_worker *w, int pass,
+		   struct routeall_status *ras)
+{
+  struct worker_header hdr;
+  struct routeall_status before = *ras;
+  unsigned long perf_before[PERF_COUNTER_COUNT];
+  vector_t *added = vector_create ();
+  struct worker_box *boxes;
+  struct worker_merge *merges;
+  routebox_t **bad;
+  char *seen;
+  routebox_t *p, *q;
+  int i, j, n_merges = 0;
+
+  in_route_worker = true;
+  worker_bad = vector_create ();
+  memcpy (perf_before, perf_counter, sizeof (perf_before));
+  InitAutoRouteParameters (pass, w->net->style, pass < passes,
+			   pass > passes, pass == passes + smoothes);
+  hdr.res = route_net (rd, w->net, pass, ras, 0, 1);
+
+  LIST_LOOP (w->net, same_net, p);
+  if (old_index (w, p) < 0)
+    vector_append (added, p);
+  END_LOOP;
+
+  boxes = (struct worker_box *) calloc (vector_size (added) + 1,
+					sizeof (*boxes));
+  merges = (struct worker_merge *) calloc (w->n_old + 1, sizeof (*merges));
+  seen = (char *) calloc (w->n_old + 1, 1);
+
+  for (i = 0; i < vector_size (added); i++)
+    {
+      struct worker_box *b = &boxes[i];
+
+      p = (routebox_t *) vector_element (added, i);
+      b->box = p->box;
+      b->sbox = p->sbox;
+      b->via = -1;
+      if (p->type == VIA_SHADOW)
+	for (j = 0; j < vector_size (added); j++)
+	  if (vector_element (added, j) == p->parent.via_shadow)
+	    b->via = j;
+      b->group = p->group;
+      b->layer = p->layer;
+      b->type = p->type;
+      b->came_from = p->came_from;
+      b->pass = p->pass;
+      b->is_odd = p->flags.is_odd;
+      b->is_bad = p->flags.is_bad;
+      b->circular = p->flags.circular;
+      b->nonstraight = p->flags.nonstraight;
+      b->bl_to_ur = p->flags.bl_to_ur;
+    }
+
+  /* Describe the subnets by the first preexisting box in each */
+  for (i = 0; i < w->n_old; i++)
+    {
+      if (seen[i])
+	continue;
+      LIST_LOOP (w->old[i], same_subnet, q);
+      {
+	j = old_index (w, q);
+	if (j >= 0)
+	  {
+	    seen[j] = 1;
+	    if (j != i)
+	      {
+		merges[n_merges].box = q;
+		merges[n_merges++].anchor = w->old[i];
+	      }
 	  }
-	  END_LOOP;
-	  ros.net_completely_routed = 0;
-	  while (!heap_is_empty (net_heap))
-	    {
-	      p = (routebox_t *) heap_remove_smallest (net_heap);
+	else
+	  for (j = 0; j < vector_size (added); j++)
+	    if (vector_element (added, j) == q)
+	      boxes[j].anchor = w->old[i];
+      }
+      END_LOOP;
+    }
+
+  hdr.total_subnets = ras->total_subnets - before.total_subnets;
+  hdr.routed_subnets = ras->routed_subnets - before.routed_subnets;
+  hdr.conflict_subnets = ras->conflict_subnets - before.conflict_subnets;
+  hdr.failed = ras->failed - before.failed;
+  hdr.total_nets_routed = ras->total_nets_routed - before.total_nets_routed;
+  hdr.n_boxes = vector_size (added);
+  hdr.n_merges = n_merges;
+  hdr.n_bad = vector_size (worker_bad);
+  perf_counters_since (hdr.perf, perf_before);
+  bad = (routebox_t **) calloc (hdr.n_bad + 1, sizeof (*bad));
+  for (i = 0; i < hdr.n_bad; i++)
+    bad[i] = (routebox_t *) vector_element (worker_bad, i);
+
+  if (!write_all (w->fd, &hdr, sizeof (hdr))
+      || !write_all (w->fd, boxes, hdr.n_boxes * sizeof (*boxes))
+      || !write_all (w->fd, merges, hdr.n_merges * sizeof (*merges))
+      || !write_all (w->fd, bad, hdr.n_bad * sizeof (*bad)))
+    _exit (1);
+  _exit (0);
+}
+
+/*!
+ * \brief Collects the boxes of \a w->net that were not there when the
+ * worker was forked.
+ */
+static void
+collect_added (struct route_worker *w, vector_t * committed)
+{
+  routebox_t *p;
+
+  LIST_LOOP (w->net, same_net, p);
+  if (old_index (w, p) < 0)
+    vector_append (committed, p);
+  END_LOOP;
+}
+
+static bool
+wave_conflict (const struct worker_box *b, vector_t * committed)
+{
+  int i;
+
+  for (i = 0; i < vector_size (committed); i++)
+    {
+      routebox_t *c = (routebox_t *) vector_element (committed, i);
+
+      if (c->group == b->group && box_intersect (&c->box, &b->box))
+	return true;
+    }
+  return false;
+}
+
+/*!
+ * \brief Applies a worker result to the route data.
+ */
+static void
+apply_worker_result (routedata_t * rd, struct route_worker *w,
+		     struct worker_header *hdr, struct worker_box *boxes,
+		     struct worker_merge *merges, routebox_t ** bad,
+		     struct routeall_status *ras, vector_t * committed)
+{
+  routebox_t **made, *rb, *q;
+  bool joined;
+  int i;
+
+  for (i = 0; i < hdr->n_merges; i++)
+    {
+      joined = false;
+      LIST_LOOP (merges[i].anchor, same_subnet, q);
+      if (q == merges[i].box)
+	joined = true;
+      END_LOOP;
+      if (!joined)
+	MergeNets (merges[i].anchor, merges[i].box, SUBNET);
+    }
+
+  /* a via shadow may come before its via, so make all the boxes first */
+  made = (routebox_t **) calloc (hdr->n_boxes + 1, sizeof (*made));
+  for (i = 0; i < hdr->n_boxes; i++)
+    {
+      struct worker_box *b = &boxes[i];
+
+      rb = (routebox_t *) malloc (sizeof (*rb));
+      memset ((void *) rb, 0, sizeof (*rb));
+      init_const_box (rb, b->sbox.X1, b->sbox.Y1, b->sbox.X2, b->sbox.Y2,
+		      b->sbox.X1 - b->box.X1);
+      rb->group = b->group;
+      rb->layer = b->layer;
+      rb->type = b->type;
+      rb->came_from = b->came_from;
+      rb->pass = b->pass;
+      rb->flags.is_odd = b->is_odd;
+      rb->flags.is_bad = b->is_bad;
+      rb->flags.circular = b->circular;
+      rb->flags.nonstraight = b->nonstraight;
+      rb->flags.bl_to_ur = b->bl_to_ur;
+      rb->style = w->net->style;
+      made[i] = rb;
+    }
+  for (i = 0; i < hdr->n_boxes; i++)
+    {
+      struct worker_box *b = &boxes[i];
+
+      rb = made[i];
+      if (rb->type == VIA_SHADOW)
+	{
+	  assert (b->via >= 0 && b->via < hdr->n_boxes);
+	  rb->parent.via_shadow = made[b->via];
+	}
+      InitLists (rb);
+      MergeNets (rb, b->anchor, NET);
+      MergeNets (rb, b->anchor, SUBNET);
+      r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 1);
+      if (rb->type == VIA
+	  || (rb->type == LINE && AutoRouteParameters.use_vias))
+	mtspace_add (rd->mtspace, &rb->box, rb->flags.is_odd ? ODD : EVEN,
+		     rb->style->Keepaway);
+      if (rb->type == LINE)
+	usedGroup[rb->group] = true;
+      vector_append (committed, rb);
+    }
+  free (made);
+
+  for (i = 0; i < hdr->n_bad; i++)
+    bad[i]->flags.is_bad = 1;
+
+  ras->total_subnets += hdr->total_subnets;
+  ras->routed_subnets += hdr->routed_subnets;
+  ras->conflict_subnets += hdr->conflict_subnets;
+  ras->failed += hdr->failed;
+  ras->total_nets_routed += hdr->total_nets_routed;
+}
+
+/*!
+ * \brief Reads and applies the result of a worker.
+ *
+ * \return false if the net has to be routed again.
+ */
+static bool
+commit_worker (routedata_t * rd, struct route_worker *w, int pass,
+	       struct routeall_status *ras, vector_t * committed,
+	       struct routenet_result *res)
+{
+  struct worker_header hdr;
+  struct worker_box *boxes = NULL;
+  struct worker_merge *merges = NULL;
+  routebox_t **bad = NULL;
+  bool ok = false;
+  int i;
+
+  if (!read_all (w->fd, &hdr, sizeof (hdr)))
+    return false;
+  /* the work was done even if the result has to be thrown away */
+  perf_counters_merge (hdr.perf);
+  boxes = (struct worker_box *) calloc (hdr.n_boxes + 1, sizeof (*boxes));
+  merges = (struct worker_merge *) calloc (hdr.n_merges + 1,
+					   sizeof (*merges));
+  bad = (routebox_t **) calloc (hdr.n_bad + 1, sizeof (*bad));
+  if (!read_all (w->fd, boxes, hdr.n_boxes * sizeof (*boxes))
+      || !read_all (w->fd, merges, hdr.n_merges * sizeof (*merges))
+      || !read_all (w->fd, bad, hdr.n_bad * sizeof (*bad)))
+    goto out;
+
+  for (i = 0; i < hdr.n_boxes; i++)
+    if (boxes[i].anchor == NULL || wave_conflict (&boxes[i], committed))
+      goto out;
+
+  InitAutoRouteParameters (pass, w->net->style, pass < passes,
+			   pass > passes, pass == passes + smoothes);
+  apply_worker_result (rd, w, &hdr, boxes, merges, bad, ras, committed);
+  *res = hdr.res;
+  ok = true;
+
+out:
+  free (boxes);
+  free (merges);
+  free (bad);
+  return ok;
+}
+
+/*!
+ * \brief Routes a wave of nets with far apart bounding boxes in worker
+ * processes and commits the results.
+ *
+ * \return true if the user cancelled.
+ */
+static bool
+route_wave (routedata_t * rd, routebox_t ** wave, int n, int pass,
+	    struct routeall_status *ras, heap_t * next_pass,
+	    cost_t * this_cost, int *this_heap_item, int this_heap_size)
+{
+  struct route_worker w[MAX_ROUTE_JOBS];
+  vector_t *committed = vector_create ();
+  bool cancelled = false;
+  routebox_t *p;
+  int fds[2], k, status;
+
+  fflush (NULL);
+  for (k = 0; k < n; k++)
+    {
+      w[k].net = wave[k];
+      w[k].n_old = 0;
+      LIST_LOOP (wave[k], same_net, p);
+      w[k].n_old++;
+      END_LOOP;
+      w[k].old = (routebox_t **) malloc (w[k].n_old * sizeof (*w[k].old));
+      w[k].n_old = 0;
+      LIST_LOOP (wave[k], same_net, p);
+      w[k].old[w[k].n_old++] = p;
+      END_LOOP;
+      qsort (w[k].old, w[k].n_old, sizeof (*w[k].old), ptr_cmp);
+
+      w[k].pid = -1;
+      w[k].fd = -1;
+      if (pipe (fds) != 0)
+	continue;
+      w[k].pid = fork ();
+      if (w[k].pid == 0)
+	{
+	  close (fds[0]);
+	  w[k].fd = fds[1];
+	  route_worker_main (rd, &w[k], pass, ras);
+	}
+      close (fds[1]);
+      if (w[k].pid < 0)
+	close (fds[0]);
+      else
+	w[k].fd = fds[0];
+    }
+
+  for (k = 0; k < n; k++)
+    {
+      struct routenet_result res;
+      bool done = false;
+
+      if (w[k].pid > 0)
+	{
+	  if (!cancelled)
+	    done = commit_worker (rd, &w[k], pass, ras, committed, &res);
+	  close (w[k].fd);
+	  waitpid (w[k].pid, &status, 0);
+	}
+      if (!cancelled && !done)
+	{
+	  /* in conflict with an earlier net of the wave: route it again */
+	  PERF_COUNT (PERF_ROUTE_REQUEUES, 1);
+	  InitAutoRouteParameters (pass, w[k].net->style, pass < passes,
+				   pass > passes, pass == passes + smoothes);
+	  res = route_net (rd, w[k].net, pass, ras, *this_heap_item,
+			   this_heap_size);
+	  collect_added (&w[k], committed);
+	  cancelled = res.cancelled;
+	}
+      free (w[k].old);
+      if (cancelled)
+	continue;
+
+      finish_net (w[k].net, &res, next_pass, this_cost);
+      (*this_heap_item)++;
+      if (gui->progress (calculate_progress (*this_heap_item, this_heap_size,
+					     ras) * 100., 100,
+			 _("Autorouting tracks")))
+	cancelled = true;
+    }
+
+  vector_destroy (&committed);
+  return cancelled;
+}
+#endif /* ROUTE_WORKERS */
+
+struct routeall_status
+RouteAll (routedata_t * rd)
+{
+  struct routeall_status ras;
+  struct routenet_result res;
+  heap_t *this_pass, *next_pass, *tmp;
+  routebox_t *net;
+  cost_t last_cost = 0, this_cost = 0;
+  int i, jobs = 1;
+  int this_heap_size;
+  int this_heap_item;
+#ifdef ROUTE_WORKERS
+  routebox_t *wave[MAX_ROUTE_JOBS];
+  BoxType wave_box[MAX_ROUTE_JOBS];
+  int n, k;
+
+  /* the workers can't draw, and the debug drawing is not shared */
+  jobs = MAX (1, MIN (Settings.AutorouteJobs, MAX_ROUTE_JOBS));
+  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+    jobs = 1;
+#ifdef ROUTE_DEBUG
+  jobs = 1;
+#endif
 #endif
-	      if (!p->flags.fixed || p->flags.subnet_processed ||
-		  p->type == OTHER)
-		continue;
 
-	      while (!ros.net_completely_routed)
-		{
-		  double percent;
+  /* initialize heap for first pass; 
+   * do smallest area first; that makes
+   * the subsequent costs more representative */
+  this_pass = heap_create ();
+  next_pass = heap_create ();
+  LIST_LOOP (rd->first_net, different_net, net);
+  {
+    BoxType bb = net_bounds (net);
+    heap_insert (this_pass, (double) (bb.X2 - bb.X1) * (bb.Y2 - bb.Y1), net);
+  }
+  END_LOOP;
 
-		  assert (no_expansion_boxes (rd));
-		  /* FIX ME: the number of edges to examine should be in autoroute parameters
-		   * i.e. the 2000 and 800 hard-coded below should be controllable by the user
-		   */
-		  ros =
-		    RouteOne (rd, p, NULL,
-			      ((AutoRouteParameters.
-				is_smoothing ? 2000 : 800) * (i +
-							      1)) *
-			      routing_layers);
-		  total_net_cost += ros.best_route_cost;
-		  if (ros.found_route)
-		    {
-		      if (ros.route_had_conflicts)
-			ras.conflict_subnets++;
-		      else
-			{
-			  ras.routed_subnets++;
-			  ras.total_nets_routed++;
-			}
-		    }
-		  else
-		    {
-		      if (!ros.net_completely_routed)
-			ras.failed++;
-		      /* don't bother trying any other source in this subnet */
-		      LIST_LOOP (p, same_subnet, pp);
-		      pp->flags.subnet_processed = 1;
-		      END_LOOP;
+  ras.total_nets_routed = 0;
+  /* refinement/finishing passes */
+  for (i = 0; i <= passes + smoothes; i++)
+    {
+#ifdef ROUTE_VERBOSE
+      if (i > 0 && i <= passes)
+	printf ("--------- STARTING REFINEMENT PASS %d ------------\n", i);
+      else if (i > passes)
+	printf ("--------- STARTING SMOOTHING PASS %d -------------\n",
+		i - passes);
+#endif
+      ras.total_subnets = ras.routed_subnets = ras.conflict_subnets =
+	ras.failed = ras.ripped = 0;
+      assert (heap_is_empty (next_pass));
+
+      this_heap_size = heap_size (this_pass);
+      this_heap_item = 0;
+      while (!heap_is_empty (this_pass))
+	{
+#ifdef ROUTE_DEBUG
+	  if (aabort)
+	    break;
+#endif
+	  net = (routebox_t *) heap_remove_smallest (this_pass);
+	  if (!prepare_net (rd, net, i, &ras))
+	    {
+	      heap_insert (next_pass, 0, net);
+	      this_heap_item++;
+	      continue;
+	    }
+
+#ifdef ROUTE_WORKERS
+	  if (jobs > 1)
+	    {
+	      /* gather nets far enough apart to be routed independently */
+	      n = 0;
+	      wave[n] = net;
+	      wave_box[n] = net_bounds (net);
+	      wave_box[n] = bloat_box (&wave_box[n], rd->max_bloat);
+	      n++;
+	      while (n < jobs && !heap_is_empty (this_pass))
+		{
+		  BoxType bb;
+
+		  /* a net overlapping the wave starts the next one; its
+		     bounds still include the traces it is about to lose,
+		     so this errs on the safe side */
+		  net = (routebox_t *) heap_peek_smallest (this_pass);
+		  bb = net_bounds (net);
+		  bb = bloat_box (&bb, rd->max_bloat);
+		  for (k = 0; k < n; k++)
+		    if (box_intersect (&bb, &wave_box[k]))
 		      break;
-		    }
-		  /* note that we can infer nothing about ras.total_subnets based
-		   * on the number of calls to RouteOne, because we may be unable
-		   * to route a net from a particular starting point, but perfectly
-		   * able to route it from some other. */
-		  percent = calculate_progress (this_heap_item, this_heap_size, &ras);
-		  request_cancel = gui->progress (percent * 100., 100,
-						  _("Autorouting tracks"));
-		  if (request_cancel)
+		  if (k < n)
+		    break;
+		  heap_remove_smallest (this_pass);
+		  if (!prepare_net (rd, net, i, &ras))
 		    {
-		      ras.total_nets_routed = 0;
-		      ras.conflict_subnets = 0;
-		      Message ("Autorouting cancelled\n");
-		      goto out;
+		      heap_insert (next_pass, 0, net);
+		      this_heap_item++;
+		      continue;
 		    }
+		  bb = net_bounds (net);
+		  bb = bloat_box (&bb, rd->max_bloat);
+		  wave[n] = net;
+		  wave_box[n++] = bb;
+		}
+	      if (n > 1)
+		{
+		  if (route_wave (rd, wave, n, i, &ras, next_pass, &this_cost,
+				  &this_heap_item, this_heap_size))
+		    goto cancel;
+		  continue;
 		}
+	      net = wave[0];
+	      InitAutoRouteParameters (i, net->style, i < passes, i > passes,
+				       i == passes + smoothes);
 	    }
-#ifndef NET_HEAP
-	  END_LOOP;
 #endif
-	  if (!ros.net_completely_routed)
-	    net->flags.is_bad = 1;	/* don't skip this the next round */
-
-	  /* Route easiest nets from this pass first on next pass.
-	   * This works best because it's likely that the hardest
-	   * is the last one routed (since it has the most obstacles)
-	   * but it will do no good to rip it up and try it again
-	   * without first changing any of the other routes
-	   */
-	  heap_insert (next_pass, total_net_cost, net);
-	  if (total_net_cost < EXPENSIVE)
-	    this_cost += total_net_cost;
-	  /* reset subnet_processed flags */
-	  LIST_LOOP (net, same_net, p);
+
+	  res = route_net (rd, net, i, &ras, this_heap_item, this_heap_size);
+	  if (res.cancelled)
+	    goto cancel;
+	  finish_net (net, &res, next_pass, &this_cost);
+	  this_heap_item++;
+	}
+      /* remember where the conflicts of this pass were */
+      if (Settings.AutorouteNegotiate && i < passes)
+	{
+	  LIST_LOOP (rd->first_net, different_net, net);
 	  {
-	    p->flags.subnet_processed = 0;
+	    routebox_t *p;
+
+	    LIST_LOOP (net, same_net, p);
+	    if (p->flags.is_bad && !p->flags.fixed)
+	      history_add (p);
+	    END_LOOP;
 	  }
 	  END_LOOP;
 	}
@@ -5018,13 +6433,16 @@ RouteAll (routedata_t * rd)
 
   Message ("%d of %d nets successfully routed.\n",
 	   ras.routed_subnets, ras.total_subnets);
+  goto out;
+
+cancel:
+  ras.total_nets_routed = 0;
+  ras.conflict_subnets = 0;
+  Message ("Autorouting cancelled\n");
 
 out:
   heap_destroy (&this_pass);
   heap_destroy (&next_pass);
-#ifdef NET_HEAP
-  heap_destroy (&net_heap);
-#endif
 
   /* no conflicts should be left at the end of the process. */
   assert (ras.conflict_subnets == 0);
@@ -5224,8 +6642,14 @@ IronDownAllUnfixedPaths (routedata_t * rd)
   return changed;
 }
 
+/*!
+ * \brief Autoroute all rats, or the selected ones.
+ *
+ * If \a stats_file is not \c NULL, a line of statistics is written to
+ * it for every net routed in every pass, as comma separated values.
+ */
 bool
-AutoRoute (bool selected)
+AutoRoute (bool selected, const char *stats_file)
 {
   bool changed = false;
   routedata_t *rd;
@@ -5256,7 +6680,22 @@ AutoRoute (bool selected)
     }
   if (PCB->Data->RatN == 0)
     return (false);
+  passes = Settings.AutorouteNegotiate ? NEGOTIATED_PASSES : 12;
+  if (stats_file)
+    {
+      route_stats = fopen (stats_file, "w");
+      if (!route_stats)
+	{
+	  Message (_("Can't open %s for writing: %s\n"), stats_file,
+		   strerror (errno));
+	  return (false);
+	}
+      fprintf (route_stats, "pass,net,ripped,searches,routed,conflicts,"
+	       "failed,edges,pruned,heap_peak,vias,seconds,cost,complete\n");
+    }
   rd = CreateRouteData ();
+  if (Settings.AutorouteNegotiate)
+    history_create ();
 
   if (1)
     {
@@ -5298,7 +6737,7 @@ AutoRoute (bool selected)
                   /* route exactly one net, without allowing conflicts */
                   InitAutoRouteParameters (0, a->style, false, true, true);
                   /* hace planes work better as sources than targets */
-                  changed = RouteOne (rd, a, b, 150000).found_route || changed;
+                  changed = RouteOne (rd, a, b, 150000, -1).found_route || changed;
                   goto donerouting;
                 }
 	    }
@@ -5414,7 +6853,12 @@ donerouting:
     changed = IronDownAllUnfixedPaths (rd);
   Message ("Total added wire length = %$mS, %d vias added\n",
 	   (Coord) total_wire_length, total_via_count);
-  DestroyRouteData (&rd);
+  ReleaseRouteData (&rd);
+  if (route_stats)
+    {
+      fclose (route_stats);
+      route_stats = NULL;
+    }
   if (changed)
     {
       SaveUndoSerialNumber ();
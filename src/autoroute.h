@@ -39,6 +39,8 @@
 
 #include "global.h"
 
-bool AutoRoute (bool);
+bool AutoRoute (bool, const char *);
+void AutoRouteObjectChanged (int, void *, void *, bool);
+void AutoRouteForget (void);
 
 #endif
@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <math.h>
+#include <sys/stat.h>
 
 #include "global.h"
 
@@ -47,10 +48,12 @@
 #include "crosshair.h"
 #include "data.h"
 #include "error.h"
+#include "file.h"
 #include "mymem.h"
 #include "mirror.h"
 #include "misc.h"
 #include "parse_l.h"
+#include "perf.h"
 #include "polygon.h"
 #include "rats.h"
 #include "rotate.h"
@@ -467,6 +470,128 @@ AddSelectedToBuffer (BufferType *Buffer, Coord X, Coord Y, bool LeaveSelected)
   ExtraFlag = 0;
 }
 
+/*!
+ * \brief Number of parsed footprints kept by ParseElementCached().
+ */
+#define ELEMENT_CACHE_SIZE 64
+
+/*!
+ * \brief A parsed footprint kept for the next time it is loaded.
+ */
+typedef struct
+{
+  char *Key;			/*!< 'f' or 'l' followed by the name. */
+  time_t MTime;			/*!< Of the file, 0 for library entries. */
+  off_t Size;			/*!< Of the file, 0 for library entries. */
+  DataType *Data;		/*!< Holds the element. */
+} ElementCacheEntryType;
+
+static GHashTable *element_cache = NULL;	/* key -> link in element_lru */
+static GQueue *element_lru = NULL;	/* most recently used first */
+
+static void
+FreeElementCacheEntry (ElementCacheEntryType *entry)
+{
+  FreeDataMemory (entry->Data);
+  free (entry->Data);
+  free (entry->Key);
+  free (entry);
+}
+
+/*!
+ * \brief Returns true if \a Data holds a single element and nothing else.
+ */
+static bool
+IsSingleElement (DataType *Data)
+{
+  int i;
+
+  if (Data->ElementN != 1 || Data->ViaN || Data->RatN)
+    return false;
+  for (i = 0; i < MAX_ALL_LAYER; i++)
+    if (Data->Layer[i].LineN || Data->Layer[i].ArcN
+	|| Data->Layer[i].TextN || Data->Layer[i].PolygonN)
+      return false;
+  return true;
+}
+
+/*!
+ * \brief Parses an element file or library entry into \a Data.
+ *
+ * Placing parts from a parts list loads the same few footprints over
+ * and over, and for M4 library entries every load runs m4.  The last
+ * ELEMENT_CACHE_SIZE footprints are therefore kept and copied instead
+ * of being parsed again.  Element files are parsed again when their
+ * modification time or size changed.
+ *
+ * \return the same as the parser.
+ */
+static int
+ParseElementCached (DataType *Data, char *Name, bool FromFile)
+{
+  ElementCacheEntryType *entry;
+  struct stat buffer;
+  char *key;
+  GList *link;
+  int result;
+
+  if (element_cache == NULL)
+    {
+      element_cache = g_hash_table_new (g_str_hash, g_str_equal);
+      element_lru = g_queue_new ();
+    }
+
+  memset (&buffer, 0, sizeof (buffer));
+  if (FromFile && stat (Name, &buffer) != 0)
+    return ParseElementFile (Data, Name);
+
+  key = (char *) malloc (strlen (Name) + 2);
+  sprintf (key, "%c%s", FromFile ? 'f' : 'l', Name);
+
+  if ((link = (GList *) g_hash_table_lookup (element_cache, key)) != NULL)
+    {
+      entry = (ElementCacheEntryType *) link->data;
+      g_queue_unlink (element_lru, link);
+      if (entry->MTime == buffer.st_mtime && entry->Size == buffer.st_size)
+	{
+	  g_queue_push_head_link (element_lru, link);
+	  CopyElementLowLevel (Data, entry->Data->Element->data, false,
+			       0, 0, 0);
+	  PERF_COUNT (PERF_ELEMENT_CACHE_HITS, 1);
+	  free (key);
+	  return 0;
+	}
+      /* the file changed */
+      g_hash_table_remove (element_cache, entry->Key);
+      g_list_free (link);
+      FreeElementCacheEntry (entry);
+    }
+
+  result = FromFile ? ParseElementFile (Data, Name)
+    : ParseLibraryEntry (Data, Name);
+  if (result || !IsSingleElement (Data))
+    {
+      free (key);
+      return result;
+    }
+
+  if (g_queue_get_length (element_lru) >= ELEMENT_CACHE_SIZE)
+    {
+      entry = (ElementCacheEntryType *) g_queue_pop_tail (element_lru);
+      g_hash_table_remove (element_cache, entry->Key);
+      FreeElementCacheEntry (entry);
+    }
+  entry = (ElementCacheEntryType *) calloc (1, sizeof (ElementCacheEntryType));
+  entry->Key = key;
+  entry->MTime = buffer.st_mtime;
+  entry->Size = buffer.st_size;
+  entry->Data = CreateNewBuffer ();
+  CopyElementLowLevel (entry->Data, Data->Element->data, false, 0, 0, 0);
+  g_queue_push_head (element_lru, entry);
+  g_hash_table_insert (element_cache, entry->Key, element_lru->head);
+  return 0;
+}
+
 /*!
  * \brief Loads element data from file/library into buffer.
  *
@@ -483,7 +608,7 @@ LoadElementToBuffer (BufferType *Buffer, char *Name, bool FromFile)
   ClearBuffer (Buffer);
   if (FromFile)
     {
-      if (!ParseElementFile (Buffer->Data, Name))
+      if (!ParseElementCached (Buffer->Data, Name, true))
 	{
 	  if (Settings.ShowBottomSide)
 	    SwapBuffer (Buffer);
@@ -504,7 +629,7 @@ LoadElementToBuffer (BufferType *Buffer, char *Name, bool FromFile)
     }
   else
     {
-      if (!ParseLibraryEntry (Buffer->Data, Name)
+      if (!ParseElementCached (Buffer->Data, Name, false)
 	  && Buffer->Data->ElementN != 0)
 	{
 	  element = Buffer->Data->Element->data;
@@ -579,6 +704,7 @@ make_footprint_hash ()
   char *fp;
   int num_entries = 0;
 
+  EnsureLibraryContents ();
   clear_footprint_hash ();
 
   for (i=0; i<Library.MenuN; i++)
@@ -954,12 +954,50 @@ CreateNewLineInSymbol (SymbolType *Symbol,
  *
  * Checks directories given as colon separated list by resource fontPath
  * if the fonts filename doesn't contain a directory component.
+ *
+ * The file is only parsed the first time; every new PCB (including the
+ * one created for each loaded layout) gets a copy of that font.
  */
 void
 CreateDefaultFont (PCBType *pcb)
 {
-  if (ParseFont (&pcb->Font, Settings.FontFile))
-    Message (_("Can't find font-symbol-file '%s'\n"), Settings.FontFile);
+  static FontType font;
+  static char *font_file = NULL;
+  static int status;
+  int i;
+
+  if (font_file == NULL || NSTRCMP (font_file, Settings.FontFile) != 0)
+    {
+      for (i = 0; i <= MAX_FONTPOSITION; i++)
+	free (font.Symbol[i].Line);
+      memset (&font, 0, sizeof (font));
+      free (font_file);
+      font_file = Settings.FontFile ? strdup (Settings.FontFile) : NULL;
+      status = ParseFont (&font, Settings.FontFile);
+    }
+
+  if (status)
+    {
+      Message (_("Can't find font-symbol-file '%s'\n"), Settings.FontFile);
+      return;
+    }
+
+  pcb->Font = font;
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    {
+      SymbolType *symbol = &pcb->Font.Symbol[i];
+
+      if (symbol->LineN == 0)
+	{
+	  symbol->Line = NULL;
+	  symbol->LineMax = 0;
+	  continue;
+	}
+      symbol->Line = (LineType *) malloc (symbol->LineN * sizeof (LineType));
+      memcpy (symbol->Line, font.Symbol[i].Line,
+	      symbol->LineN * sizeof (LineType));
+      symbol->LineMax = symbol->LineN;
+    }
 }
 
 /*!
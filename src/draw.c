@@ -49,6 +49,7 @@
 #include "rtree.h"
 #include "search.h"
 #include "select.h"
+#include "perf.h"
 #include "print.h"
 
 #ifdef HAVE_LIBDMALLOC
@@ -73,10 +74,25 @@
  * some local identifiers
  */
 static BoxType Block = {MAXINT, MAXINT, -MAXINT, -MAXINT};
+static int draw_suspended = 0;
+static bool redraw_pending = false;
 
 static int doing_pinout = 0;
 static bool doing_assy = false;
 
+/* ---------------------------------------------------------------------------
+ * level of detail: while the GUI draws the board with Settings.DrawLOD
+ * set, lod_pixel is the size of a screen pixel in board units, otherwise
+ * it is 0 and everything is drawn at full detail.
+ */
+static Coord lod_pixel = 0;
+
+#define LOD_TEXT_PIXELS		3	/* text lower than this is not drawn */
+#define LOD_RECT_PIXELS		2	/* objects smaller than this become rectangles */
+
+#define LOD_BELOW(size, pixels) \
+  (lod_pixel > 0 && (size) < (pixels) * lod_pixel)
+
 /* ---------------------------------------------------------------------------
  * some local prototypes
  */
@@ -123,11 +139,23 @@ AddPart (void *b)
 
 /*!
  * \brief Initiate the actual redrawing of the updated area.
+ *
+ * While drawing is suspended the area just keeps growing and is
+ * invalidated by the first Draw() after ResumeDraw(); a Redraw()
+ * requested meanwhile turns that into a full redraw.
  */
 void
 Draw (void)
 {
-  if (Block.X1 <= Block.X2 && Block.Y1 <= Block.Y2)
+  if (draw_suspended)
+    return;
+
+  if (redraw_pending)
+    {
+      redraw_pending = false;
+      gui->invalidate_all ();
+    }
+  else if (Block.X1 <= Block.X2 && Block.Y1 <= Block.Y2)
     gui->invalidate_lr (Block.X1, Block.X2, Block.Y1, Block.Y2);
 
   /* shrink the update block */
@@ -135,12 +163,91 @@ Draw (void)
   Block.X2 = Block.Y2 = -MAXINT;
 }
 
+/*!
+ * \brief Turn Draw() into a no-op so a batch of changes ends up as one
+ * combined invalidate.  Calls nest.
+ */
+void
+SuspendDraw (void)
+{
+  draw_suspended++;
+}
+
+/*!
+ * \brief Undo one SuspendDraw().
+ *
+ * This does not draw by itself; the caller decides whether to call
+ * Draw() for the accumulated area.
+ */
+void
+ResumeDraw (void)
+{
+  if (draw_suspended > 0)
+    draw_suspended--;
+}
+
+/*!
+ * \brief Returns the size of a screen pixel if the current drawing may
+ * be simplified, or 0 if it must be drawn at full detail.
+ */
+Coord
+DrawLODPixel (void)
+{
+  return lod_pixel;
+}
+
+/*!
+ * \brief Returns true if a text with the given scale is too small to
+ * read at the current level of detail.
+ */
+static bool
+lod_skip_text (int scale)
+{
+  if (!LOD_BELOW (SCALE_TEXT (FONT_CAPHEIGHT, scale), LOD_TEXT_PIXELS))
+    return false;
+  PERF_COUNT (PERF_DRAW_LOD, 1);
+  return true;
+}
+
+/*!
+ * \brief Draws an object spanning the given box as a filled rectangle
+ * if it is too small to show any detail.
+ *
+ * \return true if the object was drawn.
+ */
+static bool
+lod_draw_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  if (!LOD_BELOW (x2 - x1, LOD_RECT_PIXELS)
+      || !LOD_BELOW (y2 - y1, LOD_RECT_PIXELS))
+    return false;
+  PERF_COUNT (PERF_DRAW_LOD, 1);
+  gui->graphics->fill_rect (gc, x1, y1, x2, y2);
+  return true;
+}
+
+static bool
+lod_draw_line (hidGC gc, LineType *line)
+{
+  Coord w = line->Thickness / 2;
+
+  return lod_draw_rect (gc, MIN (line->Point1.X, line->Point2.X) - w,
+			MIN (line->Point1.Y, line->Point2.Y) - w,
+			MAX (line->Point1.X, line->Point2.X) + w,
+			MAX (line->Point1.Y, line->Point2.Y) + w);
+}
+
 /*!
  * \brief Redraws all the data by the event handlers.
  */
 void
 Redraw (void)
 {
+  if (draw_suspended)
+    {
+      redraw_pending = true;
+      return;
+    }
   gui->invalidate_all ();
 }
 
@@ -169,11 +276,14 @@ _draw_pv_name (PinType *pv)
       box.Y1 = pv->Y - pv->Thickness    / 2 + Settings.PinoutTextOffsetY;
     }
 
-  gui->graphics->set_color (Output.fgGC, PCB->PinNameColor);
-
   text.Flags = NoFlags ();
   /* Set font height to approx 56% of pin thickness */
   text.Scale = 56 * pv->Thickness / FONT_CAPHEIGHT;
+  if (lod_skip_text (text.Scale))
+    return;
+
+  gui->graphics->set_color (Output.fgGC, PCB->PinNameColor);
+
   text.X = box.X1;
   text.Y = box.Y1;
   text.Direction = vert ? 1 : 0;
@@ -188,10 +298,18 @@ _draw_pv_name (PinType *pv)
 static void
 _draw_pv (PinType *pv, bool draw_hole)
 {
-  if (TEST_FLAG (THINDRAWFLAG, PCB))
-    gui->graphics->thindraw_pcb_pv (Output.fgGC, Output.fgGC, pv, draw_hole, false);
-  else
-    gui->graphics->fill_pcb_pv (Output.fgGC, Output.bgGC, pv, draw_hole, false);
+  Coord r = pv->Thickness / 2;
+
+  /* Pins and vias too small to show their hole become squares */
+  if (TEST_FLAG (HOLEFLAG, pv)
+      || !lod_draw_rect (Output.fgGC, pv->X - r, pv->Y - r,
+                         pv->X + r, pv->Y + r))
+    {
+      if (TEST_FLAG (THINDRAWFLAG, PCB))
+        gui->graphics->thindraw_pcb_pv (Output.fgGC, Output.fgGC, pv, draw_hole, false);
+      else
+        gui->graphics->fill_pcb_pv (Output.fgGC, Output.bgGC, pv, draw_hole, false);
+    }
 
   if ((!TEST_FLAG (HOLEFLAG, pv) && TEST_FLAG (DISPLAYNAMEFLAG, pv)) || doing_pinout)
     _draw_pv_name (pv);
@@ -267,11 +385,14 @@ draw_pad_name (PadType *pad)
       box.Y1 += Settings.PinoutTextOffsetY;
     }
 
-  gui->graphics->set_color (Output.fgGC, PCB->PinNameColor);
-
   text.Flags = NoFlags ();
   /* Set font height to approx 90% of pin thickness */
   text.Scale = 90 * pad->Thickness / FONT_CAPHEIGHT;
+  if (lod_skip_text (text.Scale))
+    return;
+
+  gui->graphics->set_color (Output.fgGC, PCB->PinNameColor);
+
   text.X = box.X1;
   text.Y = box.Y1;
   text.Direction = vert ? 1 : 0;
@@ -285,6 +406,12 @@ _draw_pad (hidGC gc, PadType *pad, bool clear, bool mask)
   if (clear && !mask && pad->Clearance <= 0)
     return;
 
+  if (!clear && !mask && lod_draw_rect (gc, pad->BoundingBox.X1,
+					 pad->BoundingBox.Y1,
+					 pad->BoundingBox.X2,
+					 pad->BoundingBox.Y2))
+    return;
+
   if (TEST_FLAG (THINDRAWFLAG, PCB) ||
       (clear && TEST_FLAG (THINDRAWPOLYFLAG, PCB)))
     gui->graphics->thindraw_pcb_pad (gc, pad, clear, mask);
@@ -325,6 +452,8 @@ draw_element_name (ElementType *element)
   if ((TEST_FLAG (HIDENAMESFLAG, PCB) && gui->gui) ||
       TEST_FLAG (HIDENAMEFLAG, element))
     return;
+  if (!doing_pinout && lod_skip_text (ELEMENT_TEXT (PCB, element).Scale))
+    return;
   if (doing_pinout || doing_assy)
     gui->graphics->set_color (Output.fgGC, PCB->ElementColor);
   else if (TEST_FLAG (SELECTEDFLAG, &ELEMENT_TEXT (PCB, element)))
@@ -386,6 +515,10 @@ hole_callback (const BoxType * b, void *cl)
       (plated == 1 &&  TEST_FLAG (HOLEFLAG, pv)))
     return 1;
 
+  /* A hole smaller than a pixel would not show on the pin or via */
+  if (!TEST_FLAG (HOLEFLAG, pv) && LOD_BELOW (pv->DrillingHole, 1))
+    return 1;
+
   if (TEST_FLAG (THINDRAWFLAG, PCB))
     {
       if (!TEST_FLAG (HOLEFLAG, pv))
@@ -434,7 +567,8 @@ line_callback (const BoxType * b, void *cl)
   LineType *line = (LineType *) b;
 
   set_layer_object_color (layer, (AnyObjectType *) line);
-  gui->graphics->draw_pcb_line (Output.fgGC, line);
+  if (!lod_draw_line (Output.fgGC, line))
+    gui->graphics->draw_pcb_line (Output.fgGC, line);
 
   return 1;
 }
@@ -473,7 +607,9 @@ arc_callback (const BoxType * b, void *cl)
   ArcType *arc =  (ArcType *) b;
 
   set_layer_object_color (layer, (AnyObjectType *) arc);
-  gui->graphics->draw_pcb_arc (Output.fgGC, arc);
+  if (!lod_draw_rect (Output.fgGC, arc->BoundingBox.X1, arc->BoundingBox.Y1,
+		      arc->BoundingBox.X2, arc->BoundingBox.Y2))
+    gui->graphics->draw_pcb_arc (Output.fgGC, arc);
 
   return 1;
 }
@@ -494,12 +630,15 @@ draw_element_package (ElementType *element)
   /* draw lines, arcs, text and pins */
   ELEMENTLINE_LOOP (element);
   {
-    gui->graphics->draw_pcb_line (Output.fgGC, line);
+    if (!lod_draw_line (Output.fgGC, line))
+      gui->graphics->draw_pcb_line (Output.fgGC, line);
   }
   END_LOOP;
   ARC_LOOP (element);
   {
-    gui->graphics->draw_pcb_arc (Output.fgGC, arc);
+    if (!lod_draw_rect (Output.fgGC, arc->BoundingBox.X1, arc->BoundingBox.Y1,
+			arc->BoundingBox.X2, arc->BoundingBox.Y2))
+      gui->graphics->draw_pcb_arc (Output.fgGC, arc);
   }
   END_LOOP;
 }
@@ -945,6 +1084,9 @@ text_callback (const BoxType * b, void *cl)
   TextType *text = (TextType *)b;
   int min_silk_line;
 
+  if (lod_skip_text (text->Scale))
+    return 1;
+
   if (TEST_FLAG (SELECTEDFLAG, text))
     gui->graphics->set_color (Output.fgGC, layer->SelectedColor);
   else
@@ -962,12 +1104,18 @@ void
 DrawLayer (LayerType *Layer, const BoxType *screen)
 {
   struct poly_info info = {screen, Layer};
+  double start;
+
+  PERF_START (start);
 
   /* print the non-clearing polys */
   r_search (Layer->polygon_tree, screen, NULL, poly_callback, &info);
 
   if (TEST_FLAG (CHECKPLANESFLAG, PCB))
-    return;
+    {
+      PERF_STOP_LAYER (Layer - PCB->Data->Layer, start);
+      return;
+    }
 
   /* draw all visible lines this layer */
   r_search (Layer->line_tree, screen, NULL, line_callback, Layer);
@@ -991,6 +1139,8 @@ DrawLayer (LayerType *Layer, const BoxType *screen)
                                 0, 0,
                                 PCB->MaxWidth, PCB->MaxHeight);
     }
+
+  PERF_STOP_LAYER (Layer - PCB->Data->Layer, start);
 }
 
 /*!
@@ -1543,8 +1693,11 @@ void
 hid_expose_callback (HID * hid, BoxType * region, void *item)
 {
   HID *old_gui = gui;
+  Coord old_lod_pixel = lod_pixel;
 
   gui = hid;
+  /* Exporters and the pinout window always get full detail */
+  lod_pixel = (hid->gui && Settings.DrawLOD && !item) ? pixel_slop : 0;
   Output.fgGC = gui->graphics->make_gc ();
   Output.bgGC = gui->graphics->make_gc ();
   Output.pmGC = gui->graphics->make_gc ();
@@ -1559,10 +1712,17 @@ hid_expose_callback (HID * hid, BoxType * region, void *item)
       doing_pinout = false;
     }
   else
-    DrawEverything (region);
+    {
+      double start;
+
+      PERF_START (start);
+      DrawEverything (region);
+      PERF_STOP (PERF_TIME_DRAW, start);
+    }
 
   gui->graphics->destroy_gc (Output.fgGC);
   gui->graphics->destroy_gc (Output.bgGC);
   gui->graphics->destroy_gc (Output.pmGC);
   gui = old_gui;
+  lod_pixel = old_lod_pixel;
 }
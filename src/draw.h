@@ -37,6 +37,9 @@
 
 void Draw (void);
 void Redraw (void);
+void SuspendDraw (void);
+void ResumeDraw (void);
+Coord DrawLODPixel (void);
 void DrawVia (PinType *);
 void DrawRat (RatType *);
 void DrawViaName (PinType *);
@@ -77,6 +77,13 @@
 #include <unistd.h>
 #endif
 
+#include <errno.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_OPEN_MEMSTREAM)
+#include <pthread.h>
+#define BACKGROUND_BACKUP
+#endif
+
 
 #include "buffer.h"
 #include "change.h"
@@ -88,6 +95,7 @@
 #include "file.h"
 #include "hid.h"
 #include "layerflags.h"
+#include "libcache.h"
 #include "misc.h"
 #include "mymem.h"
 #include "parse_l.h"
@@ -96,6 +104,7 @@
 #include "rats.h"
 #include "remove.h"
 #include "set.h"
+#include "snapshot.h"
 #include "strflags.h"
 
 #ifdef HAVE_LIBDMALLOC
@@ -344,8 +353,22 @@ SaveBufferElements (char *Filename)
   return (result);
 }
 
+/*!
+ * \brief Write the board in the format selected by the file name.
+ */
+static int
+WriteBoard (char *file)
+{
+  if (IsSnapshotFile (file))
+    return WriteSnapshot (file, PCB, true);
+  return WritePipe (file, true);
+}
+
 /*!
  * \brief Save PCB.
+ *
+ * A file name ending in SNAPSHOT_SUFFIX selects the binary snapshot
+ * format.
  */
 int
 SavePCB (char *file)
@@ -353,10 +376,10 @@ SavePCB (char *file)
   int retcode;
 
   if (gui->notify_save_pcb == NULL)
-    return WritePipe (file, true);
+    return WriteBoard (file);
 
   gui->notify_save_pcb (file, false);
-  retcode = WritePipe (file, true);
+  retcode = WriteBoard (file);
   gui->notify_save_pcb (file, true);
 
   return retcode;
@@ -411,7 +434,8 @@ real_load_pcb (char *Filename, bool revert)
   newPCB->Font.Valid = false;
 
   /* new data isn't added to the undo list */
-  if (!ParsePCB (PCB, new_filename))
+  if (!(IsSnapshotFile (new_filename) ? ParseSnapshot (PCB, new_filename)
+	: ParsePCB (PCB, new_filename)))
     {
       RemovePCB (oldPCB);
 
@@ -1009,6 +1033,7 @@ static bool dont_save_any_more = false;
 void
 EmergencySave (void)
 {
+  WaitForBackup ();
 
   if (!dont_save_any_more)
     {
@@ -1025,6 +1050,192 @@ DisableEmergencySave (void)
 
 static hidval backup_timer;
 
+#ifdef BACKGROUND_BACKUP
+/*!
+ * \brief An autosave handed to the backup thread.
+ *
+ * The layout is serialized into \a Buffer on the GUI thread; the
+ * thread only writes it out, so it never touches the board itself.
+ */
+typedef struct
+{
+  char *Filename;		/*!< Final name of the backup. */
+  char *TmpFilename;		/*!< Name written to before the rename. */
+  char *Buffer;			/*!< The serialized layout. */
+  size_t Size;
+  int Error;			/*!< errno of the first failure, or 0. */
+  bool Done;			/*!< Set by the thread, under backup_lock. */
+} BackupJobType;
+
+static BackupJobType *backup_job = NULL;
+static pthread_t backup_thread;
+static pthread_mutex_t backup_lock = PTHREAD_MUTEX_INITIALIZER;
+static hidval backup_poll_timer;
+
+/*!
+ * \brief How often the GUI thread checks for a finished backup, in
+ * milliseconds.
+ */
+#define BACKUP_POLL_INTERVAL 250
+
+/*!
+ * \brief Body of the backup thread.
+ *
+ * Writes the buffer to a temporary file next to the backup, syncs it
+ * and renames it over the backup, so that a crash in the middle of an
+ * autosave never leaves a truncated backup behind.
+ */
+static void *
+backup_thread_main (void *arg)
+{
+  BackupJobType *job = (BackupJobType *) arg;
+  FILE *fp;
+  int error = 0;
+
+  if ((fp = fopen (job->TmpFilename, "w")) == NULL)
+    error = errno;
+  else
+    {
+      if (fwrite (job->Buffer, 1, job->Size, fp) != job->Size
+	  || fflush (fp) != 0)
+	error = errno;
+#ifdef HAVE_FSYNC
+      if (!error && fsync (fileno (fp)) != 0)
+	error = errno;
+#endif
+      if (fclose (fp) != 0 && !error)
+	error = errno;
+      if (!error && rename (job->TmpFilename, job->Filename) != 0)
+	error = errno;
+      if (error)
+	unlink (job->TmpFilename);
+    }
+
+  pthread_mutex_lock (&backup_lock);
+  job->Error = error;
+  job->Done = true;
+  pthread_mutex_unlock (&backup_lock);
+  return NULL;
+}
+
+static void
+free_backup_job (BackupJobType *job)
+{
+  free (job->Filename);
+  free (job->TmpFilename);
+  free (job->Buffer);
+  free (job);
+}
+
+/*!
+ * \brief Joins the backup thread and reports how the backup went.
+ *
+ * Errors are reported from here rather than from the thread, since
+ * Message() and the HIDs are not thread safe.
+ */
+static void
+reap_backup_job (void)
+{
+  pthread_join (backup_thread, NULL);
+  if (backup_job->Error)
+    Message (_("Autosave to %s failed: %s\n"), backup_job->Filename,
+	     strerror (backup_job->Error));
+  free_backup_job (backup_job);
+  backup_job = NULL;
+}
+
+/*!
+ * \brief Timer callback reaping the backup thread once it is done.
+ */
+static void
+backup_poll_cb (hidval data)
+{
+  bool done;
+
+  backup_poll_timer.ptr = NULL;
+  if (backup_job == NULL)
+    return;
+
+  pthread_mutex_lock (&backup_lock);
+  done = backup_job->Done;
+  pthread_mutex_unlock (&backup_lock);
+
+  if (!done)
+    {
+      backup_poll_timer = gui->add_timer (backup_poll_cb,
+					  BACKUP_POLL_INTERVAL, data);
+      return;
+    }
+
+  reap_backup_job ();
+}
+
+/*!
+ * \brief Starts writing a backup to \a filename on the backup thread.
+ *
+ * The GUI thread only pays for serializing the layout into memory.  If
+ * the previous backup is still being written this one is skipped; the
+ * next timer tick will catch up.
+ *
+ * \return false if the backup has to be written synchronously instead.
+ */
+static bool
+BackupInBackground (char *filename)
+{
+  BackupJobType *job;
+  FILE *fp;
+  hidval x;
+
+  if (gui->add_timer == NULL)
+    return false;
+  if (backup_job != NULL)
+    return true;
+
+  job = (BackupJobType *) calloc (1, sizeof (BackupJobType));
+  if ((fp = open_memstream (&job->Buffer, &job->Size)) == NULL)
+    {
+      free (job);
+      return false;
+    }
+  if (WritePCB (fp) != STATUS_OK || fclose (fp) != 0)
+    {
+      free (job->Buffer);
+      free (job);
+      return false;
+    }
+
+  job->Filename = strdup (filename);
+  job->TmpFilename = (char *) malloc (strlen (filename) + 5);
+  sprintf (job->TmpFilename, "%s.tmp", filename);
+
+  if (pthread_create (&backup_thread, NULL, backup_thread_main, job) != 0)
+    {
+      free_backup_job (job);
+      return false;
+    }
+  backup_job = job;
+
+  x.ptr = NULL;
+  backup_poll_timer = gui->add_timer (backup_poll_cb, BACKUP_POLL_INTERVAL, x);
+  return true;
+}
+#endif /* BACKGROUND_BACKUP */
+
+/*!
+ * \brief Waits for a backup that is still being written.
+ *
+ * Called on the way out, so that exiting in the middle of an autosave
+ * doesn't leave just the temporary file or a half renamed backup.
+ */
+void
+WaitForBackup (void)
+{
+#ifdef BACKGROUND_BACKUP
+  if (backup_job != NULL)
+    reap_backup_job ();
+#endif
+}
+
 /*!
  * \brief Callback for the autosave.
  *  
@@ -1068,6 +1279,9 @@ EnableAutosave (void)
  * The default is to use the pcb file name with a "~" appended (like
  * "foo.pcb~") and if we don't have a pcb file name then use the
  * template in BACKUP_NAME.
+ *
+ * Where threads are available the file is written by a background
+ * thread, see BackupInBackground().
  */
 void
 Backup (void)
@@ -1096,6 +1310,13 @@ Backup (void)
       sprintf (filename, BACKUP_NAME, (int) getpid ());
     }
 
+#ifdef BACKGROUND_BACKUP
+  if (BackupInBackground (filename))
+    {
+      free (filename);
+      return;
+    }
+#endif
   WritePCBFile (filename);
   free (filename);
 }
@@ -1308,6 +1529,41 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
 }
 
 
+/*!
+ * \brief Adds the footprints of one directory of a newlib tree found by
+ * LibCacheScanTree() to the Library, the same way
+ * LoadNewlibFootprintsFromDir() does.
+ */
+static void
+AddNewlibMenu (const char *dir, GPtrArray *footprints, void *data)
+{
+  char *toppath = (char *) data;
+  LibraryMenuType *menu;
+  LibraryEntryType *entry;
+  guint i;
+
+  menu = GetLibraryMenuMemory (&Library);
+  menu->Name = strdup (dir);
+  menu->directory = strdup (toppath);
+
+  for (i = 0; i < footprints->len; i++)
+    {
+      char *name = (char *) g_ptr_array_index (footprints, i);
+
+      entry = GetLibraryEntryMemory (menu);
+      entry->AllocatedMemory = (char *) malloc (strlen (dir)
+						+ strlen (PCB_DIR_SEPARATOR_S)
+						+ strlen (name) + 1);
+      sprintf (entry->AllocatedMemory, "%s%s", dir, PCB_DIR_SEPARATOR_S);
+      entry->ListEntry = entry->AllocatedMemory
+	+ strlen (entry->AllocatedMemory);
+      strcat (entry->AllocatedMemory, name);
+
+      /* mark as directory tree (newlib) library */
+      entry->Template = (char *) -1;
+    }
+}
+
 /*!
  * \brief This function loads the newlib footprints into the Library.
  *
@@ -1378,7 +1634,11 @@ ParseLibraryTree (void)
 #endif
 
       /* Next read in any footprints in the top level dir and below */
-      n_footprints += LoadNewlibFootprintsFromDir("(local)", toppath, *p == '/');
+      if (Settings.LibraryCache)
+	n_footprints += LibCacheScanTree (toppath, *p == '/', AddNewlibMenu,
+					  toppath);
+      else
+	n_footprints += LoadNewlibFootprintsFromDir("(local)", toppath, *p == '/');
     }
 
   /* restore the original working directory */
@@ -1407,6 +1667,7 @@ ReadLibraryContents (void)
   FILE *resultFP = NULL;
   LibraryMenuType *menu = NULL;
   LibraryEntryType *entry;
+  bool from_cache = false;
 
   /* If we don't have a command to execute to find the library contents,
    * skip this. This is used by default on Windows builds (set in main.c),
@@ -1429,8 +1690,12 @@ ReadLibraryContents (void)
 
       /* This uses a pipe to execute a shell script which provides the names of
        * all M4 libs and footprints.  The results are placed in resultFP.
+       * Unless the libraries changed, the output of the last run is reused.
        */
-      if (command && *command && (resultFP = popen (command, "r")) == NULL)
+      if (command && *command && Settings.LibraryCache)
+	from_cache = (resultFP = LibCacheOpenContents (command)) != NULL;
+      if (command && *command && !from_cache
+	  && (resultFP = popen (command, "r")) == NULL)
 	{
 	  PopenErrorMessage (command);
 	}
@@ -1490,7 +1755,12 @@ ReadLibraryContents (void)
 	    }
 	}
       if (resultFP != NULL)
-	pclose (resultFP);
+	{
+	  if (from_cache)
+	    fclose (resultFP);
+	  else
+	    pclose (resultFP);
+	}
     }
 
   /* Now after reading in the M4 libs, call a function to
@@ -1506,6 +1776,26 @@ ReadLibraryContents (void)
   return (1);
 }
 
+/*!
+ * \brief Read the library contents the first time they are needed.
+ *
+ * Interactive GUIs do this at start-up to fill their library window;
+ * exporters and the batch GUI only pay for it when something looks up
+ * a footprint by name.
+ */
+void
+EnsureLibraryContents (void)
+{
+  static bool done = false;
+
+  if (done)
+    return;
+  done = true;
+
+  if (!ReadLibraryContents () && Library.MenuN)
+    hid_action ("LibraryChanged");
+}
+
 #define BLANK(x) ((x) == ' ' || (x) == '\t' || (x) == '\n' \
 		|| (x) == '\0')
 
@@ -43,10 +43,12 @@ int LoadPCB (char *);
 int RevertPCB (void);
 void EnableAutosave (void);
 void Backup (void);
+void WaitForBackup (void);
 void SaveInTMP (void);
 void EmergencySave (void);
 void DisableEmergencySave (void);
 int ReadLibraryContents (void);
+void EnsureLibraryContents (void);
 int ImportNetlist (char *);
 int SaveBufferElements (char *);
 void sort_netlist (void);
@@ -90,6 +90,7 @@
 #include "rtree.h"
 #include "polygon.h"
 #include "pcb-printf.h"
+#include "perf.h"
 #include "search.h"
 #include "set.h"
 #include "undo.h"
@@ -2663,6 +2664,22 @@ ListsEmpty (bool AndRats)
   return (empty);
 }
 
+/*!
+ * \brief Returns the number of objects in all lists of found objects.
+ */
+static unsigned long
+ListsTotal (void)
+{
+  unsigned long total;
+  int i;
+
+  total = PVList.Number + RatList.Number
+    + PadList[TOP_SIDE].Number + PadList[BOTTOM_SIDE].Number;
+  for (i = 0; i < max_copper_layer; i++)
+    total += LineList[i].Number + ArcList[i].Number + PolygonList[i].Number;
+  return (total);
+}
+
 static void
 reassign_no_drc_flags (void)
 {
@@ -2685,6 +2702,10 @@ static bool
 DoIt (int flag, bool AndRats, bool AndDraw)
 {
   bool newone = false;
+  unsigned long found = 0;
+
+  if (perf_enabled)
+    found = ListsTotal ();
   reassign_no_drc_flags ();
   do
     {
@@ -2699,6 +2720,13 @@ DoIt (int flag, bool AndRats, bool AndDraw)
         DrawNewConnections ();
     }
   while (!newone && !ListsEmpty (AndRats));
+  if (perf_enabled)
+    {
+      found = ListsTotal () - found;
+      PERF_COUNT (PERF_FIND_FLOODS, 1);
+      PERF_COUNT (PERF_FIND_OBJECTS, found);
+      PERF_MAX (PERF_FIND_LARGEST, found);
+    }
   if (AndDraw)
     Draw ();
   return (newone);
@@ -784,6 +784,8 @@ typedef struct
     Mode, /*!< Currently active mode. */
     BufferNumber; /*!< Number of the current buffer. */
   int BackupInterval; /*!< Time between two backups in seconds. */
+  int UndoBudget; /*!< Memory budget of the undo list in MB. */
+  int AutorouteJobs; /*!< Nets the autorouter routes in parallel. */
   char *DefaultLayerName[MAX_LAYER],
    *FontCommand, /*!< Command for font file loading. */
    *FileCommand, /*!< Command for file loading. */
@@ -842,6 +844,12 @@ typedef struct
     RingBellWhenFinished,
       /*!< flag if a signal should be produced when searching of
        * connections is done. */
+    PerfCounters, /*!< Start the performance counters at start-up. */
+    LibraryCache, /*!< Keep an index of the footprint libraries. */
+    BatchScripts, /*!< Run ExecuteFile scripts as one batch. */
+    StartupProfile, /*!< Print how long each start-up phase took. */
+    DrawLOD, /*!< Simplify what is too small to see when zoomed out. */
+    AutorouteNegotiate, /*!< Negotiate congestion between nets. */
     AutoPlace;
       /*!< Flag which says we should force placement of the windows on
        * startup. */
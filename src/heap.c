@@ -50,9 +50,17 @@
 #include <dmalloc.h>
 #endif
 
+#ifdef PCB_POLYBENCH
+#include "polybench.h"
+#endif
+
 /* define this for more thorough self-checking of data structures */
 #undef SLOW_ASSERTIONS
 
+/* the root is element[1]; element[0] is not used */
+#define HEAP_PARENT(k)		(((k) - 2) / HEAP_ARITY + 1)
+#define HEAP_FIRST_CHILD(k)	(HEAP_ARITY * ((k) - 1) + 2)
+
 /* ---------------------------------------------------------------------------
  * some local prototypes
  */
@@ -64,6 +72,7 @@ struct heap_element
 {
   cost_t cost;
   void *data;
+  heap_handle_t *handle;	/*!< Where to keep the position, or NULL. */
 };
 struct heap_struct
 {
@@ -89,9 +98,12 @@ __heap_is_good_slow (heap_t * heap)
   /* heap condition: key in each node should be smaller than in its children */
   /* alternatively (and this is what we check): key in each node should be
    * larger than (or equal to) key of its parent. */
-  /* note that array element[0] is not used (except as a sentinel) */
-  for (i = 2; i < heap->size; i++)
-    if (heap->element[i].cost < heap->element[i / 2].cost)
+  for (i = 2; i <= heap->size; i++)
+    if (heap->element[i].cost < heap->element[HEAP_PARENT (i)].cost)
+      return 0;
+  /* every tracked element knows where it is */
+  for (i = 1; i <= heap->size; i++)
+    if (heap->element[i].handle && *heap->element[i].handle != i)
       return 0;
   return 1;
 }
@@ -150,6 +162,8 @@ void heap_free (heap_t *heap, void (*freefunc) (void *))
   assert (__heap_is_good (heap));
   for ( ; heap->size; heap->size--)  
    {
+     if (heap->element[heap->size].handle)
+       *heap->element[heap->size].handle = HEAP_NO_HANDLE;
      if (heap->element[heap->size].data)
        freefunc (heap->element[heap->size].data);
    }
@@ -157,6 +171,17 @@ void heap_free (heap_t *heap, void (*freefunc) (void *))
 
 /* -- mutation -- */
 
+/*!
+ * \brief Stores element \a v at position \a k.
+ */
+static inline void
+__heap_set (heap_t * heap, int k, struct heap_element v)
+{
+  heap->element[k] = v;
+  if (v.handle)
+    *v.handle = k;
+}
+
 static void
 __upheap (heap_t * heap, int k)
 {
@@ -165,14 +190,59 @@ __upheap (heap_t * heap, int k)
   assert (heap && heap->size < heap->max);
   assert (k <= heap->size);
 
-  heap->element[0].cost = MIN_COST;
-  for (v = heap->element[k]; heap->element[k / 2].cost > v.cost; k = k / 2)
-    heap->element[k] = heap->element[k / 2];
-  heap->element[k] = v;
+  for (v = heap->element[k];
+       k > 1 && heap->element[HEAP_PARENT (k)].cost > v.cost;
+       k = HEAP_PARENT (k))
+    __heap_set (heap, k, heap->element[HEAP_PARENT (k)]);
+  __heap_set (heap, k, v);
+}
+
+/*!
+ * \brief This procedure moves down the heap.
+ * 
+ * Exchanging the node at position k with the smallest of its children
+ * as necessary and stopping when the node at k is smaller than all
+ * children or the bottom is reached.
+ */
+static void
+__downheap (heap_t * heap, int k)
+{
+  struct heap_element v;
+
+  assert (heap && heap->size < heap->max);
+  assert (k <= heap->size);
+
+  v = heap->element[k];
+  for (;;)
+    {
+      int c = HEAP_FIRST_CHILD (k), last, j;
+
+      if (c > heap->size)
+	break;
+      last = MIN (c + HEAP_ARITY - 1, heap->size);
+      for (j = c++; c <= last; c++)
+	if (heap->element[c].cost < heap->element[j].cost)
+	  j = c;
+      if (v.cost < heap->element[j].cost)
+	break;
+      __heap_set (heap, k, heap->element[j]);
+      k = j;
+    }
+  __heap_set (heap, k, v);
 }
 
+/*!
+ * \brief Insert an item that can later be found again through
+ * \a handle.
+ *
+ * The heap keeps *\a handle up to date with the position of the item
+ * for as long as it is in the heap and sets it to HEAP_NO_HANDLE when
+ * the item leaves the heap.  \a handle may be \c NULL for items that
+ * are only ever taken out with heap_remove_smallest().
+ */
 void
-heap_insert (heap_t * heap, cost_t cost, void *data)
+heap_insert_handle (heap_t * heap, cost_t cost, void *data,
+		    heap_handle_t * handle)
 {
   assert (heap && __heap_is_good (heap));
   assert (cost >= MIN_COST);
@@ -190,38 +260,42 @@ heap_insert (heap_t * heap, cost_t cost, void *data)
   assert (heap->size < heap->max);
   heap->element[heap->size].cost = cost;
   heap->element[heap->size].data = data;
+  heap->element[heap->size].handle = handle;
   __upheap (heap, heap->size);	/* fix heap condition violation */
   assert (__heap_is_good (heap));
   return;
 }
 
+void
+heap_insert (heap_t * heap, cost_t cost, void *data)
+{
+  heap_insert_handle (heap, cost, data, NULL);
+}
+
 /*!
- * \brief This procedure moves down the heap.
- * 
- * Exchanging the node at position k with the smaller of its two
- * children as necessary and stopping when the node at k is smaller than
- * both children or the bottom is reached.
+ * \brief Take the item at position \a k out of the heap.
  */
-static void
-__downheap (heap_t * heap, int k)
+static void *
+__heap_remove_at (heap_t * heap, int k)
 {
-  struct heap_element v;
+  struct heap_element v, last;
 
-  assert (heap && heap->size < heap->max);
-  assert (k <= heap->size);
+  assert (k >= 1 && k <= heap->size);
 
   v = heap->element[k];
-  while (k <= heap->size / 2)
+  if (v.handle)
+    *v.handle = HEAP_NO_HANDLE;
+  last = heap->element[heap->size--];
+  if (k <= heap->size)
     {
-      int j = k + k;
-      if (j < heap->size && heap->element[j].cost > heap->element[j + 1].cost)
-	j++;
-      if (v.cost < heap->element[j].cost)
-	break;
-      heap->element[k] = heap->element[j];
-      k = j;
+      /* the last item may belong above or below the hole */
+      __heap_set (heap, k, last);
+      if (k > 1 && heap->element[HEAP_PARENT (k)].cost > last.cost)
+	__upheap (heap, k);
+      else
+	__downheap (heap, k);
     }
-  heap->element[k] = v;
+  return v.data;
 }
 
 /*!
@@ -230,18 +304,51 @@ __downheap (heap_t * heap, int k)
 void *
 heap_remove_smallest (heap_t * heap)
 {
-  struct heap_element v;
+  void *data;
   assert (heap && __heap_is_good (heap));
   assert (heap->size > 0);
   assert (heap->max > 1);
 
-  v = heap->element[1];
-  heap->element[1] = heap->element[heap->size--];
-  if (heap->size > 0)
-    __downheap (heap, 1);
+  data = __heap_remove_at (heap, 1);
+
+  assert (__heap_is_good (heap));
+  return data;
+}
+
+/*!
+ * \brief Remove the item inserted with \a handle from the heap.
+ */
+void *
+heap_remove (heap_t * heap, heap_handle_t * handle)
+{
+  void *data;
+  assert (heap && __heap_is_good (heap));
+  assert (handle && *handle != HEAP_NO_HANDLE);
+  assert (heap->element[*handle].handle == handle);
+
+  data = __heap_remove_at (heap, *handle);
+
+  assert (__heap_is_good (heap));
+  return data;
+}
+
+/*!
+ * \brief Lower the cost of the item inserted with \a handle.
+ */
+void
+heap_decrease_key (heap_t * heap, heap_handle_t * handle, cost_t cost)
+{
+  int k;
+  assert (heap && __heap_is_good (heap));
+  assert (handle && *handle != HEAP_NO_HANDLE);
+  k = *handle;
+  assert (heap->element[k].handle == handle);
+  assert (cost <= heap->element[k].cost);
+
+  heap->element[k].cost = cost;
+  __upheap (heap, k);
 
   assert (__heap_is_good (heap));
-  return v.data;
 }
 
 /*!
@@ -253,20 +360,25 @@ heap_remove_smallest (heap_t * heap)
 void *
 heap_replace (heap_t * heap, cost_t cost, void *data)
 {
+  struct heap_element v;
   assert (heap && __heap_is_good (heap));
 
-  if (heap_is_empty (heap))
+  if (heap_is_empty (heap) || cost < heap->element[1].cost)
     return data;
 
   assert (heap->size > 0);
   assert (heap->max > 1);
 
-  heap->element[0].cost = cost;
-  heap->element[0].data = data;
-  __downheap (heap, 0);		/* ooh, tricky! */
+  v = heap->element[1];
+  if (v.handle)
+    *v.handle = HEAP_NO_HANDLE;
+  heap->element[1].cost = cost;
+  heap->element[1].data = data;
+  heap->element[1].handle = NULL;
+  __downheap (heap, 1);
 
   assert (__heap_is_good (heap));
-  return heap->element[0].data;
+  return v.data;
 }
 
 /* -- interrogation -- */
@@ -281,6 +393,17 @@ heap_is_empty (heap_t * heap)
   return heap->size == 0;
 }
 
+/*!
+ * \brief Return the smallest item without removing it.
+ */
+void *
+heap_peek_smallest (heap_t * heap)
+{
+  assert (heap && __heap_is_good (heap));
+  assert (heap->size > 0);
+  return heap->element[1].data;
+}
+
 /* -- size -- */
 
 /*!
@@ -292,4 +415,3 @@ heap_size (heap_t * heap)
   assert (__heap_is_good (heap));
   return heap->size;
 }
-
@@ -41,6 +41,17 @@
 
 #include "global.h"
 
+/*!
+ * \brief Number of children of every node.
+ *
+ * A 4-ary heap is half as deep as a binary one and the children of a
+ * node share a cache line or two, which more than pays for the extra
+ * comparisons in the sift down.  Build with -DHEAP_ARITY=2 to compare.
+ */
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 4
+#endif
+
 /*!
  * \brief Type of heap costs.
  */
@@ -49,6 +60,14 @@ typedef double cost_t;
  * \brief What a heap looks like.
  */
 typedef struct heap_struct heap_t;
+/*!
+ * \brief Position of a tracked item, kept up to date by the heap.
+ */
+typedef int heap_handle_t;
+/*!
+ * \brief Handle value of an item that is not in a heap.
+ */
+#define HEAP_NO_HANDLE 0
 
 heap_t *heap_create ();
 void heap_destroy (heap_t ** heap);
@@ -58,9 +77,14 @@ void heap_free (heap_t * heap, void (*funcfree) (void *));
 void heap_insert (heap_t * heap, cost_t cost, void *data);
 void *heap_remove_smallest (heap_t * heap);
 void *heap_replace (heap_t * heap, cost_t cost, void *data);
+void heap_insert_handle (heap_t * heap, cost_t cost, void *data,
+			 heap_handle_t * handle);
+void heap_decrease_key (heap_t * heap, heap_handle_t * handle, cost_t cost);
+void *heap_remove (heap_t * heap, heap_handle_t * handle);
 
 /* -- interrogation -- */
 int heap_is_empty (heap_t * heap);
+void *heap_peek_smallest (heap_t * heap);
 int heap_size (heap_t * heap);
 
 #endif /* PCB_HEAP_H */
@@ -762,6 +762,18 @@ typedef enum
    */
   void hid_init (void);
 
+  /*!
+   * \brief Loads the HID plugins from the plugin directories.
+   *
+   * hid_init() only registers the built-in HIDs; the plugins are
+   * loaded on first demand by hid_find_gui(), hid_enumerate(), and
+   * by lookups of exporters, actions and options that are not
+   * built in.  Call this to force loading them earlier.
+   *
+   * \return 1 if the plugins were loaded now, 0 if they already were.
+   */
+  int hid_load_plugins (void);
+
   /*!
    * \brief When PCB runs in interactive mode, this is called to
    * instantiate one GUI HID which happens to be the GUI.
@@ -2,20 +2,34 @@
 #include "config.h"
 #endif
 
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_SYS_UN_H)
+#include <sys/socket.h>
+#include <sys/un.h>
+#define BATCH_SERVER
+#endif
 
 #include "global.h"
 #include "hid.h"
 #include "data.h"
+#include "error.h"
 #include "misc.h"
 #include "hid.h"
 #include "hid_draw.h"
 #include "../hidint.h"
 #include "pcb-printf.h"
+#include "perf.h"
 
 #include "hid/common/draw_helpers.h"
 #include "hid/common/hidnogui.h"
@@ -42,6 +56,31 @@ batch_get_export_options (int *n_ret)
 
 /* ----------------------------------------------------------------------------- */
 
+static char *server_socket = NULL;
+static int server_stop = 0;
+
+HID_Attribute batch_attribute_list[] = {
+/* %start-doc options "23 Batch GUI Options"
+@ftable @code
+@item --server-socket <string>
+Instead of reading actions from stdin, listen on the given UNIX domain
+socket and run the actions sent by its clients, one line at a time.
+The output of each line is sent back to the client, followed by a line
+@samp{pcb-status: N} where N is the return code of the actions.  The
+board stays loaded between lines and between clients, so a client
+only pays for loading a layout when it asks for a different one.
+Confirmation prompts are answered with OK.  The @code{StopServer()}
+action makes the server exit once the current client disconnects.
+@end ftable
+%end-doc
+*/
+  {"server-socket", "Serve actions on this UNIX domain socket",
+   HID_String, 0, 0, {0, 0, 0}, 0, &server_socket},
+#define HA_server_socket 0
+};
+
+REGISTER_ATTRIBUTES (batch_attribute_list)
+
 static char *prompt = "pcb";
 
 static int
@@ -101,6 +140,85 @@ info (int argc, char **argv, Coord x, Coord y)
   return 0;
 }
 
+/* Benchmark(stage) prints the wall time spent since the previous call
+   and since the first one, plus the peak resident set size so far, in
+   a line that the benchmark driver in tests/ turns into CSV.  */
+
+static double
+wall_time (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static long
+peak_rss_kb (void)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage ru;
+
+  if (getrusage (RUSAGE_SELF, &ru) == 0)
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+  return -1;
+}
+
+static int
+benchmark (int argc, char **argv, Coord x, Coord y)
+{
+  static double first = -1, last;
+  double now = wall_time ();
+
+  if (first < 0)
+    first = last = now;
+  printf ("benchmark: %s %.6f %.6f %ld\n", argc > 0 ? argv[0] : "mark",
+	  now - last, now - first, peak_rss_kb ());
+  fflush (stdout);
+  last = now;
+  return 0;
+}
+
+/* ExportLayout(exporter) runs one of the export HIDs on the current
+   board with its default options, as "pcb -x exporter" would.  */
+
+static int
+export_layout (int argc, char **argv, Coord x, Coord y)
+{
+  HID *hid;
+
+  if (argc < 1)
+    {
+      Message ("Usage: ExportLayout(exporter)\n");
+      return 1;
+    }
+  if (!PCB || !PCB->Filename)
+    {
+      Message ("ExportLayout: no PCB loaded.\n");
+      return 1;
+    }
+  hid = hid_find_exporter (argv[0]);
+  if (hid == NULL)
+    return 1;
+
+  exporter = hid;
+  hid->do_export (NULL);
+  exporter = NULL;
+  return 0;
+}
+
+static int
+stop_server (int argc, char **argv, Coord x, Coord y)
+{
+  server_stop = 1;
+  return 0;
+}
+
 
 HID_Action batch_action_list[] = {
   {"PCBChanged", 0, PCBChanged },
@@ -110,7 +228,10 @@ HID_Action batch_action_list[] = {
   {"LibraryChanged", 0, nop },
   {"Busy", 0, nop },
   {"Help", 0, help },
-  {"Info", 0, info }
+  {"Info", 0, info },
+  {"Benchmark", 0, benchmark },
+  {"ExportLayout", 0, export_layout },
+  {"StopServer", 0, stop_server }
 };
 
 REGISTER_ACTIONS (batch_action_list)
@@ -118,12 +239,142 @@ REGISTER_ACTIONS (batch_action_list)
 
 /* ----------------------------------------------------------------------------- */
 
+static HID batch_hid;
+
+#ifdef BATCH_SERVER
+
+/* The server runs every line a client sends with stdout pointed at the
+   client's socket, so actions and Message() need no changes to stream
+   their output back.  */
+
+static int
+batch_server_confirm (char *msg, ...)
+{
+  return 1;
+}
+
+static int
+batch_server_close_confirm (void)
+{
+  return 1;
+}
+
+static void
+remove_server_socket (void)
+{
+  if (server_socket)
+    unlink (server_socket);
+}
+
+static void
+serve_client (int client)
+{
+  FILE *in;
+  char line[1000];
+  char status[32];
+  int saved_stdout, rv;
+
+  if ((in = fdopen (dup (client), "r")) == NULL)
+    return;
+
+  while (fgets (line, sizeof (line) - 1, in) != NULL)
+    {
+      fflush (stdout);
+      saved_stdout = dup (1);
+      dup2 (client, 1);
+
+      rv = hid_parse_command (line);
+
+      fflush (stdout);
+      dup2 (saved_stdout, 1);
+      close (saved_stdout);
+
+      sprintf (status, "pcb-status: %d\n", rv);
+      if (write (client, status, strlen (status)) < 0)
+	break;
+    }
+  fclose (in);
+}
+
+static void
+batch_serve (const char *path)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+  int sock, client;
+
+  if (strlen (path) >= sizeof (addr.sun_path))
+    {
+      Message ("Socket path %s is too long.\n", path);
+      return;
+    }
+
+  /* Only remove what a previous server left behind, never a file.  */
+  if (lstat (path, &st) == 0 && S_ISSOCK (st.st_mode))
+    unlink (path);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  sock = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0
+      || bind (sock, (struct sockaddr *) &addr, sizeof (addr)) < 0
+      || listen (sock, 8) < 0)
+    {
+      Message ("Cannot listen on %s: %s\n", path, strerror (errno));
+      if (sock >= 0)
+	close (sock);
+      return;
+    }
+  atexit (remove_server_socket);
+
+  /* A client that goes away mid-answer must not take the server down.  */
+  signal (SIGPIPE, SIG_IGN);
+  batch_hid.confirm_dialog = batch_server_confirm;
+  batch_hid.close_confirm_dialog = batch_server_close_confirm;
+
+  printf ("Serving actions on %s\n", path);
+  fflush (stdout);
+
+  while (!server_stop)
+    {
+      client = accept (sock, NULL, NULL);
+      if (client < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  Message ("accept: %s\n", strerror (errno));
+	  break;
+	}
+      serve_client (client);
+      close (client);
+    }
+
+  close (sock);
+  remove_server_socket ();
+}
+
+#endif /* BATCH_SERVER */
+
 static void
 batch_do_export (HID_Attr_Val * options)
 {
   int interactive;
   char line[1000];
 
+  if (server_socket && *server_socket)
+    {
+#ifdef BATCH_SERVER
+      batch_serve (server_socket);
+      if (perf_enabled)
+	hid_actionl ("Report", "Perf", NULL);
+#else
+      Message ("This build has no support for UNIX domain sockets.\n");
+#endif
+      return;
+    }
+
   if (isatty (0))
     interactive = 1;
   else
@@ -142,7 +393,11 @@ batch_do_export (HID_Attr_Val * options)
 	  fflush(stdout);
 	}
       if (fgets(line, sizeof(line)-1, stdin) == NULL)
-	return;
+	{
+	  if (perf_enabled)
+	    hid_actionl ("Report", "Perf", NULL);
+	  return;
+	}
       hid_parse_command (line);
     }
 }
@@ -325,7 +580,6 @@ batch_show_item (void *item)
 
 #include "dolists.h"
 
-static HID batch_hid;
 static HID_DRAW batch_graphics;
 
 void
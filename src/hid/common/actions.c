@@ -104,6 +104,10 @@ hid_find_action (const char *name)
     if (strcasecmp (all_actions[i]->name, name) == 0)
       return all_actions[i];
 
+  /* The action may come from a plugin that was not loaded yet.  */
+  if (hid_load_plugins ())
+    return hid_find_action (name);
+
   printf ("unknown action `%s'\n", name);
   return 0;
 }
@@ -4,6 +4,7 @@
 #include "data.h" /* For global "PCB" variable */
 #include "rotate.h" /* For RotateLineLowLevel() */
 #include "polygon.h"
+#include "draw.h" /* For DrawLODPixel() */
 #include "draw_helpers.h"
 
 
@@ -119,23 +120,46 @@ common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
     }
 }
 
+/* Returns true if the contour is less than a pixel away from the last
+   vertex kept, when the core allows simplified drawing.  */
+static bool
+lod_skip_vertex (Coord tolerance, VNODE *v, Coord last_x, Coord last_y)
+{
+  return tolerance > 0
+    && ABS (v->point[0] - last_x) < tolerance
+    && ABS (v->point[1] - last_y) < tolerance;
+}
+
 static void
 fill_contour (hidGC gc, PLINE *pl)
 {
-  Coord *x, *y, n, i = 0;
+  Coord *x, *y, n, i = 0, j = 0;
+  Coord tolerance = DrawLODPixel ();
   VNODE *v;
 
+  /* A contour within a couple of pixels is just a dot */
+  if (tolerance > 0
+      && pl->xmax - pl->xmin < 2 * tolerance
+      && pl->ymax - pl->ymin < 2 * tolerance)
+    {
+      gui->graphics->fill_rect (gc, pl->xmin, pl->ymin, pl->xmax, pl->ymax);
+      return;
+    }
+
   n = pl->Count;
   x = (Coord *)malloc (n * sizeof (*x));
   y = (Coord *)malloc (n * sizeof (*y));
 
-  for (v = &pl->head; i < n; v = v->next)
+  for (v = &pl->head; i < n; v = v->next, i++)
     {
-      x[i] = v->point[0];
-      y[i++] = v->point[1];
+      if (j > 0 && lod_skip_vertex (tolerance, v, x[j - 1], y[j - 1]))
+        continue;
+      x[j] = v->point[0];
+      y[j++] = v->point[1];
     }
 
-  gui->graphics->fill_polygon (gc, n, x, y);
+  if (j >= 3)
+    gui->graphics->fill_polygon (gc, j, x, y);
 
   free (x);
   free (y);
@@ -147,6 +171,7 @@ thindraw_contour (hidGC gc, PLINE *pl)
   VNODE *v;
   Coord last_x, last_y;
   Coord this_x, this_y;
+  Coord tolerance = DrawLODPixel ();
 
   gui->graphics->set_line_width (gc, 0);
   gui->graphics->set_line_cap (gc, Round_Cap);
@@ -168,6 +193,8 @@ thindraw_contour (hidGC gc, PLINE *pl)
 
   do
     {
+      if (v != &pl->head && lod_skip_vertex (tolerance, v, last_x, last_y))
+        continue;
       this_x = v->point[0];
       this_y = v->point[1];
 
@@ -116,6 +116,12 @@ hid_load_dir (char *dirname)
   closedir (dir);
 }
 
+static int plugins_loaded = 0;
+static int settings_loaded = 0;
+
+static void hid_copy_defaults (HID_AttrNode *);
+static void hid_apply_settings (HID_AttrNode *);
+
 void
 hid_init ()
 {
@@ -125,6 +131,28 @@ hid_init ()
 #define HID_DEF(x) hid_ ## x ## _init();
 #include "hid/common/hidlist.h"
 #undef HID_DEF
+}
+
+/* Plugins are only loaded once something asks for a HID, action or
+   option that the built-in ones do not provide, or for the complete
+   list of HIDs.  One-shot exports with a built-in exporter never pay
+   for scanning and dlopen()ing the plugin directories.
+
+   The settings files have usually been read by then, so they are
+   applied again to the attributes the plugins register, and those get
+   their defaults like the built-in ones did when the command line was
+   parsed.
+
+   Returns 1 if the plugins were loaded by this call, 0 if that had
+   already happened.  */
+int
+hid_load_plugins ()
+{
+  HID_AttrNode *builtin = hid_attr_nodes;
+
+  if (plugins_loaded)
+    return 0;
+  plugins_loaded = 1;
 
   hid_load_dir (Concat (exec_prefix, PCB_DIR_SEPARATOR_S, "lib",
 	PCB_DIR_SEPARATOR_S, "pcb",
@@ -145,6 +173,11 @@ hid_init ()
     }
   hid_load_dir (Concat ("plugins", PCB_DIR_SEPARATOR_S, HOST, NULL));
   hid_load_dir (Concat ("plugins", NULL));
+
+  if (settings_loaded)
+    hid_apply_settings (builtin);
+  hid_copy_defaults (builtin);
+  return 1;
 }
 
 void
@@ -180,6 +213,8 @@ hid_find_gui ()
 {
   int i;
 
+  hid_load_plugins ();
+
   for (i = 0; i < hid_num_hids; i++)
     if (!hid_list[i]->printer && !hid_list[i]->exporter)
       return hid_list[i];
@@ -197,6 +232,8 @@ hid_find_printer ()
     if (hid_list[i]->printer)
       return hid_list[i];
 
+  if (hid_load_plugins ())
+    return hid_find_printer ();
   return 0;
 }
 
@@ -209,6 +246,9 @@ hid_find_exporter (const char *which)
     if (hid_list[i]->exporter && strcmp (which, hid_list[i]->name) == 0)
       return hid_list[i];
 
+  if (hid_load_plugins ())
+    return hid_find_exporter (which);
+
   fprintf (stderr, "Invalid exporter %s, available ones:", which);
   for (i = 0; i < hid_num_hids; i++)
     if (hid_list[i]->exporter)
@@ -221,6 +261,7 @@ hid_find_exporter (const char *which)
 HID **
 hid_enumerate ()
 {
+  hid_load_plugins ();
   return hid_list;
 }
 
@@ -239,16 +280,15 @@ hid_register_attributes (HID_Attribute * a, int n)
   ha->n = n;
 }
 
-void
-hid_parse_command_line (int *argc, char ***argv)
+/* Copies the default of every attribute registered after UPTO (all of
+   them if UPTO is NULL) into its variable.  */
+static void
+hid_copy_defaults (HID_AttrNode *upto)
 {
   HID_AttrNode *ha;
-  int i, e, ok;
-
-  (*argc)--;
-  (*argv)++;
+  int i;
 
-  for (ha = hid_attr_nodes; ha; ha = ha->next)
+  for (ha = hid_attr_nodes; ha != upto; ha = ha->next)
     for (i = 0; i < ha->n; i++)
       {
 	HID_Attribute *a = ha->attributes + i;
@@ -293,6 +333,18 @@ hid_parse_command_line (int *argc, char ***argv)
 	    abort ();
 	  }
       }
+}
+
+void
+hid_parse_command_line (int *argc, char ***argv)
+{
+  HID_AttrNode *ha;
+  int i, e, ok;
+
+  (*argc)--;
+  (*argv)++;
+
+  hid_copy_defaults (NULL);
 
   while (*argc && (*argv)[0][0] == '-' && (*argv)[0][1] == '-')
     {
@@ -408,6 +460,13 @@ hid_parse_command_line (int *argc, char ***argv)
 	  arg_ofs = 5;
 	  goto try_no_arg;
 	}
+      if (hid_load_plugins ())
+	{
+	  /* The option may belong to a plugin.  */
+	  bool_val = 1;
+	  arg_ofs = 2;
+	  goto try_no_arg;
+	}
       fprintf (stderr, "unrecognized option: %s\n", (*argv)[0]);
       exit (1);
     got_match:;
@@ -533,13 +592,13 @@ hid_save_settings (int locally)
 }
 
 static void
-hid_set_attribute (char *name, char *value)
+hid_set_attribute (char *name, char *value, HID_AttrNode *upto)
 {
   const Unit *unit;
   HID_AttrNode *ha;
   int i, e, ok;
 
-  for (ha = hid_attr_nodes; ha; ha = ha->next)
+  for (ha = hid_attr_nodes; ha != upto; ha = ha->next)
     for (i = 0; i < ha->n; i++)
       if (strcmp (name, ha->attributes[i].name) == 0)
 	{
@@ -604,7 +663,7 @@ hid_set_attribute (char *name, char *value)
 }
 
 static void
-hid_load_settings_1 (char *fname)
+hid_load_settings_1 (char *fname, HID_AttrNode *upto)
 {
   char line[1024], *namep, *valp, *cp;
   FILE *f;
@@ -635,27 +694,37 @@ hid_load_settings_1 (char *fname)
       cp = valp + strlen(valp) - 1;
       while (cp >= valp && isspace ((int) *cp))
 	*cp-- = 0;
-      hid_set_attribute (namep, valp);
+      hid_set_attribute (namep, valp, upto);
     }
 
   fclose (f);
 }
 
-void
-hid_load_settings ()
+/* Applies the settings files to the attributes registered after UPTO
+   (all of them if UPTO is NULL).  */
+static void
+hid_apply_settings (HID_AttrNode *upto)
 {
   HID_AttrNode *ha;
   int i;
 
-  for (ha = hid_attr_nodes; ha; ha = ha->next)
+  for (ha = hid_attr_nodes; ha != upto; ha = ha->next)
     for (i = 0; i < ha->n; i++)
       ha->attributes[i].hash = attr_hash (ha->attributes+i);
 
-  hid_load_settings_1 (Concat (pcblibdir, PCB_DIR_SEPARATOR_S, "settings", NULL));
+  hid_load_settings_1 (Concat (pcblibdir, PCB_DIR_SEPARATOR_S, "settings", NULL),
+		       upto);
   if (homedir != NULL)
     hid_load_settings_1 (Concat (homedir, PCB_DIR_SEPARATOR_S, ".pcb",
-               PCB_DIR_SEPARATOR_S, "settings", NULL));
-  hid_load_settings_1 (Concat ("pcb.settings", NULL));
+               PCB_DIR_SEPARATOR_S, "settings", NULL), upto);
+  hid_load_settings_1 (Concat ("pcb.settings", NULL), upto);
+}
+
+void
+hid_load_settings ()
+{
+  settings_loaded = 1;
+  hid_apply_settings (NULL);
 }
 
 #define HASH_SIZE 31
@@ -2,6 +2,7 @@
 #include "config.h"
 #endif
 
+#include <math.h>
 #include <stdio.h>
 
 #include "crosshair.h"
@@ -22,6 +23,20 @@ extern HID ghid_hid;
 
 static enum mask_mode cur_mask = HID_MASK_OFF;
 static int mask_seq = 0;
+static int clip_seq = 0;
+
+/* Size in pixels of the square tiles of the render cache, and the
+   number of tiles kept.  128 tiles cover a full-screen view about two
+   times over.  */
+#define TILE_SIZE 256
+#define TILE_CACHE_MAX 128
+
+typedef struct
+{
+  int i, j;			/* tile position, in units of TILE_SIZE */
+  GdkPixmap *pixmap;
+  unsigned int used;		/* for evicting the least recently used */
+} render_tile;
 
 typedef struct render_priv {
   GdkGC *bg_gc;
@@ -43,6 +58,15 @@ typedef struct render_priv {
   Coord lead_user_y;
 
   hidGC crosshair_gc;
+
+  /* Cache of rendered board tiles at one zoom level, see draw_tiles () */
+  render_tile tiles[TILE_CACHE_MAX];
+  int n_tiles;
+  unsigned int tile_clock;
+  double tile_zoom;
+  bool tile_flip_x, tile_flip_y;
+  guint32 tile_state;
+  GdkPixmap *tile_mask;
 } render_priv;
 
 
@@ -56,6 +80,7 @@ typedef struct hid_gc_struct
   gint cap, join;
   gchar xor_mask;
   gint mask_seq;
+  gint clip_seq;
 }
 hid_gc_struct;
 
@@ -501,13 +526,14 @@ use_gc (hidGC gc)
       ghid_set_draw_xor (gc, gc->xor_mask);
       gdk_gc_set_clip_origin (gc->gc, 0, 0);
     }
-  if (gc->mask_seq != mask_seq)
+  if (gc->mask_seq != mask_seq || gc->clip_seq != clip_seq)
     {
       if (mask_seq)
 	gdk_gc_set_clip_mask (gc->gc, gport->mask);
       else
 	set_clip (priv, gc->gc);
       gc->mask_seq = mask_seq;
+      gc->clip_seq = clip_seq;
     }
   priv->u_gc = WHICH_GC (gc);
   return 1;
@@ -699,48 +725,12 @@ ghid_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 		      x1, y1, x2 - x1 + 1, y2 - y1 + 1);
 }
 
+/* Fills the port with the off-limits color and the board area with
+   the background color.  */
 static void
-redraw_region (GdkRectangle *rect)
+draw_background (render_priv *priv)
 {
   int eleft, eright, etop, ebottom;
-  BoxType region;
-  render_priv *priv = gport->render_priv;
-
-  if (!gport->pixmap)
-    return;
-
-  if (rect != NULL)
-    {
-      priv->clip_rect = *rect;
-      priv->clip = true;
-    }
-  else
-    {
-      priv->clip_rect.x = 0;
-      priv->clip_rect.y = 0;
-      priv->clip_rect.width = gport->width;
-      priv->clip_rect.height = gport->height;
-      priv->clip = false;
-    }
-
-  set_clip (priv, priv->bg_gc);
-  set_clip (priv, priv->offlimits_gc);
-  set_clip (priv, priv->mask_gc);
-  set_clip (priv, priv->grid_gc);
-
-  region.X1 = MIN(Px(priv->clip_rect.x),
-                  Px(priv->clip_rect.x + priv->clip_rect.width + 1));
-  region.Y1 = MIN(Py(priv->clip_rect.y),
-                  Py(priv->clip_rect.y + priv->clip_rect.height + 1));
-  region.X2 = MAX(Px(priv->clip_rect.x),
-                  Px(priv->clip_rect.x + priv->clip_rect.width + 1));
-  region.Y2 = MAX(Py(priv->clip_rect.y),
-                  Py(priv->clip_rect.y + priv->clip_rect.height + 1));
-
-  region.X1 = MAX (0, MIN (PCB->MaxWidth,  region.X1));
-  region.X2 = MAX (0, MIN (PCB->MaxWidth,  region.X2));
-  region.Y1 = MAX (0, MIN (PCB->MaxHeight, region.Y1));
-  region.Y2 = MAX (0, MIN (PCB->MaxHeight, region.Y2));
 
   eleft = Vx (0);
   eright = Vx (PCB->MaxWidth);
@@ -783,10 +773,318 @@ redraw_region (GdkRectangle *rect)
 
   gdk_draw_rectangle (gport->drawable, priv->bg_gc, 1,
                       eleft, etop, eright - eleft + 1, ebottom - etop + 1);
+}
 
-  ghid_draw_bg_image();
+/* Returns the part of the board shown in the port, for
+   hid_expose_callback ().  */
+static void
+port_region (int x, int y, int width, int height, BoxType *region)
+{
+  region->X1 = MIN (Px (x), Px (x + width + 1));
+  region->Y1 = MIN (Py (y), Py (y + height + 1));
+  region->X2 = MAX (Px (x), Px (x + width + 1));
+  region->Y2 = MAX (Py (y), Py (y + height + 1));
+
+  region->X1 = MAX (0, MIN (PCB->MaxWidth,  region->X1));
+  region->X2 = MAX (0, MIN (PCB->MaxWidth,  region->X2));
+  region->Y1 = MAX (0, MIN (PCB->MaxHeight, region->Y1));
+  region->Y2 = MAX (0, MIN (PCB->MaxHeight, region->Y2));
+}
 
+static void
+set_clips (render_priv *priv)
+{
+  clip_seq++;
+  set_clip (priv, priv->bg_gc);
+  set_clip (priv, priv->offlimits_gc);
+  set_clip (priv, priv->mask_gc);
+  set_clip (priv, priv->grid_gc);
+}
+
+/* ---------------------------------------------------------------------------
+ * Tile cache.
+ *
+ * With the cache enabled the board is rendered in TILE_SIZE squares,
+ * aligned to a grid that only depends on the zoom level and the view
+ * flips, and kept as pixmaps.  Redrawing the port then only renders
+ * the tiles that are not cached yet and copies the rest; panning and
+ * the full redraws done for every mouse and key event mostly become
+ * pixmap copies.
+ *
+ * ghid_invalidate_lr () drops the tiles touched by the changed area,
+ * ghid_invalidate_all () drops all of them, and ghid_invalidate_view ()
+ * keeps them for view-only changes.  In addition, the tiles are
+ * dropped whenever the zoom, the flips or the layer state summarized
+ * by tile_state_hash () change, so nothing drawn from a different
+ * layer stack or visibility is ever reused.
+ */
+
+static guint32
+hash_bytes (guint32 h, const void *data, size_t n)
+{
+  const unsigned char *p = (const unsigned char *) data;
+
+  while (n--)
+    h = (h ^ *p++) * 16777619u;
+  return h;
+}
+
+static guint32
+tile_state_hash (void)
+{
+  guint32 h = 2166136261u;
+  int i;
+
+  h = hash_bytes (h, &PCB->ID, sizeof (PCB->ID));
+  h = hash_bytes (h, &PCB->Flags, sizeof (PCB->Flags));
+  h = hash_bytes (h, &PCB->MaxWidth, sizeof (PCB->MaxWidth));
+  h = hash_bytes (h, &PCB->MaxHeight, sizeof (PCB->MaxHeight));
+  h = hash_bytes (h, &PCB->ViaOn, sizeof (PCB->ViaOn));
+  h = hash_bytes (h, &PCB->ElementOn, sizeof (PCB->ElementOn));
+  h = hash_bytes (h, &PCB->RatOn, sizeof (PCB->RatOn));
+  h = hash_bytes (h, &PCB->InvisibleObjectsOn,
+		  sizeof (PCB->InvisibleObjectsOn));
+  h = hash_bytes (h, &PCB->PinOn, sizeof (PCB->PinOn));
+  h = hash_bytes (h, &Settings.ShowBottomSide,
+		  sizeof (Settings.ShowBottomSide));
+  h = hash_bytes (h, LayerStack, sizeof (LayerStack));
+  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
+    h = hash_bytes (h, &PCB->Data->Layer[i].On,
+		    sizeof (PCB->Data->Layer[i].On));
+  return h;
+}
+
+static void
+flush_tiles (render_priv *priv)
+{
+  int n;
+
+  for (n = 0; n < priv->n_tiles; n++)
+    g_object_unref (priv->tiles[n].pixmap);
+  priv->n_tiles = 0;
+}
+
+static void
+check_tile_state (render_priv *priv)
+{
+  guint32 state = tile_state_hash ();
+
+  if (priv->tile_zoom != gport->view.coord_per_px
+      || priv->tile_flip_x != gport->view.flip_x
+      || priv->tile_flip_y != gport->view.flip_y
+      || priv->tile_state != state)
+    {
+      flush_tiles (priv);
+      priv->tile_zoom = gport->view.coord_per_px;
+      priv->tile_flip_x = gport->view.flip_x;
+      priv->tile_flip_y = gport->view.flip_y;
+      priv->tile_state = state;
+    }
+}
+
+/* Rounds towards minus infinity, unlike C division.  */
+static int
+tile_index (double px)
+{
+  return (int) floor (px / TILE_SIZE);
+}
+
+/* Drops the cached tiles that show any part of the given board area.  */
+static void
+drop_tiles (render_priv *priv, Coord left, Coord right, Coord top,
+	    Coord bottom)
+{
+  double zoom = priv->tile_zoom;
+  double x1, x2, y1, y2;
+  int i1, i2, j1, j2, n;
+
+  if (priv->n_tiles == 0 || zoom <= 0)
+    return;
+
+  if (priv->tile_flip_x)
+    {
+      left = PCB->MaxWidth - left;
+      right = PCB->MaxWidth - right;
+    }
+  if (priv->tile_flip_y)
+    {
+      top = PCB->MaxHeight - top;
+      bottom = PCB->MaxHeight - bottom;
+    }
+
+  /* Allow for rounding and line ends drawn one pixel off.  */
+  x1 = MIN (left, right) / zoom - 2;
+  x2 = MAX (left, right) / zoom + 2;
+  y1 = MIN (top, bottom) / zoom - 2;
+  y2 = MAX (top, bottom) / zoom + 2;
+  i1 = tile_index (x1);
+  i2 = tile_index (x2);
+  j1 = tile_index (y1);
+  j2 = tile_index (y2);
+
+  for (n = 0; n < priv->n_tiles;)
+    {
+      render_tile *t = &priv->tiles[n];
+
+      if (t->i >= i1 && t->i <= i2 && t->j >= j1 && t->j <= j2)
+	{
+	  g_object_unref (t->pixmap);
+	  *t = priv->tiles[--priv->n_tiles];
+	}
+      else
+	n++;
+    }
+}
+
+/* Renders tile (i, j) of the current zoom level into a new pixmap.  */
+static GdkPixmap *
+render_tile_pixmap (render_priv *priv, int i, int j)
+{
+  GdkPixmap *pixmap, *save_pixmap, *save_mask;
+  GdkDrawable *save_drawable;
+  view_data save_view;
+  int save_width, save_height;
+  bool save_clip;
+  BoxType region;
+
+  save_pixmap = gport->pixmap;
+  save_mask = gport->mask;
+  save_drawable = gport->drawable;
+  save_view = gport->view;
+  save_width = gport->width;
+  save_height = gport->height;
+  save_clip = priv->clip;
+
+  pixmap = gdk_pixmap_new (save_pixmap, TILE_SIZE, TILE_SIZE, -1);
+
+  gport->pixmap = pixmap;
+  gport->drawable = pixmap;
+  gport->mask = priv->tile_mask;
+  gport->width = TILE_SIZE;
+  gport->height = TILE_SIZE;
+  gport->view.x0 = (double) i * TILE_SIZE * save_view.coord_per_px;
+  gport->view.y0 = (double) j * TILE_SIZE * save_view.coord_per_px;
+  gport->view.width = TILE_SIZE * save_view.coord_per_px;
+  gport->view.height = TILE_SIZE * save_view.coord_per_px;
+  priv->clip = false;
+  set_clips (priv);
+
+  draw_background (priv);
+  ghid_draw_bg_image ();
+  port_region (0, 0, TILE_SIZE, TILE_SIZE, &region);
   hid_expose_callback (&ghid_hid, &region, 0);
+
+  /* ghid_use_mask () may have made a tile sized mask */
+  priv->tile_mask = gport->mask;
+
+  gport->pixmap = save_pixmap;
+  gport->mask = save_mask;
+  gport->drawable = save_drawable;
+  gport->view = save_view;
+  gport->width = save_width;
+  gport->height = save_height;
+  priv->clip = save_clip;
+  set_clips (priv);
+
+  return pixmap;
+}
+
+static GdkPixmap *
+get_tile (render_priv *priv, int i, int j)
+{
+  render_tile *t;
+  int n, oldest;
+
+  for (n = 0; n < priv->n_tiles; n++)
+    if (priv->tiles[n].i == i && priv->tiles[n].j == j)
+      {
+	priv->tiles[n].used = ++priv->tile_clock;
+	return priv->tiles[n].pixmap;
+      }
+
+  if (priv->n_tiles < TILE_CACHE_MAX)
+    t = &priv->tiles[priv->n_tiles++];
+  else
+    {
+      oldest = 0;
+      for (n = 1; n < priv->n_tiles; n++)
+	if (priv->tiles[n].used < priv->tiles[oldest].used)
+	  oldest = n;
+      t = &priv->tiles[oldest];
+      g_object_unref (t->pixmap);
+    }
+
+  t->i = i;
+  t->j = j;
+  t->used = ++priv->tile_clock;
+  t->pixmap = render_tile_pixmap (priv, i, j);
+  return t->pixmap;
+}
+
+/* Copies the tiles covering priv->clip_rect into the port, rendering
+   the ones that are not cached.  */
+static void
+draw_tiles (render_priv *priv)
+{
+  double zoom = gport->view.coord_per_px;
+  double ox, oy;
+  int i, j, i1, i2, j1, j2;
+  GdkRectangle *r = &priv->clip_rect;
+
+  check_tile_state (priv);
+
+  /* Port origin in tile grid pixels, rounded so that all tiles share
+     the same sub-pixel offset and meet without seams.  */
+  ox = floor (gport->view.x0 / zoom);
+  oy = floor (gport->view.y0 / zoom);
+
+  i1 = tile_index (ox + r->x);
+  i2 = tile_index (ox + r->x + MAX (r->width, 1) - 1);
+  j1 = tile_index (oy + r->y);
+  j2 = tile_index (oy + r->y + MAX (r->height, 1) - 1);
+
+  for (j = j1; j <= j2; j++)
+    for (i = i1; i <= i2; i++)
+      gdk_draw_drawable (gport->pixmap, priv->bg_gc, get_tile (priv, i, j),
+			 0, 0, i * TILE_SIZE - ox, j * TILE_SIZE - oy,
+			 TILE_SIZE, TILE_SIZE);
+}
+
+static void
+redraw_region (GdkRectangle *rect)
+{
+  BoxType region;
+  render_priv *priv = gport->render_priv;
+
+  if (!gport->pixmap)
+    return;
+
+  if (rect != NULL)
+    {
+      priv->clip_rect = *rect;
+      priv->clip = true;
+    }
+  else
+    {
+      priv->clip_rect.x = 0;
+      priv->clip_rect.y = 0;
+      priv->clip_rect.width = gport->width;
+      priv->clip_rect.height = gport->height;
+      priv->clip = false;
+    }
+
+  set_clips (priv);
+
+  if (ghid_tile_cache)
+    draw_tiles (priv);
+  else
+    {
+      port_region (priv->clip_rect.x, priv->clip_rect.y,
+		   priv->clip_rect.width, priv->clip_rect.height, &region);
+      draw_background (priv);
+      ghid_draw_bg_image ();
+      hid_expose_callback (&ghid_hid, &region, 0);
+    }
   ghid_draw_grid ();
 
   /* In some cases we are called with the crosshair still off */
@@ -800,6 +1098,7 @@ redraw_region (GdkRectangle *rect)
   draw_lead_user (priv);
 
   priv->clip = false;
+  clip_seq++;
 
   /* Rest the clip for bg_gc, as it is used outside this function */
   gdk_gc_set_clip_mask (priv->bg_gc, NULL);
@@ -827,6 +1126,7 @@ ghid_invalidate_lr (int left, int right, int top, int bottom)
   rect.width = maxx - minx;
   rect.height = maxy - miny;
 
+  drop_tiles (gport->render_priv, left, right, top, bottom);
   redraw_region (&rect);
   ghid_screen_update ();
 }
@@ -834,6 +1134,16 @@ ghid_invalidate_lr (int left, int right, int top, int bottom)
 
 void
 ghid_invalidate_all ()
+{
+  flush_tiles (gport->render_priv);
+  redraw_region (NULL);
+  ghid_screen_update ();
+}
+
+/* Redraws the port after the view moved or for the overlays, without
+   anything on the board having changed.  */
+void
+ghid_invalidate_view ()
 {
   redraw_region (NULL);
   ghid_screen_update ();
@@ -1049,6 +1359,9 @@ ghid_shutdown_renderer (GHidPort *port)
 
   gui->graphics->destroy_gc (priv->crosshair_gc);
   ghid_cancel_lead_user ();
+  flush_tiles (priv);
+  if (priv->tile_mask)
+    g_object_unref (priv->tile_mask);
   g_free (port->render_priv);
   port->render_priv = NULL;
 }
@@ -627,6 +627,12 @@ ghid_invalidate_all ()
     gdk_window_process_all_updates ();
 }
 
+void
+ghid_invalidate_view ()
+{
+  ghid_invalidate_all ();
+}
+
 void
 ghid_notify_crosshair_change (bool changes_complete)
 {
@@ -1683,6 +1683,7 @@ ghid_create_listener (void)
 
 static int stdin_listen = 0;
 static char *pcbmenu_path = "gpcb-menu.res";
+int ghid_tile_cache = 1;
 
 HID_Attribute ghid_attribute_list[] = {
 
@@ -1718,8 +1719,22 @@ Location of the @file{gpcb-menu.res} file which defines the menu for the GTK+ GU
 %end-doc
 */
 {"pcb-menu", N_("Location of gpcb-menu.res file"),
-   HID_String, 0, 0, {0, PCBLIBDIR "/gpcb-menu.res", 0}, 0, &pcbmenu_path}
+   HID_String, 0, 0, {0, PCBLIBDIR "/gpcb-menu.res", 0}, 0, &pcbmenu_path},
 #define HA_pcbmenu 2
+
+/* %start-doc options "21 GTK+ GUI Options"
+@ftable @code
+@item --tile-cache
+Keep the rendered board in tiles and only redraw the tiles touched by an
+edit, so that panning and redraws for mouse and key events just copy
+pixmaps. Only used by the GDK renderer. Enabled by default, use
+@code{--no-tile-cache} to always render the whole view.
+@end ftable
+%end-doc
+*/
+  {"tile-cache", N_("Cache rendered tiles of the board"),
+   HID_Boolean, 0, 0, {1, 0, 0}, 0, &ghid_tile_cache},
+#define HA_tile_cache 3
 };
 
 REGISTER_ATTRIBUTES (ghid_attribute_list)
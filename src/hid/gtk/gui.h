@@ -202,6 +202,7 @@ typedef struct
 GHidPort;
 
 extern GHidPort ghid_port, *gport;
+extern int ghid_tile_cache;
 
 typedef enum
 {
@@ -493,6 +494,7 @@ void ghid_fill_polygon (hidGC gc, int n_coords, Coord *x, Coord *y);
 void ghid_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2);
 void ghid_invalidate_lr (int left, int right, int top, int bottom);
 void ghid_invalidate_all ();
+void ghid_invalidate_view ();
 void ghid_notify_crosshair_change (bool changes_complete);
 void ghid_notify_mark_change (bool changes_complete);
 void ghid_init_renderer (int *, char ***, GHidPort *);
@@ -0,0 +1,584 @@
+/*!
+ * \file src/libcache.c
+ *
+ * \brief On-disk index of the footprint libraries.
+ *
+ * Enumerating a large newlib tree means a stat() for every footprint,
+ * and enumerating the M4 library means running the library contents
+ * command.  Both are slow when the libraries are big or live on a
+ * network file system, and both produce the same result from one start
+ * to the next.
+ *
+ * For every newlib root an index file remembers, per directory, its
+ * modification time, its footprints and its subdirectories.  On the
+ * next start a directory whose modification time did not change is
+ * taken from the index with a single stat(); only changed directories
+ * are read again.  Adding, removing or renaming an entry updates the
+ * modification time of its directory, which is all the index relies
+ * on.
+ *
+ * The output of the library contents command is kept together with a
+ * checksum over the command and the names, sizes and modification
+ * times of the files in Settings.LibraryPath; it is reused as long as
+ * neither changes.
+ *
+ * The index files live in the "pcb" directory of the user cache
+ * directory (usually ~/.cache/pcb) and can be removed at any time.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "global.h"
+
+#include "data.h"
+#include "error.h"
+#include "libcache.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+/* bump these whenever the format or the footprint filter changes */
+#define NEWLIB_INDEX_MAGIC "pcb-newlib-index 1"
+#define CONTENTS_INDEX_MAGIC "pcb-contents-index 1"
+
+/*!
+ * \brief A directory of a newlib tree as remembered by the index.
+ */
+typedef struct
+{
+  char *Path;			/*!< Absolute path of the directory. */
+  gint64 MTime;			/*!< Its mtime, -1 to always read it. */
+  GPtrArray *Files;		/*!< Names of the footprints in it. */
+  GPtrArray *Subdirs;		/*!< Names of its subdirectories. */
+} IndexDirType;
+
+typedef struct
+{
+  GHashTable *old;		/*!< Path -> IndexDirType, from the index. */
+  GPtrArray *dirs;		/*!< The new index, in scan order. */
+  bool changed;			/*!< The index file needs to be rewritten. */
+  gint64 now;
+  bool recursive;
+  LibCacheDirFunc func;
+  void *data;
+  int count;			/*!< Footprints found. */
+} ScanType;
+
+static IndexDirType *
+index_dir_new (const char *path, gint64 mtime)
+{
+  IndexDirType *d = g_new0 (IndexDirType, 1);
+
+  d->Path = g_strdup (path);
+  d->MTime = mtime;
+  d->Files = g_ptr_array_new ();
+  d->Subdirs = g_ptr_array_new ();
+  return d;
+}
+
+static void
+free_strings (GPtrArray *a)
+{
+  guint i;
+
+  for (i = 0; i < a->len; i++)
+    g_free (g_ptr_array_index (a, i));
+  g_ptr_array_free (a, TRUE);
+}
+
+static void
+index_dir_free (gpointer p)
+{
+  IndexDirType *d = (IndexDirType *) p;
+
+  g_free (d->Path);
+  free_strings (d->Files);
+  free_strings (d->Subdirs);
+  g_free (d);
+}
+
+/*!
+ * \brief Returns the name of the index file for \a key, creating the
+ * cache directory if needed.
+ *
+ * \return NULL if there is no usable cache directory.
+ */
+static char *
+cache_file_name (const char *kind, const char *key)
+{
+  char *dir, *sum, *name, *path;
+
+  dir = g_build_filename (g_get_user_cache_dir (), "pcb", NULL);
+  if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+      g_free (dir);
+      return NULL;
+    }
+  sum = g_compute_checksum_for_string (G_CHECKSUM_MD5, key, -1);
+  name = g_strdup_printf ("%s-%s", kind, sum);
+  path = g_build_filename (dir, name, NULL);
+  g_free (sum);
+  g_free (name);
+  g_free (dir);
+  return path;
+}
+
+/*!
+ * \brief The same filter LoadNewlibFootprintsFromDir() in file.c uses.
+ *
+ * We're skipping .png and .html because those may exist in a library
+ * tree to provide an html browsable index of the library.
+ */
+static bool
+is_footprint_name (const char *name)
+{
+  size_t l = strlen (name);
+
+  return name[0] != '.'
+    && strcmp (name, "CVS") != 0
+    && strcmp (name, "Makefile") != 0
+    && strcmp (name, "Makefile.am") != 0
+    && strcmp (name, "Makefile.in") != 0
+    && (l < 4 || strcmp (name + l - 4, ".png") != 0)
+    && (l < 5 || strcmp (name + l - 5, ".html") != 0)
+    && (l < 4 || strcmp (name + l - 4, ".pcb") != 0);
+}
+
+/*!
+ * \brief Reads the footprints and subdirectories of \a path from disk.
+ */
+static IndexDirType *
+read_dir (const char *path, gint64 mtime)
+{
+  IndexDirType *d;
+  DIR *dir;
+  struct dirent *entry;
+  struct stat buffer;
+
+  if ((dir = opendir (path)) == NULL)
+    {
+      OpendirErrorMessage ((char *) path);
+      return NULL;
+    }
+  d = index_dir_new (path, mtime);
+  while ((entry = readdir (dir)) != NULL)
+    {
+      char *full;
+
+      if (entry->d_name[0] == '.')
+	continue;
+      full = g_build_filename (path, entry->d_name, NULL);
+      if (stat (full, &buffer) == 0)
+	{
+	  if (S_ISREG (buffer.st_mode) && is_footprint_name (entry->d_name))
+	    g_ptr_array_add (d->Files, g_strdup (entry->d_name));
+	  else if (S_ISDIR (buffer.st_mode)
+		   && strcmp (entry->d_name, "CVS") != 0)
+	    g_ptr_array_add (d->Subdirs, g_strdup (entry->d_name));
+	}
+      g_free (full);
+    }
+  closedir (dir);
+  return d;
+}
+
+static void
+scan_dir (ScanType *s, const char *path)
+{
+  IndexDirType *d;
+  struct stat buffer;
+  gint64 mtime;
+  guint i;
+
+  if (stat (path, &buffer) != 0 || !S_ISDIR (buffer.st_mode))
+    {
+      OpendirErrorMessage ((char *) path);
+      return;
+    }
+
+  /* A directory changed within the last couple of seconds may change
+   * again without its mtime moving on; don't trust it next time.
+   */
+  mtime = buffer.st_mtime;
+  if (mtime >= s->now - 2)
+    mtime = -1;
+
+  d = (IndexDirType *) g_hash_table_lookup (s->old, path);
+  if (d != NULL && mtime != -1 && d->MTime == mtime)
+    g_hash_table_steal (s->old, path);
+  else
+    {
+      if ((d = read_dir (path, mtime)) == NULL)
+	return;
+      s->changed = true;
+    }
+
+  g_ptr_array_add (s->dirs, d);
+  s->func (d->Path, d->Files, s->data);
+  s->count += d->Files->len;
+
+  if (!s->recursive)
+    return;
+  for (i = 0; i < d->Subdirs->len; i++)
+    {
+      char *sub = g_build_filename (path, g_ptr_array_index (d->Subdirs, i),
+				    NULL);
+
+      scan_dir (s, sub);
+      g_free (sub);
+    }
+}
+
+/*!
+ * \brief Loads the index file \a file into \a old.
+ *
+ * Anything unexpected makes the whole index be ignored.
+ */
+static void
+load_index (const char *file, const char *header, GHashTable *old)
+{
+  gchar *contents, *line, *next;
+  IndexDirType *d = NULL;
+  bool ok = true;
+
+  if (!g_file_get_contents (file, &contents, NULL, NULL))
+    return;
+
+  next = contents;
+  if (strncmp (next, header, strlen (header)) != 0)
+    {
+      g_free (contents);
+      return;
+    }
+  next += strlen (header);
+
+  while (ok && *next)
+    {
+      line = next;
+      if ((next = strchr (line, '\n')) == NULL)
+	{
+	  /* truncated */
+	  ok = false;
+	  break;
+	}
+      *next++ = '\0';
+
+      if (strncmp (line, "dir ", 4) == 0)
+	{
+	  char *path;
+	  gint64 mtime = g_ascii_strtoll (line + 4, &path, 10);
+
+	  if (*path++ != ' ' || g_hash_table_lookup (old, path))
+	    ok = false;
+	  else
+	    {
+	      d = index_dir_new (path, mtime);
+	      g_hash_table_insert (old, d->Path, d);
+	    }
+	}
+      else if (d && strncmp (line, "file ", 5) == 0)
+	g_ptr_array_add (d->Files, g_strdup (line + 5));
+      else if (d && strncmp (line, "sub ", 4) == 0)
+	g_ptr_array_add (d->Subdirs, g_strdup (line + 4));
+      else
+	ok = false;
+    }
+
+  if (!ok)
+    g_hash_table_remove_all (old);
+  g_free (contents);
+}
+
+static bool
+has_newline (GPtrArray *names)
+{
+  guint i;
+
+  for (i = 0; i < names->len; i++)
+    if (strchr (g_ptr_array_index (names, i), '\n'))
+      return true;
+  return false;
+}
+
+/*!
+ * \brief Writes the new index next to \a file and renames it into place.
+ */
+static void
+write_index (const char *file, const char *header, GPtrArray *dirs)
+{
+  char *tmp = g_strdup_printf ("%s.tmp", file);
+  FILE *fp;
+  guint i, j;
+  bool ok = true;
+
+  if ((fp = fopen (tmp, "w")) == NULL)
+    {
+      g_free (tmp);
+      return;
+    }
+  fputs (header, fp);
+  for (i = 0; ok && i < dirs->len; i++)
+    {
+      IndexDirType *d = g_ptr_array_index (dirs, i);
+
+      /* names with newlines can't be represented, don't cache at all */
+      if (strchr (d->Path, '\n') || has_newline (d->Files)
+	  || has_newline (d->Subdirs))
+	{
+	  ok = false;
+	  break;
+	}
+      fprintf (fp, "dir %" G_GINT64_FORMAT " %s\n", d->MTime, d->Path);
+      for (j = 0; j < d->Files->len; j++)
+	fprintf (fp, "file %s\n", (char *) g_ptr_array_index (d->Files, j));
+      for (j = 0; j < d->Subdirs->len; j++)
+	fprintf (fp, "sub %s\n", (char *) g_ptr_array_index (d->Subdirs, j));
+    }
+  if (ferror (fp))
+    ok = false;
+  if (fclose (fp) != 0)
+    ok = false;
+  if (!ok || rename (tmp, file) != 0)
+    unlink (tmp);
+  g_free (tmp);
+}
+
+/*!
+ * \brief Enumerates the newlib footprints below \a root.
+ *
+ * \a func is called for \a root and, if \a recursive is set, for every
+ * directory below it, in the order ParseLibraryTree() used to visit
+ * them.  Directories whose modification time did not change since the
+ * last run are taken from the index.
+ *
+ * \return the number of footprints found.
+ */
+int
+LibCacheScanTree (const char *root, bool recursive, LibCacheDirFunc func,
+		  void *data)
+{
+  ScanType s;
+  char *key, *file, *header;
+  guint i;
+
+  memset (&s, 0, sizeof (s));
+  s.old = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+				 index_dir_free);
+  s.dirs = g_ptr_array_new ();
+  s.now = time (NULL);
+  s.recursive = recursive;
+  s.func = func;
+  s.data = data;
+
+  key = g_strdup_printf ("%s\n%d", root, recursive);
+  header = g_strdup_printf ("%s\nroot %s\nrecursive %d\n", NEWLIB_INDEX_MAGIC,
+			    root, recursive);
+  file = cache_file_name ("newlib", key);
+  if (file != NULL)
+    load_index (file, header, s.old);
+
+  scan_dir (&s, root);
+
+  /* anything left over was removed from the tree */
+  if (file != NULL && (s.changed || g_hash_table_size (s.old) > 0))
+    write_index (file, header, s.dirs);
+
+  for (i = 0; i < s.dirs->len; i++)
+    index_dir_free (g_ptr_array_index (s.dirs, i));
+  g_ptr_array_free (s.dirs, TRUE);
+  g_hash_table_destroy (s.old);
+  g_free (file);
+  g_free (header);
+  g_free (key);
+  return s.count;
+}
+
+static gint
+compare_strings (gconstpointer a, gconstpointer b)
+{
+  return strcmp (*(char **) a, *(char **) b);
+}
+
+/*!
+ * \brief Returns a checksum over everything the output of the library
+ * contents command depends on.
+ */
+static char *
+contents_signature (const char *command)
+{
+  GString *signature = g_string_new (command);
+  gchar **paths;
+  char *sum;
+  int i;
+
+  paths = g_strsplit (Settings.LibraryPath, PCB_PATH_DELIMETER, 0);
+  for (i = 0; paths[i] != NULL; i++)
+    {
+      GPtrArray *lines;
+      struct stat buffer;
+      struct dirent *entry;
+      DIR *dir;
+      guint j;
+
+      if (!*paths[i] || stat (paths[i], &buffer) != 0)
+	continue;
+      g_string_append_printf (signature, "\n%s %" G_GINT64_FORMAT,
+			      paths[i], (gint64) buffer.st_mtime);
+      if ((dir = opendir (paths[i])) == NULL)
+	continue;
+      lines = g_ptr_array_new ();
+      while ((entry = readdir (dir)) != NULL)
+	{
+	  char *full = g_build_filename (paths[i], entry->d_name, NULL);
+
+	  if (stat (full, &buffer) == 0 && S_ISREG (buffer.st_mode))
+	    g_ptr_array_add (lines,
+			     g_strdup_printf ("%s %" G_GINT64_FORMAT " %"
+					      G_GINT64_FORMAT,
+					      entry->d_name,
+					      (gint64) buffer.st_size,
+					      (gint64) buffer.st_mtime));
+	  g_free (full);
+	}
+      closedir (dir);
+
+      /* readdir order is not guaranteed to be stable */
+      g_ptr_array_sort (lines, compare_strings);
+      for (j = 0; j < lines->len; j++)
+	{
+	  g_string_append_c (signature, '\n');
+	  g_string_append (signature, g_ptr_array_index (lines, j));
+	}
+      free_strings (lines);
+    }
+  g_strfreev (paths);
+
+  sum = g_compute_checksum_for_string (G_CHECKSUM_MD5, signature->str,
+				       signature->len);
+  g_string_free (signature, TRUE);
+  return sum;
+}
+
+/*!
+ * \brief Opens \a file and skips the header of a contents index.
+ *
+ * \return NULL unless the header matches \a signature.
+ */
+static FILE *
+open_contents (const char *file, const char *signature)
+{
+  char line[128];
+  FILE *fp;
+
+  if ((fp = fopen (file, "r")) == NULL)
+    return NULL;
+  if (fgets (line, sizeof (line), fp) == NULL
+      || strcmp (line, CONTENTS_INDEX_MAGIC "\n") != 0
+      || fgets (line, sizeof (line), fp) == NULL
+      || strncmp (line, signature, strlen (signature)) != 0
+      || line[strlen (signature)] != '\n')
+    {
+      fclose (fp);
+      return NULL;
+    }
+  return fp;
+}
+
+/*!
+ * \brief Returns the output of the library contents \a command.
+ *
+ * The command is only run if the libraries changed since its output
+ * was last kept.  The returned stream is a plain file and must be
+ * closed with fclose().
+ *
+ * \return NULL if the cache can't be used, the caller should then run
+ * the command itself.
+ */
+FILE *
+LibCacheOpenContents (const char *command)
+{
+  char *file, *tmp, *signature;
+  char buffer[BUFSIZ];
+  FILE *fp, *pipe;
+  size_t n;
+  bool ok;
+
+  if ((file = cache_file_name ("contents", command)) == NULL)
+    return NULL;
+  signature = contents_signature (command);
+  if ((fp = open_contents (file, signature)) != NULL)
+    goto done;
+
+  /* stale or missing, run the command and keep its output */
+  tmp = g_strdup_printf ("%s.tmp", file);
+  if ((fp = fopen (tmp, "w")) == NULL)
+    {
+      g_free (tmp);
+      goto done;
+    }
+  if ((pipe = popen (command, "r")) == NULL)
+    {
+      fclose (fp);
+      unlink (tmp);
+      g_free (tmp);
+      fp = NULL;
+      goto done;
+    }
+  fprintf (fp, "%s\n%s\n", CONTENTS_INDEX_MAGIC, signature);
+  while ((n = fread (buffer, 1, sizeof (buffer), pipe)) > 0)
+    fwrite (buffer, 1, n, fp);
+
+  /* don't keep the output of a failed command */
+  ok = pclose (pipe) == 0;
+  if (ferror (fp))
+    ok = false;
+  if (fclose (fp) != 0)
+    ok = false;
+  if (!ok || rename (tmp, file) != 0)
+    {
+      unlink (tmp);
+      fp = NULL;
+    }
+  else
+    fp = open_contents (file, signature);
+  g_free (tmp);
+
+done:
+  g_free (signature);
+  g_free (file);
+  return fp;
+}
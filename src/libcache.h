@@ -0,0 +1,43 @@
+/*!
+ * \file src/libcache.h
+ *
+ * \brief Prototypes for the footprint library index cache.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PCB_LIBCACHE_H
+#define PCB_LIBCACHE_H
+
+#include <stdio.h>
+
+#include "global.h"
+
+/*!
+ * \brief Called once for every directory of a newlib tree, with the
+ * absolute path of the directory and the names of the footprints in it.
+ */
+typedef void (*LibCacheDirFunc) (const char *, GPtrArray *, void *);
+
+int LibCacheScanTree (const char *, bool, LibCacheDirFunc, void *);
+FILE *LibCacheOpenContents (const char *);
+
+#endif /* PCB_LIBCACHE_H */
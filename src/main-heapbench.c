@@ -0,0 +1,306 @@
+/*!
+ * \file src/main-heapbench.c
+ *
+ * \brief Standalone benchmark for the priority queue in heap.c.
+ *
+ * Runs synthetic workloads shaped like the autorouter's use of the
+ * heap, without the rest of pcb:
+ *
+ * - \c sort: N random costs inserted and then all removed in order,
+ *   like the pass heaps in RouteAll().
+ * - \c search: a best-first search front; every removal inserts a few
+ *   more expensive items, until N items have been expanded, like the
+ *   edge heap in RouteOne().
+ * - \c update: N tracked items whose costs are lowered and that are
+ *   taken out again through their handles.
+ *
+ * Build with "make heapbench", and again with
+ * CPPFLAGS=-DHEAP_ARITY=2 to compare against a binary heap.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/time.h>
+
+#include "global.h"
+#include "heap.h"
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*!
+ * \brief Small deterministic generator so that workloads are identical
+ * across platforms and C libraries.
+ */
+static unsigned long bench_seed = 1;
+
+static cost_t
+bench_random (void)
+{
+  bench_seed = bench_seed * 1103515245UL + 12345UL;
+  return (cost_t) ((bench_seed >> 16) % 1000000UL);
+}
+
+/* ---------------------------------------------------------------------------
+ * workloads
+ */
+
+typedef struct
+{
+  unsigned long ops;		/*!< Heap operations performed. */
+  unsigned long max_size;	/*!< Largest size the heap reached. */
+  int ordered;			/*!< Items came out in cost order. */
+} bench_result;
+
+static void
+track_size (bench_result *r, heap_t *heap)
+{
+  if ((unsigned long) heap_size (heap) > r->max_size)
+    r->max_size = heap_size (heap);
+}
+
+static void
+workload_sort (int n, bench_result *r)
+{
+  heap_t *heap = heap_create ();
+  cost_t *costs = (cost_t *) malloc (n * sizeof (*costs));
+  cost_t last = -1;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      costs[i] = bench_random ();
+      heap_insert (heap, costs[i], &costs[i]);
+      r->ops++;
+    }
+  track_size (r, heap);
+  while (!heap_is_empty (heap))
+    {
+      cost_t *c = (cost_t *) heap_remove_smallest (heap);
+
+      if (*c < last)
+	r->ordered = 0;
+      last = *c;
+      r->ops++;
+    }
+  heap_destroy (&heap);
+  free (costs);
+}
+
+static void
+workload_search (int n, bench_result *r)
+{
+  heap_t *heap = heap_create ();
+  cost_t *costs = (cost_t *) malloc ((4 * n + 1) * sizeof (*costs));
+  cost_t last = -1;
+  int used = 0, expanded, k;
+
+  costs[used] = 0;
+  heap_insert (heap, 0, &costs[used++]);
+  r->ops++;
+  for (expanded = 0; expanded < n && !heap_is_empty (heap); expanded++)
+    {
+      cost_t *c = (cost_t *) heap_remove_smallest (heap);
+
+      if (*c < last)
+	r->ordered = 0;
+      last = *c;
+      r->ops++;
+      /* every expansion opens up to four more expensive neighbours */
+      for (k = bench_random () > 400000 ? 4 : 2; k > 0; k--)
+	{
+	  costs[used] = *c + 1 + bench_random () / 1000;
+	  heap_insert (heap, costs[used], &costs[used]);
+	  used++;
+	  r->ops++;
+	}
+      track_size (r, heap);
+    }
+  heap_destroy (&heap);
+  free (costs);
+}
+
+typedef struct
+{
+  cost_t cost;
+  heap_handle_t handle;
+} tracked;
+
+static void
+workload_update (int n, bench_result *r)
+{
+  heap_t *heap = heap_create ();
+  tracked *items = (tracked *) malloc (n * sizeof (*items));
+  cost_t last = -1;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      items[i].cost = bench_random ();
+      heap_insert_handle (heap, items[i].cost, &items[i], &items[i].handle);
+      r->ops++;
+    }
+  track_size (r, heap);
+  /* lower the cost of every item once */
+  for (i = 0; i < n; i++)
+    {
+      items[i].cost /= 2;
+      heap_decrease_key (heap, &items[i].handle, items[i].cost);
+      r->ops++;
+    }
+  /* take every other item out directly */
+  for (i = 0; i < n; i += 2)
+    {
+      if (heap_remove (heap, &items[i].handle) != &items[i]
+	  || items[i].handle != HEAP_NO_HANDLE)
+	r->ordered = 0;
+      r->ops++;
+    }
+  while (!heap_is_empty (heap))
+    {
+      tracked *t = (tracked *) heap_remove_smallest (heap);
+
+      if (t->cost < last)
+	r->ordered = 0;
+      last = t->cost;
+      r->ops++;
+    }
+  heap_destroy (&heap);
+  free (items);
+}
+
+static struct
+{
+  const char *name;
+  void (*run) (int, bench_result *);
+} workloads[] =
+{
+  {"sort", workload_sort},
+  {"search", workload_search},
+  {"update", workload_update}
+};
+#define NUM_WORKLOADS (sizeof (workloads) / sizeof (workloads[0]))
+
+static void
+usage (const char *prog)
+{
+  fprintf (stderr,
+           "usage: %s [options] [workload ...]\n"
+           "  -n N          items per workload (default 1000000)\n"
+           "  -i N          iterations per workload (default 3)\n"
+           "  -s N          random seed (default 1)\n"
+           "  -c            print comma separated values\n"
+           "workloads: sort search update (default: all)\n", prog);
+  exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int n = 1000000, iterations = 3, csv = 0, i, it;
+  unsigned int j;
+  unsigned long seed = 1;
+  int selected[NUM_WORKLOADS];
+  int any = 0, failed = 0;
+
+  memset (selected, 0, sizeof (selected));
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "-c") == 0)
+        csv = 1;
+      else if (argv[i][0] == '-' && i + 1 < argc)
+        {
+          int value = atoi (argv[i + 1]);
+
+          switch (argv[i][1])
+            {
+            case 'n': n = value; break;
+            case 'i': iterations = value; break;
+            case 's': seed = value; break;
+            default: usage (argv[0]);
+            }
+          i++;
+        }
+      else
+        {
+          for (j = 0; j < NUM_WORKLOADS; j++)
+            if (strcmp (argv[i], workloads[j].name) == 0)
+              selected[j] = any = 1;
+          if (!any)
+            usage (argv[0]);
+        }
+    }
+  if (n < 1 || iterations < 1)
+    usage (argv[0]);
+
+  if (csv)
+    printf ("workload,arity,n,iteration,seconds,ops,max_size\n");
+  else
+    printf ("%-6s %5s %8s %4s %10s %10s %10s\n",
+            "load", "arity", "n", "iter", "seconds", "ops", "max size");
+
+  for (j = 0; j < NUM_WORKLOADS; j++)
+    {
+      if (any && !selected[j])
+        continue;
+      for (it = 0; it < iterations; it++)
+        {
+          bench_result r;
+          double t;
+
+          bench_seed = seed;
+          memset (&r, 0, sizeof (r));
+          r.ordered = 1;
+
+          t = now ();
+          workloads[j].run (n, &r);
+          t = now () - t;
+
+          if (!r.ordered)
+            {
+              fprintf (stderr, "%s: items came out of order\n",
+                       workloads[j].name);
+              failed = 1;
+            }
+          if (csv)
+            printf ("%s,%d,%d,%d,%.6f,%lu,%lu\n",
+                    workloads[j].name, HEAP_ARITY, n, it + 1, t, r.ops,
+                    r.max_size);
+          else
+            printf ("%-6s %5d %8d %4d %10.4f %10lu %10lu\n",
+                    workloads[j].name, HEAP_ARITY, n, it + 1, t, r.ops,
+                    r.max_size);
+          fflush (stdout);
+        }
+    }
+  return failed;
+}
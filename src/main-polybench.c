@@ -0,0 +1,509 @@
+/*!
+ * \file src/main-polybench.c
+ *
+ * \brief Standalone benchmark for the polygon clipping library.
+ *
+ * Generates parametric synthetic workloads and runs them through the
+ * routines in polygon1.c, without the rest of pcb (no GUI, no board
+ * data structures):
+ *
+ * - \c pour: a board sized pour with N via clearances cut into it.
+ *   Clearances are united in batches and then subtracted, the same way
+ *   clearPoly() does it for pins and vias.
+ * - \c pads: a square grid of N rectangular pad clearances subtracted
+ *   one by one, like SubtractPad().
+ * - \c arcs: N thick, mutually overlapping arcs subtracted one by one,
+ *   like SubtractArc(), which produces many merging holes.
+ *
+ * For every workload the time spent, the number of boolean operations,
+ * the contours and vertices of the result and the allocator traffic of
+ * polygon1.c, rtree.c and heap.c are reported.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/time.h>
+
+#define POLYBENCH_ALLOCATOR
+#include "global.h"
+#include "polygon.h"
+#include "polybench.h"
+
+/* ---------------------------------------------------------------------------
+ * allocation accounting
+ *
+ * Every block carries a small header holding its size so that the peak
+ * number of live bytes can be tracked across realloc and free.
+ */
+
+typedef union
+{
+  size_t size;
+  double align_d;
+  void *align_p;
+} alloc_header;
+
+static struct
+{
+  unsigned long mallocs;
+  unsigned long frees;
+  size_t live;
+  size_t peak;
+} alloc_stats;
+
+static void *
+account (alloc_header *h, size_t size)
+{
+  if (h == NULL)
+    return NULL;
+  h->size = size;
+  alloc_stats.mallocs++;
+  alloc_stats.live += size;
+  if (alloc_stats.live > alloc_stats.peak)
+    alloc_stats.peak = alloc_stats.live;
+  return h + 1;
+}
+
+void *
+polybench_malloc (size_t size)
+{
+  return account ((alloc_header *) malloc (sizeof (alloc_header) + size),
+                  size);
+}
+
+void *
+polybench_calloc (size_t nmemb, size_t size)
+{
+  return account ((alloc_header *) calloc (1, sizeof (alloc_header) +
+                                           nmemb * size), nmemb * size);
+}
+
+void
+polybench_free (void *ptr)
+{
+  alloc_header *h;
+
+  if (ptr == NULL)
+    return;
+  h = (alloc_header *) ptr - 1;
+  alloc_stats.frees++;
+  alloc_stats.live -= h->size;
+  free (h);
+}
+
+void *
+polybench_realloc (void *ptr, size_t size)
+{
+  alloc_header *h;
+  size_t old;
+
+  if (ptr == NULL)
+    return polybench_malloc (size);
+  h = (alloc_header *) ptr - 1;
+  old = h->size;
+  h = (alloc_header *) realloc (h, sizeof (alloc_header) + size);
+  if (h == NULL)
+    return NULL;
+  h->size = size;
+  alloc_stats.live += size - old;
+  if (alloc_stats.live > alloc_stats.peak)
+    alloc_stats.peak = alloc_stats.live;
+  return h + 1;
+}
+
+/* ---------------------------------------------------------------------------
+ * shape generators
+ *
+ * These mirror CirclePoly(), RectPoly() and ArcPoly() in polygon.c
+ * closely enough to produce the same vertex counts, but do not need the
+ * pcb object types.
+ */
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*!
+ * \brief Small deterministic generator so that workloads are identical
+ * across platforms and C libraries.
+ */
+static unsigned long bench_seed = 1;
+
+static Coord
+bench_random (Coord range)
+{
+  bench_seed = bench_seed * 1103515245UL + 12345UL;
+  return (Coord) ((bench_seed >> 16) % (unsigned long) range);
+}
+
+static POLYAREA *
+finish_contour (PLINE *contour)
+{
+  POLYAREA *p;
+
+  poly_PreContour (contour, TRUE);
+  if (contour->Flags.orient != PLF_DIR)
+    poly_InvContour (contour);
+  p = poly_Create ();
+  if (p == NULL)
+    return NULL;
+  poly_InclContour (p, contour);
+  return p;
+}
+
+static POLYAREA *
+bench_rect (Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  PLINE *contour;
+  Vector v;
+
+  v[0] = x1; v[1] = y1;
+  contour = poly_NewContour (v);
+  v[0] = x2; v[1] = y1;
+  poly_InclVertex (contour->head.prev, poly_CreateNode (v));
+  v[0] = x2; v[1] = y2;
+  poly_InclVertex (contour->head.prev, poly_CreateNode (v));
+  v[0] = x1; v[1] = y2;
+  poly_InclVertex (contour->head.prev, poly_CreateNode (v));
+  return finish_contour (contour);
+}
+
+/*!
+ * \brief Append the points of an arc of radius r around (x, y) from
+ * angle a1 to a2 (radians) in segs steps, including both end points.
+ */
+static void
+add_arc_points (PLINE *contour, Coord x, Coord y, double r,
+                double a1, double a2, int segs)
+{
+  Vector v;
+  int i;
+
+  for (i = 0; i <= segs; i++)
+    {
+      double a = a1 + (a2 - a1) * i / segs;
+      v[0] = x + (Coord) (r * cos (a));
+      v[1] = y + (Coord) (r * sin (a));
+      poly_InclVertex (contour->head.prev, poly_CreateNode (v));
+    }
+}
+
+static POLYAREA *
+bench_circle (Coord x, Coord y, Coord radius)
+{
+  PLINE *contour;
+  Vector v;
+
+  v[0] = x + radius * POLY_CIRC_RADIUS_ADJ;
+  v[1] = y;
+  contour = poly_NewContour (v);
+  add_arc_points (contour, x, y, radius * POLY_CIRC_RADIUS_ADJ,
+                  2 * M_PI / POLY_CIRC_SEGS,
+                  2 * M_PI * (POLY_CIRC_SEGS - 1) / POLY_CIRC_SEGS,
+                  POLY_CIRC_SEGS - 2);
+  contour->is_round = TRUE;
+  contour->cx = x;
+  contour->cy = y;
+  contour->radius = radius;
+  return finish_contour (contour);
+}
+
+/*!
+ * \brief A thick arc with round caps, centered on (x, y).
+ */
+static POLYAREA *
+bench_arc (Coord x, Coord y, Coord radius, double start, double delta,
+           Coord thick)
+{
+  PLINE *contour;
+  Vector v;
+  double half = thick / 2.0;
+  double end = start + delta;
+  int segs = MAX (4, (int) (delta * 180 / M_PI / 5));
+
+  v[0] = x + (Coord) ((radius - half) * cos (start));
+  v[1] = y + (Coord) ((radius - half) * sin (start));
+  contour = poly_NewContour (v);
+  add_arc_points (contour, x, y, radius - half, start + delta / segs, end,
+                  segs - 1);
+  add_arc_points (contour, x + (Coord) (radius * cos (end)),
+                  y + (Coord) (radius * sin (end)), half,
+                  end + M_PI - 2 * M_PI / POLY_CIRC_SEGS, end,
+                  POLY_CIRC_SEGS / 2 - 1);
+  add_arc_points (contour, x, y, radius + half, end - delta / segs, start,
+                  segs - 1);
+  add_arc_points (contour, x + (Coord) (radius * cos (start)),
+                  y + (Coord) (radius * sin (start)), half,
+                  start - 2 * M_PI / POLY_CIRC_SEGS,
+                  start - M_PI + 2 * M_PI / POLY_CIRC_SEGS,
+                  POLY_CIRC_SEGS / 2 - 2);
+  return finish_contour (contour);
+}
+
+/* ---------------------------------------------------------------------------
+ * workloads
+ */
+
+#define BOARD_SIZE	MIL_TO_COORD (4000)
+#define VIA_CLEARANCE	MIL_TO_COORD (20)
+#define PAD_SIZE	MIL_TO_COORD (30)
+#define ARC_THICK	MIL_TO_COORD (10)
+
+typedef struct
+{
+  int n;		/*!< Number of objects in the workload. */
+  int batch;		/*!< Clearances united before each subtraction. */
+} bench_params;
+
+typedef struct
+{
+  unsigned long ops;	/*!< Number of poly_Boolean* calls. */
+  POLYAREA *result;
+} bench_result;
+
+static POLYAREA *
+board_pour (void)
+{
+  return bench_rect (0, 0, BOARD_SIZE, BOARD_SIZE);
+}
+
+static void
+subtract (bench_result *r, POLYAREA *np)
+{
+  POLYAREA *res;
+
+  poly_Boolean_free (r->result, np, &res, PBO_SUB);
+  r->result = res;
+  r->ops++;
+}
+
+static void
+workload_pour (bench_params *p, bench_result *r)
+{
+  POLYAREA *accumulate = NULL, *merged;
+  int i, batch = 0;
+
+  r->result = board_pour ();
+  for (i = 0; i < p->n; i++)
+    {
+      Coord x = VIA_CLEARANCE + bench_random (BOARD_SIZE - 2 * VIA_CLEARANCE);
+      Coord y = VIA_CLEARANCE + bench_random (BOARD_SIZE - 2 * VIA_CLEARANCE);
+
+      poly_Boolean_free (accumulate, bench_circle (x, y, VIA_CLEARANCE),
+                         &merged, PBO_UNITE);
+      accumulate = merged;
+      r->ops++;
+      if (++batch == p->batch)
+        {
+          subtract (r, accumulate);
+          accumulate = NULL;
+          batch = 0;
+        }
+    }
+  if (accumulate != NULL)
+    subtract (r, accumulate);
+}
+
+static void
+workload_pads (bench_params *p, bench_result *r)
+{
+  int side = MAX (1, (int) ceil (sqrt (p->n)));
+  Coord pitch = (BOARD_SIZE - PAD_SIZE) / (side + 1);
+  int i;
+
+  r->result = board_pour ();
+  for (i = 0; i < p->n; i++)
+    {
+      Coord x = pitch * (1 + i % side);
+      Coord y = pitch * (1 + i / side);
+
+      subtract (r, bench_rect (x, y, x + PAD_SIZE, y + PAD_SIZE / 2));
+    }
+}
+
+static void
+workload_arcs (bench_params *p, bench_result *r)
+{
+  int i;
+
+  r->result = board_pour ();
+  for (i = 0; i < p->n; i++)
+    {
+      Coord radius = MIL_TO_COORD (50) + bench_random (MIL_TO_COORD (400));
+      Coord x = radius + ARC_THICK
+        + bench_random (BOARD_SIZE - 2 * (radius + ARC_THICK));
+      Coord y = radius + ARC_THICK
+        + bench_random (BOARD_SIZE - 2 * (radius + ARC_THICK));
+      double start = bench_random (360) * M_PI / 180;
+      double delta = (30 + bench_random (240)) * M_PI / 180;
+
+      subtract (r, bench_arc (x, y, radius, start, delta, ARC_THICK));
+    }
+}
+
+static struct
+{
+  const char *name;
+  void (*run) (bench_params *, bench_result *);
+} workloads[] = {
+  {"pour", workload_pour},
+  {"pads", workload_pads},
+  {"arcs", workload_arcs},
+};
+
+#define NUM_WORKLOADS (sizeof (workloads) / sizeof (workloads[0]))
+
+/* ---------------------------------------------------------------------------
+ * reporting
+ */
+
+static void
+count_result (POLYAREA *pa, unsigned long *contours, unsigned long *vertices)
+{
+  POLYAREA *p = pa;
+  PLINE *c;
+
+  *contours = *vertices = 0;
+  if (pa == NULL)
+    return;
+  do
+    {
+      for (c = p->contours; c; c = c->next)
+        {
+          (*contours)++;
+          *vertices += c->Count;
+        }
+    }
+  while ((p = p->f) != pa);
+}
+
+static void
+usage (const char *prog)
+{
+  fprintf (stderr,
+           "usage: %s [options] [workload ...]\n"
+           "  -n N          objects per workload (default 1000)\n"
+           "  -b N          clearances united per subtraction in the pour\n"
+           "                workload (default 100, like clearPoly)\n"
+           "  -i N          iterations per workload (default 3)\n"
+           "  -s N          random seed (default 1)\n"
+           "  -c            print comma separated values\n"
+           "workloads: pour pads arcs (default: all)\n", prog);
+  exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  bench_params params;
+  int iterations = 3, csv = 0, i, j, it;
+  unsigned long seed = 1;
+  int selected[NUM_WORKLOADS];
+  int any = 0;
+
+  params.n = 1000;
+  params.batch = 100;
+  memset (selected, 0, sizeof (selected));
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "-c") == 0)
+        csv = 1;
+      else if (argv[i][0] == '-' && i + 1 < argc)
+        {
+          int value = atoi (argv[i + 1]);
+
+          switch (argv[i][1])
+            {
+            case 'n': params.n = value; break;
+            case 'b': params.batch = value; break;
+            case 'i': iterations = value; break;
+            case 's': seed = value; break;
+            default: usage (argv[0]);
+            }
+          i++;
+        }
+      else
+        {
+          for (j = 0; j < NUM_WORKLOADS; j++)
+            if (strcmp (argv[i], workloads[j].name) == 0)
+              break;
+          if (j == NUM_WORKLOADS)
+            usage (argv[0]);
+          selected[j] = any = 1;
+        }
+    }
+  if (params.n < 1 || params.batch < 1 || iterations < 1)
+    usage (argv[0]);
+
+  if (csv)
+    printf ("workload,n,iteration,seconds,ops,contours,vertices,"
+            "mallocs,frees,peak_bytes\n");
+  else
+    printf ("%-6s %7s %4s %10s %8s %9s %10s %10s %10s %12s\n",
+            "load", "n", "iter", "seconds", "ops", "contours", "vertices",
+            "mallocs", "frees", "peak bytes");
+
+  for (j = 0; j < NUM_WORKLOADS; j++)
+    {
+      if (any && !selected[j])
+        continue;
+      for (it = 0; it < iterations; it++)
+        {
+          bench_result r;
+          unsigned long contours, vertices;
+          double t;
+
+          bench_seed = seed;
+          memset (&r, 0, sizeof (r));
+          memset (&alloc_stats, 0, sizeof (alloc_stats));
+
+          t = now ();
+          workloads[j].run (&params, &r);
+          t = now () - t;
+
+          count_result (r.result, &contours, &vertices);
+          poly_Free (&r.result);
+
+          if (csv)
+            printf ("%s,%d,%d,%.6f,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                    workloads[j].name, params.n, it + 1, t, r.ops,
+                    contours, vertices, alloc_stats.mallocs,
+                    alloc_stats.frees, (unsigned long) alloc_stats.peak);
+          else
+            printf ("%-6s %7d %4d %10.4f %8lu %9lu %10lu %10lu %10lu %12lu\n",
+                    workloads[j].name, params.n, it + 1, t, r.ops,
+                    contours, vertices, alloc_stats.mallocs,
+                    alloc_stats.frees, (unsigned long) alloc_stats.peak);
+          fflush (stdout);
+        }
+    }
+  return 0;
+}
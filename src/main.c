@@ -60,6 +60,7 @@
 #include "polygon.h"
 #include "gettext.h"
 #include "pcb-printf.h"
+#include "perf.h"
 
 #include "hid/common/actions.h"
 
@@ -1074,6 +1075,50 @@ The default value is @code{60}.
   ISET (BackupInterval, 60, "backup-interval",
   "Time between automatic backups in seconds. Set to 0 to disable"),
 
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --undo-budget <num>
+Memory budget of the undo list in MB.  When the undo list grows beyond
+it, the oldest operations are dropped and can no longer be undone.  Set
+to @code{0} for no limit.  The default value is @code{256}.  The memory
+in use is shown by @code{Report(Undo)}.
+@end ftable
+%end-doc
+*/
+  ISET (UndoBudget, 256, "undo-budget",
+  "Memory budget of the undo list in MB. Set to 0 for no limit"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --autoroute-jobs <num>
+Number of nets the autorouter routes at the same time, each in its own
+process.  Only nets whose bounding boxes are apart are routed together;
+a net whose route comes too close to one committed earlier in the same
+batch is routed again.  The result differs slightly from the one of the
+sequential router.  The default value is @code{1}, which routes one net
+at a time.  Live routing always routes one net at a time.
+@end ftable
+%end-doc
+*/
+  ISET (AutorouteJobs, 1, "autoroute-jobs",
+  "Number of nets the autorouter routes in parallel"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --autoroute-negotiate
+Let the autorouter negotiate congestion between nets.  Every refinement
+pass remembers where traces still conflict, and routing through a
+conflict costs more the more often that place was contested before, so
+that nets which keep competing for the same area end up taking turns
+instead of ripping each other up pass after pass.  Up to 40 refinement
+passes are run instead of 12; like before, the refinement stops as
+soon as no conflicts remain.
+@end ftable
+%end-doc
+*/
+  BSET (AutorouteNegotiate, 0, "autoroute-negotiate",
+  "Negotiate congestion between nets in the autorouter"),
+
 /* %start-doc options "4 Layer Names"
 @ftable @code
 @item --layer-name-1 <string>
@@ -1549,6 +1594,75 @@ Execute the bell command when all rats are routed.
 */
   BSET (RingBellWhenFinished, 0, "ring-bell-finished",
        "Execute the bell command when all rats are routed"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --perf-counters
+Start the performance counters at start-up, so that the loading of the
+layout given on the command line is measured too.  The counters are
+shown with @code{Report(Perf)}; the batch GUI prints them on exit.
+@end ftable
+%end-doc
+*/
+  BSET (PerfCounters, 0, "perf-counters",
+       "Start the performance counters at start-up"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --batch-scripts
+Run every @code{ExecuteFile} script as if it were wrapped in
+@code{BeginBatch()} and @code{EndBatch()}: the whole script becomes a
+single undo step, and drawing, polygon clipping and rat line updates
+are done once when the script ends.
+@end ftable
+%end-doc
+*/
+  BSET (BatchScripts, 0, "batch-scripts",
+       "Run ExecuteFile scripts as one batch"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --startup-profile
+Print the wall time spent in each phase of the start-up (HID setup,
+settings, argument parsing, board creation and loading, library and
+start-up scripts) to stderr, right before the GUI or exporter starts.
+The footprint library is only read at start-up for interactive GUIs;
+exporters and the batch GUI read it when a footprint is first looked
+up by name.
+@end ftable
+%end-doc
+*/
+  BSET (StartupProfile, 0, "startup-profile",
+       "Print how long each start-up phase took"),
+
+/* %start-doc options "5 Paths"
+@ftable @code
+@item --lib-cache
+Keep an index of the footprint libraries in the user cache directory
+(usually @file{~/.cache/pcb}), so that unchanged library directories
+are not read again and the library contents command is not run again
+at start-up.  Enabled by default, use @code{--no-lib-cache} to always
+read the libraries from scratch.
+@end ftable
+%end-doc
+*/
+  BSET (LibraryCache, 1, "lib-cache",
+       "Keep an index of the footprint libraries"),
+
+/* %start-doc options "2 General GUI Options"
+@ftable @code
+@item --draw-lod
+Simplify what is too small to see at the current zoom level.  Text and
+pin names smaller than a few pixels are not drawn, lines, arcs, pads,
+pins and vias smaller than two pixels are drawn as rectangles, and
+polygon outlines skip vertices closer than a pixel to each other.
+Enabled by default, use @code{--no-draw-lod} to always draw at full
+detail.  Exporters always draw at full detail.
+@end ftable
+%end-doc
+*/
+  BSET (DrawLOD, 1, "draw-lod",
+       "Simplify objects too small to see when zoomed out"),
 };
 
 REGISTER_ATTRIBUTES (main_attribute_list)
@@ -1629,6 +1743,8 @@ REGISTER_ATTRIBUTES (main_attribute_list)
   copy_nonzero_increments (get_increments_struct (IMPERIAL), &increment_mil);
 
   Settings.increments = get_increments_struct (Settings.grid_unit->family);
+
+  perf_enabled = Settings.PerfCounters;
 }
 
 /*!
@@ -1881,11 +1997,59 @@ char *program_directory = 0;
  * - evaluate command-line arguments
  * - register 'call on exit()' function
  */
+/* ---------------------------------------------------------------------- 
+ * start-up profiling
+ */
+#define MAX_STARTUP_PHASES 16
+
+static struct
+{
+  const char *name;
+  double time;
+} startup_phase[MAX_STARTUP_PHASES];
+static int n_startup_phases = 0;
+
+/*!
+ * \brief Marks the end of the start-up phase \a name.
+ *
+ * This is cheap enough to always run; --startup-profile is not known
+ * before the command line has been parsed.
+ */
+static void
+startup_mark (const char *name)
+{
+  if (n_startup_phases < MAX_STARTUP_PHASES)
+    {
+      startup_phase[n_startup_phases].name = name;
+      startup_phase[n_startup_phases].time = perf_now ();
+      n_startup_phases++;
+    }
+}
+
+static void
+print_startup_profile (void)
+{
+  int i;
+
+  if (!Settings.StartupProfile || n_startup_phases < 2)
+    return;
+
+  fprintf (stderr, "Start-up profile:\n");
+  for (i = 1; i < n_startup_phases; i++)
+    fprintf (stderr, "  %-12s %10.3f ms\n", startup_phase[i].name,
+	     1000 * (startup_phase[i].time - startup_phase[i - 1].time));
+  fprintf (stderr, "  %-12s %10.3f ms\n", "total",
+	   1000 * (startup_phase[n_startup_phases - 1].time
+		   - startup_phase[0].time));
+}
+
 int
 main (int argc, char *argv[])
 {
   int i;
 
+  startup_mark ("start");
+
 #include "core_lists.h"
   setbuf (stdout, 0);
   InitPaths (argv[0]);
@@ -1904,8 +2068,10 @@ main (int argc, char *argv[])
   initialize_units();
   polygon_init ();
   hid_init ();
+  startup_mark ("hids");
 
   hid_load_settings ();
+  startup_mark ("settings");
 
   program_name = argv[0];
   program_basename = strrchr (program_name, PCB_DIR_SEPARATOR_C);
@@ -1950,6 +2116,7 @@ main (int argc, char *argv[])
   /* Exit with error if GUI failed to start. */
   if (!gui)
     exit (1);
+  startup_mark ("gui");
 
   /* Set up layers. */
   for (i = 0; i < MAX_LAYER; i++)
@@ -1973,7 +2140,7 @@ main (int argc, char *argv[])
     copyright ();
 
   settings_post_process ();
-
+  startup_mark ("arguments");
 
   if (show_actions)
     {
@@ -2003,6 +2170,7 @@ main (int argc, char *argv[])
   InitHandler ();
   InitBuffers ();
   SetMode (ARROW_MODE);
+  startup_mark ("board");
 
   if (command_line_pcb)
     {
@@ -2011,6 +2179,7 @@ main (int argc, char *argv[])
        */
       if (LoadPCB (command_line_pcb))
 	PCB->Filename = strdup (command_line_pcb);
+      startup_mark ("load");
     }
 
   if (Settings.InitialLayerStack
@@ -2034,10 +2203,14 @@ main (int argc, char *argv[])
    */
   atexit (EmergencySave);
 
-  /* read the library file and display it if it's not empty
+  /* read the library file and display it if it's not empty; only
+   * interactive GUIs show it, everybody else reads it on demand
    */
-  if (!ReadLibraryContents () && Library.MenuN)
-    hid_action ("LibraryChanged");
+  if (gui->gui && strcmp (gui->name, "batch") != 0)
+    {
+      EnsureLibraryContents ();
+      startup_mark ("library");
+    }
 
 #ifdef HAVE_LIBSTROKE
   stroke_init ();
@@ -2054,9 +2227,12 @@ main (int argc, char *argv[])
       Message (_("Executing startup action %s\n"), Settings.ActionString);
       hid_parse_actions (Settings.ActionString);
     }
+  if (Settings.ScriptFilename || Settings.ActionString)
+    startup_mark ("scripts");
 
   if (gui->printer || gui->exporter)
     {
+      print_startup_profile ();
       gui->do_export (0);
       exit (0);
     }
@@ -2084,6 +2260,7 @@ main (int argc, char *argv[])
           UNKNOWN (Settings.GnetlistProgram));
 #endif
 
+  print_startup_profile ();
   gui->do_export (0);
 #if HAVE_DBUS
   pcb_dbus_finish();
@@ -1253,6 +1253,9 @@ AssignDefaultLayerTypes()
 void
 QuitApplication (void)
 {
+  /* let a running autosave finish before anything is torn down */
+  WaitForBackup ();
+
   /*
    * save data if necessary.  It not needed, then don't trigger EmergencySave
    * via our atexit() registering of EmergencySave().  We presumeably wanted to
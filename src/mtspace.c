@@ -56,6 +56,7 @@
 #include "heap.h"
 #include "rtree.h"
 #include "mtspace.h"
+#include "perf.h"
 #include "vector.h"
 
 #ifdef HAVE_LIBDMALLOC
@@ -73,6 +74,29 @@ typedef struct mtspacebox
 }
 mtspacebox_t;
 
+/*!
+ * \brief A region that has been vetted against the fixed objects.
+ *
+ * Neighbouring expansion areas often ask for via sites in the same
+ * region with the same via size, and the fixed objects do not move
+ * while routing, so the parts of such a region that are clear of fixed
+ * objects are kept and handed to the next query for the same region.
+ */
+typedef struct mts_cache_entry
+{
+  struct mts_cache_entry *next;
+  BoxType region;		/*!< The query region, bloated. */
+  Coord radius, keepaway;
+  int n;			/*!< Number of boxes in clear. */
+  BoxType *clear;		/*!< Parts of region clear of fixed objects. */
+} mts_cache_entry_t;
+
+#define MTS_CACHE_BUCKETS 1024
+/*!
+ * \brief Entries kept before the cache is flushed.
+ */
+#define MTS_CACHE_MAX 8192
+
 /*!
  * \brief This is an mtspace_t.
  *
@@ -83,6 +107,11 @@ mtspacebox_t;
 struct mtspace
 {
   rtree_t *ftree, *etree, *otree;
+  mts_cache_entry_t *cache[MTS_CACHE_BUCKETS];
+  int cache_count;
+  /*! Bumped whenever the fixed tree changes, so that vetting still in
+     progress does not store stale results in the cache. */
+  unsigned long fixed_serial;
 };
 
 typedef union
@@ -103,6 +132,10 @@ struct vetting
   Coord radius;
   Coord keepaway;
   CheapPointType desired;
+  /* recording of the fixed object pass, for the cache */
+  BoxType region;
+  vector_t *clear;		/*!< Copies of the no_fix results so far. */
+  unsigned long fixed_serial;
 };
 
 #define SPECIAL 823157
@@ -120,6 +153,122 @@ mtspace_create_box (const BoxType * box, Coord keepaway)
   return mtsb;
 }
 
+static unsigned int
+mts_cache_hash (const BoxType * region, Coord radius, Coord keepaway)
+{
+  unsigned long h = (unsigned long) region->X1;
+
+  h = h * 31 + (unsigned long) region->Y1;
+  h = h * 31 + (unsigned long) region->X2;
+  h = h * 31 + (unsigned long) region->Y2;
+  h = h * 31 + (unsigned long) radius;
+  h = h * 31 + (unsigned long) keepaway;
+  return (h ^ (h >> 15)) % MTS_CACHE_BUCKETS;
+}
+
+static mts_cache_entry_t *
+mts_cache_lookup (mtspace_t * mtspace, const BoxType * region,
+		  Coord radius, Coord keepaway)
+{
+  mts_cache_entry_t *e;
+
+  for (e = mtspace->cache[mts_cache_hash (region, radius, keepaway)];
+       e; e = e->next)
+    if (e->radius == radius && e->keepaway == keepaway &&
+	e->region.X1 == region->X1 && e->region.Y1 == region->Y1 &&
+	e->region.X2 == region->X2 && e->region.Y2 == region->Y2)
+      return e;
+  return NULL;
+}
+
+static void
+mts_cache_flush (mtspace_t * mtspace)
+{
+  int i;
+
+  for (i = 0; i < MTS_CACHE_BUCKETS; i++)
+    while (mtspace->cache[i])
+      {
+	mts_cache_entry_t *e = mtspace->cache[i];
+
+	mtspace->cache[i] = e->next;
+	free (e->clear);
+	free (e);
+      }
+  mtspace->cache_count = 0;
+}
+
+/*!
+ * \brief Forget the cached regions a change to the fixed tree at
+ * \a box can affect.
+ *
+ * This walks the whole cache, but the fixed objects are only added
+ * while the route data is built, when the cache is still empty.
+ */
+static void
+mts_cache_invalidate (mtspace_t * mtspace, const BoxType * box)
+{
+  int i;
+
+  mtspace->fixed_serial++;
+  if (mtspace->cache_count == 0)
+    return;
+  for (i = 0; i < MTS_CACHE_BUCKETS; i++)
+    {
+      mts_cache_entry_t **ep = &mtspace->cache[i];
+
+      while (*ep)
+	{
+	  mts_cache_entry_t *e = *ep;
+
+	  if (box_intersect (&e->region, box))
+	    {
+	      *ep = e->next;
+	      free (e->clear);
+	      free (e);
+	      mtspace->cache_count--;
+	    }
+	  else
+	    ep = &e->next;
+	}
+    }
+}
+
+/*!
+ * \brief Store the recorded fixed object pass of \a work, which has
+ * just run to completion.
+ */
+static void
+mts_cache_store (mtspace_t * mtspace, vetting_t * work)
+{
+  mts_cache_entry_t *e;
+  unsigned int h;
+  int i;
+
+  if (work->fixed_serial == mtspace->fixed_serial &&
+      !mts_cache_lookup (mtspace, &work->region, work->radius,
+			 work->keepaway))
+    {
+      if (mtspace->cache_count >= MTS_CACHE_MAX)
+	mts_cache_flush (mtspace);
+      e = (mts_cache_entry_t *) malloc (sizeof (*e));
+      e->region = work->region;
+      e->radius = work->radius;
+      e->keepaway = work->keepaway;
+      e->n = vector_size (work->clear);
+      e->clear = (BoxType *) malloc (MAX (e->n, 1) * sizeof (BoxType));
+      for (i = 0; i < e->n; i++)
+	e->clear[i] = *(BoxType *) vector_element (work->clear, i);
+      h = mts_cache_hash (&e->region, e->radius, e->keepaway);
+      e->next = mtspace->cache[h];
+      mtspace->cache[h] = e;
+      mtspace->cache_count++;
+    }
+  while (!vector_is_empty (work->clear))
+    free (vector_remove_last (work->clear));
+  vector_destroy (&work->clear);
+}
+
 /*!
  * \brief Create an "empty space" representation with a shrunken
  * boundary.
@@ -130,7 +279,7 @@ mtspace_create (void)
   mtspace_t *mtspace;
 
   /* create mtspace data structure */
-  mtspace = (mtspace_t *)malloc (sizeof (*mtspace));
+  mtspace = (mtspace_t *)calloc (1, sizeof (*mtspace));
   mtspace->ftree = r_create_tree (NULL, 0, 0);
   mtspace->etree = r_create_tree (NULL, 0, 0);
   mtspace->otree = r_create_tree (NULL, 0, 0);
@@ -145,6 +294,7 @@ void
 mtspace_destroy (mtspace_t ** mtspacep)
 {
   assert (mtspacep);
+  mts_cache_flush (*mtspacep);
   r_destroy_tree (&(*mtspacep)->ftree);
   r_destroy_tree (&(*mtspacep)->etree);
   r_destroy_tree (&(*mtspacep)->otree);
@@ -203,6 +353,8 @@ mtspace_add (mtspace_t * mtspace, const BoxType * box, mtspace_type_t which,
 	     Coord keepaway)
 {
   mtspacebox_t *filler = mtspace_create_box (box, keepaway);
+  if (which == FIXED)
+    mts_cache_invalidate (mtspace, box);
   r_insert_entry (which_tree (mtspace, which), (const BoxType *) filler, 1);
 }
 
@@ -220,6 +372,8 @@ mtspace_remove (mtspace_t * mtspace,
   struct mts_info cl;
   BoxType small_search;
 
+  if (which == FIXED)
+    mts_cache_invalidate (mtspace, box);
   cl.keepaway = keepaway;
   cl.box = *box;
   cl.tree = which_tree (mtspace, which);
@@ -231,6 +385,21 @@ mtspace_remove (mtspace_t * mtspace,
     }
 }
 
+/*!
+ * \brief Remove all space-fillers of one kind at once.
+ */
+void
+mtspace_clear (mtspace_t * mtspace, mtspace_type_t which)
+{
+  rtree_t **tree = which == FIXED ? &mtspace->ftree
+    : which == EVEN ? &mtspace->etree : &mtspace->otree;
+
+  if (which == FIXED)
+    mts_cache_flush (mtspace);
+  r_destroy_tree (tree);
+  *tree = r_create_tree (NULL, 0, 0);
+}
+
 struct query_closure
 {
   BoxType *cbox;
@@ -368,11 +537,10 @@ query_one (const BoxType * box, void *cl)
  * don't intersect that thing (if possible) which are put back into the
  * vector/heap of regions to check.
  *
- * \return qloop returns false when it finds the first empty region.
- * It returns true if it has exhausted the region vector/heap and never
- * found an empty area.
+ * \return the first empty region found, or \c NULL if the region
+ * vector/heap was exhausted without finding one.
  */
-static void
+static BoxType *
 qloop (struct query_closure *qc, rtree_t * tree, heap_or_vector res, bool is_vec)
 {
   BoxType *cbox;
@@ -401,9 +569,10 @@ qloop (struct query_closure *qc, rtree_t * tree, heap_or_vector res, bool is_vec
               else
 	        vector_append (res.v, cbox);
             }
-	  return;		/* found one - perhaps one answer is good enough */
+	  return cbox;		/* found one - perhaps one answer is good enough */
 	}
     }
+  return NULL;
 }
 
 /*!
@@ -413,6 +582,12 @@ void
 mtsFreeWork (vetting_t ** w)
 {
   vetting_t *work = (*w);
+  if (work->clear)
+    {
+      while (!vector_is_empty (work->clear))
+	free (vector_remove_last (work->clear));
+      vector_destroy (&work->clear);
+    }
   if (work->desired.X != -SPECIAL || work->desired.Y != -SPECIAL)
     {
        heap_free (work->untested.h, free);
@@ -484,6 +659,8 @@ mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
   if (region)
     {
       BoxType *cbox;
+      mts_cache_entry_t *hit;
+      int i;
       assert (work == NULL);
       assert (box_is_good (region));
       assert(vector_is_empty (free_space_vec));
@@ -492,8 +669,21 @@ mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
       work = (vetting_t *) malloc (sizeof (vetting_t));
       work->keepaway = keepaway;
       work->radius = radius;
+      work->region = bloat_box (region, keepaway + radius);
+      work->fixed_serial = mtspace->fixed_serial;
+      hit = mts_cache_lookup (mtspace, &work->region, radius, keepaway);
+      if (hit)
+	{
+	  PERF_COUNT (PERF_MTS_CACHE_HITS, 1);
+	  work->clear = NULL;
+	}
+      else
+	{
+	  PERF_COUNT (PERF_MTS_CACHE_MISSES, 1);
+	  work->clear = vector_create ();
+	}
       cbox = (BoxType *) malloc (sizeof (BoxType));
-      *cbox = bloat_box (region, keepaway + radius);
+      *cbox = work->region;
       if (desired)
         {
           work->untested.h = heap_create ();
@@ -502,7 +692,6 @@ mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
           work->no_hi.h =heap_create ();
           assert (work->untested.h && work->no_fix.h &&
                   work->no_hi.h && work->hi_candidate.h);
-          heap_insert (work->untested.h, 0, cbox);
           work->desired = *desired;
         }
       else
@@ -513,9 +702,27 @@ mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
           work->no_hi.v = vector_create ();
           assert (work->untested.v && work->no_fix.v &&
                   work->no_hi.v && work->hi_candidate.v);
-          vector_append (work->untested.v, cbox);
           work->desired.X = work->desired.Y = -SPECIAL;
         }
+      if (hit)
+	{
+	  /* start from the parts already known to be clear of fixed
+	     objects */
+	  free (cbox);
+	  for (i = 0; i < hit->n; i++)
+	    {
+	      cbox = (BoxType *) malloc (sizeof (BoxType));
+	      *cbox = hit->clear[i];
+	      if (desired)
+		heap_append (work->no_fix.h, &work->desired, cbox);
+	      else
+		vector_append (work->no_fix.v, cbox);
+	    }
+	}
+      else if (desired)
+	heap_insert (work->untested.h, 0, cbox);
+      else
+	vector_append (work->untested.v, cbox);
       return work;
     }
   qc.keepaway = work->keepaway;
@@ -528,12 +735,25 @@ mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
   do
     {
       heap_or_vector temporary = {free_space_vec};
+      BoxType *found;
       /* search the fixed object tree discarding any intersections
        * and placing empty regions in the no_fix vector.
        */
       qc.checking = work->untested;
       qc.touching.v = NULL;
-      qloop (&qc, mtspace->ftree, work->no_fix, false);
+      found = qloop (&qc, mtspace->ftree, work->no_fix, false);
+      if (work->clear)
+	{
+	  if (found)
+	    {
+	      BoxType *copy = (BoxType *) malloc (sizeof (BoxType));
+	      *copy = *found;
+	      vector_append (work->clear, copy);
+	    }
+	  if (qc.desired ? heap_is_empty (work->untested.h)
+	      : vector_is_empty (work->untested.v))
+	    mts_cache_store (mtspace, work);
+	}
       /* search the hi-conflict tree placing intersectors in the
        * hi_candidate vector (if conflicts are allowed) and
        * placing empty regions in the no_hi vector.
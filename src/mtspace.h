@@ -64,6 +64,7 @@ void mtspace_add (mtspace_t * mtspace,
 void mtspace_remove (mtspace_t * mtspace,
                      const BoxType * box, mtspace_type_t which,
                      Coord keepaway);
+void mtspace_clear (mtspace_t * mtspace, mtspace_type_t which);
 
 
 vetting_t *mtspace_query_rect (mtspace_t * mtspace, const BoxType * region,
@@ -0,0 +1,155 @@
+/*!
+ * \file src/perf.c
+ *
+ * \brief Lightweight performance counters and timers.
+ *
+ * This module only holds the counters; the instrumentation points live
+ * in the modules being measured and the report is built by Report(Perf)
+ * in report.c.  It has no dependencies beyond the C library so that the
+ * polygon benchmark can link it as well.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/time.h>
+
+#include "perf.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+bool perf_enabled = false;
+unsigned long perf_counter[PERF_COUNTER_COUNT];
+PerfTimeType perf_time[PERF_TIMER_COUNT];
+PerfTimeType perf_layer_time[MAX_ALL_LAYER];
+
+static const char *counter_names[PERF_COUNTER_COUNT] = {
+  "r_search calls",
+  "r_search nodes visited",
+  "polygon boolean calls",
+  "polygon boolean vertices",
+  "connection lookups",
+  "connection objects found",
+  "largest connection lookup",
+  "undo slots",
+  "undo list reallocations",
+  "files parsed",
+  "footprint cache hits",
+  "polygons re-clipped by batched undo",
+  "objects simplified when zoomed out",
+  "nets re-routed after a parallel conflict",
+  "via site searches served from the cache",
+  "via site searches vetted from scratch",
+  "route edges outside the search window",
+  "route searches repeated in a wider window"
+};
+
+static const char *timer_names[PERF_TIMER_COUNT] = {
+  "redraw",
+  "file parsing"
+};
+
+/*!
+ * \brief Returns the wall clock time in seconds.
+ */
+double
+perf_now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*!
+ * \brief Adds the interval since \a start to \a t.
+ *
+ * A start time of zero means the counters were switched on while the
+ * interval was running; such an interval is dropped.
+ */
+void
+perf_time_add (PerfTimeType *t, double start)
+{
+  if (start == 0.0)
+    return;
+  t->Seconds += perf_now () - start;
+  t->Calls++;
+}
+
+void
+perf_reset (void)
+{
+  memset (perf_counter, 0, sizeof (perf_counter));
+  memset (perf_time, 0, sizeof (perf_time));
+  memset (perf_layer_time, 0, sizeof (perf_layer_time));
+}
+
+/*!
+ * \brief Stores in \a delta what was counted since the counters held
+ * \a before.
+ *
+ * Used by forked worker processes, whose counts would otherwise be lost
+ * with them.  Counters kept with PERF_MAX () are passed on as they are.
+ */
+void
+perf_counters_since (unsigned long *delta, const unsigned long *before)
+{
+  int i;
+
+  for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    delta[i] = i == PERF_FIND_LARGEST ? perf_counter[i]
+				      : perf_counter[i] - before[i];
+}
+
+/*!
+ * \brief Adds counts a worker process took with perf_counters_since ().
+ */
+void
+perf_counters_merge (const unsigned long *delta)
+{
+  int i;
+
+  if (!perf_enabled)
+    return;
+  for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    if (i == PERF_FIND_LARGEST)
+      PERF_MAX (i, delta[i]);
+    else
+      perf_counter[i] += delta[i];
+}
+
+const char *
+perf_counter_name (PerfCounterType c)
+{
+  return counter_names[c];
+}
+
+const char *
+perf_timer_name (PerfTimerType t)
+{
+  return timer_names[t];
+}
@@ -0,0 +1,107 @@
+/*!
+ * \file src/perf.h
+ *
+ * \brief Lightweight performance counters and timers.
+ *
+ * The counters are always compiled in.  Every update is guarded by the
+ * global perf_enabled flag, so while they are switched off (the default)
+ * each instrumentation point costs a single load and a predictable
+ * branch.  They are switched on with the --perf-counters option or with
+ * Report(Perf, On), and read back with Report(Perf).
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PCB_PERF_H
+#define PCB_PERF_H
+
+#include "global.h"
+
+typedef enum
+{
+  PERF_RSEARCH_CALLS,		/*!< Calls of r_search (). */
+  PERF_RSEARCH_NODES,		/*!< R-tree nodes visited by r_search (). */
+  PERF_POLY_BOOLEAN_CALLS,	/*!< Calls of poly_Boolean_free (). */
+  PERF_POLY_BOOLEAN_VERTICES,	/*!< Input vertices of those calls. */
+  PERF_FIND_FLOODS,		/*!< Connection lookups run to completion. */
+  PERF_FIND_OBJECTS,		/*!< Objects found by all lookups. */
+  PERF_FIND_LARGEST,		/*!< Objects found by the largest lookup. */
+  PERF_UNDO_SLOTS,		/*!< Undo slots handed out. */
+  PERF_UNDO_GROWS,		/*!< Reallocations of the undo list. */
+  PERF_FILES_PARSED,		/*!< Layout, element and font files parsed. */
+  PERF_ELEMENT_CACHE_HITS,	/*!< Footprint loads served from the cache. */
+  PERF_UNDO_RECLIPS,		/*!< Polygons re-clipped after a batched undo. */
+  PERF_DRAW_LOD,		/*!< Objects simplified or skipped by the LOD. */
+  PERF_ROUTE_REQUEUES,		/*!< Nets routed again after a parallel conflict. */
+  PERF_MTS_CACHE_HITS,		/*!< Via site searches started from the cache. */
+  PERF_MTS_CACHE_MISSES,	/*!< Via site searches vetted from scratch. */
+  PERF_ROUTE_EDGES_PRUNED,	/*!< Edges dropped outside the search window. */
+  PERF_ROUTE_WINDOW_WIDENED,	/*!< Searches repeated in a wider window. */
+  PERF_COUNTER_COUNT
+} PerfCounterType;
+
+typedef enum
+{
+  PERF_TIME_DRAW,		/*!< Time spent in DrawEverything (). */
+  PERF_TIME_PARSE,		/*!< Time spent in the file parser. */
+  PERF_TIMER_COUNT
+} PerfTimerType;
+
+typedef struct
+{
+  double Seconds;		/*!< Accumulated wall time. */
+  unsigned long Calls;		/*!< Number of timed intervals. */
+} PerfTimeType;
+
+extern bool perf_enabled;
+extern unsigned long perf_counter[PERF_COUNTER_COUNT];
+extern PerfTimeType perf_time[PERF_TIMER_COUNT];
+extern PerfTimeType perf_layer_time[MAX_ALL_LAYER];
+
+#define PERF_COUNT(c, n) \
+  do { if (perf_enabled) perf_counter[c] += (n); } while (0)
+
+#define PERF_MAX(c, n) \
+  do { if (perf_enabled && (unsigned long) (n) > perf_counter[c]) \
+	 perf_counter[c] = (n); } while (0)
+
+/*!
+ * \brief Starts an interval; \a t is a double holding the start time.
+ */
+#define PERF_START(t) \
+  ((t) = perf_enabled ? perf_now () : 0.0)
+
+#define PERF_STOP(which, t) \
+  do { if (perf_enabled) perf_time_add (&perf_time[which], (t)); } while (0)
+
+#define PERF_STOP_LAYER(layer, t) \
+  do { if (perf_enabled && (layer) >= 0 && (layer) < MAX_ALL_LAYER) \
+	 perf_time_add (&perf_layer_time[layer], (t)); } while (0)
+
+double perf_now (void);
+void perf_time_add (PerfTimeType *, double);
+void perf_reset (void);
+void perf_counters_since (unsigned long *, const unsigned long *);
+void perf_counters_merge (const unsigned long *);
+const char *perf_counter_name (PerfCounterType);
+const char *perf_timer_name (PerfTimerType);
+
+#endif /* PCB_PERF_H */
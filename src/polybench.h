@@ -0,0 +1,59 @@
+/*!
+ * \file src/polybench.h
+ *
+ * \brief Allocation accounting hooks for the polygon benchmark.
+ *
+ * When the polygon clipping sources are compiled for the polybench
+ * program (with PCB_POLYBENCH defined), this header is included after
+ * all system headers and routes the allocator calls of polygon1.c,
+ * rtree.c and heap.c through counting wrappers defined in
+ * main-polybench.c.
+ *
+ * It has no effect on the regular pcb build.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PCB_POLYBENCH_H
+#define PCB_POLYBENCH_H
+
+#include <stddef.h>
+
+void *polybench_malloc (size_t size);
+void *polybench_calloc (size_t nmemb, size_t size);
+void *polybench_realloc (void *ptr, size_t size);
+void polybench_free (void *ptr);
+
+/* main-polybench.c defines POLYBENCH_ALLOCATOR so that the wrappers
+ * themselves still reach the C library allocator.
+ */
+#if defined (PCB_POLYBENCH) && !defined (POLYBENCH_ALLOCATOR)
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#define malloc(n)	polybench_malloc (n)
+#define calloc(n, s)	polybench_calloc ((n), (s))
+#define realloc(p, n)	polybench_realloc ((p), (n))
+#define free(p)		polybench_free (p)
+#endif
+
+#endif /* PCB_POLYBENCH_H */
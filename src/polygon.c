@@ -1655,12 +1655,112 @@ PlowsPolygon (DataType * Data, int type, void *ptr1, void *ptr2,
   return r;
 }
 
+/*!
+ * \brief Nesting depth of DeferPolygonClipping() calls.
+ */
+static int defer_clip = 0;
+
+/*!
+ * \brief IDs of the board polygons that need a fresh InitClip() once
+ * deferred clipping ends.
+ */
+static GHashTable *deferred_polys = NULL;
+
+static void
+mark_deferred (PolygonType *Polygon)
+{
+  g_hash_table_insert (deferred_polys, GINT_TO_POINTER (Polygon->ID),
+                       GINT_TO_POINTER (1));
+}
+
+static int
+mark_plow (DataType *Data, LayerType *Layer, PolygonType *Polygon,
+           int type, void *ptr1, void *ptr2, void *userdata)
+{
+  mark_deferred (Polygon);
+  return 1;
+}
+
+/*!
+ * \brief Record the polygons an object change would re-clip.
+ *
+ * \return True if clipping is deferred and the caller has nothing
+ * more to do.
+ */
+static bool
+defer_plow (DataType *Data, int type, void *ptr1, void *ptr2)
+{
+  if (!defer_clip || Data != PCB->Data)
+    return false;
+
+  if (type == POLYGON_TYPE)
+    mark_deferred ((PolygonType *) ptr2);
+  else
+    PlowsPolygon (Data, type, ptr1, ptr2, mark_plow, NULL);
+  return true;
+}
+
+/*!
+ * \brief Start collecting polygon clipping work instead of doing it.
+ *
+ * Until the matching FlushPolygonClipping(), RestoreToPolygon() and
+ * ClearFromPolygon() on the board only remember which clearing
+ * polygons were touched.  This turns many incremental subtractions
+ * from the same polygon into a single InitClip() per polygon.
+ *
+ * Calls may be nested; only the outermost flush does the work.
+ */
+void
+DeferPolygonClipping (void)
+{
+  if (deferred_polys == NULL)
+    deferred_polys = g_hash_table_new (NULL, NULL);
+  defer_clip++;
+}
+
+/*!
+ * \brief Re-clip every board polygon touched since
+ * DeferPolygonClipping().
+ *
+ * Polygons are looked up by ID, so ones that were removed in the
+ * meantime are simply skipped.
+ *
+ * \return The number of polygons that were re-clipped.
+ */
+int
+FlushPolygonClipping (void)
+{
+  int n = 0;
+
+  if (defer_clip == 0 || --defer_clip > 0)
+    return 0;
+
+  if (g_hash_table_size (deferred_polys) == 0)
+    return 0;
+
+  ALLPOLYGON_LOOP (PCB->Data);
+  {
+    if (g_hash_table_lookup (deferred_polys, GINT_TO_POINTER (polygon->ID)))
+      {
+        InitClip (PCB->Data, layer, polygon);
+        n++;
+      }
+  }
+  ENDALL_LOOP;
+
+  g_hash_table_remove_all (deferred_polys);
+  return n;
+}
+
 void
 RestoreToPolygon (DataType * Data, int type, void *ptr1, void *ptr2)
 {
   if (!Data->polyClip)
     return;
 
+  if (defer_plow (Data, type, ptr1, ptr2))
+    return;
+
   if (type == POLYGON_TYPE)
     InitClip (PCB->Data, (LayerType *) ptr1, (PolygonType *) ptr2);
   else
@@ -1673,6 +1773,9 @@ ClearFromPolygon (DataType * Data, int type, void *ptr1, void *ptr2)
   if (!Data->polyClip)
     return;
 
+  if (defer_plow (Data, type, ptr1, ptr2))
+    return;
+
   if (type == POLYGON_TYPE)
     InitClip (PCB->Data, (LayerType *) ptr1, (PolygonType *) ptr2);
   else
@@ -50,6 +50,11 @@
 #include "pcb-printf.h"
 #include "rtree.h"
 #include "heap.h"
+#include "perf.h"
+
+#ifdef PCB_POLYBENCH
+#include "polybench.h"
+#endif
 
 #define ROUND(a) (long)((a) > 0 ? ((a) + 0.5) : ((a) - 0.5))
 
@@ -2284,6 +2289,27 @@ Touching (POLYAREA * a, POLYAREA * b)
 }
 
 /* the main clipping routines */
+/* number of vertices in all contours of all islands of p, for the
+ * performance counters
+ */
+static unsigned long
+vertex_count (POLYAREA * p)
+{
+  POLYAREA *n = p;
+  PLINE *c;
+  unsigned long count = 0;
+
+  if (p == NULL)
+    return 0;
+  do
+    {
+      for (c = n->contours; c; c = c->next)
+	count += c->Count;
+    }
+  while ((n = n->f) != p);
+  return count;
+}
+
 int
 poly_Boolean (const POLYAREA * a_org, const POLYAREA * b_org,
 	      POLYAREA ** res, int action)
@@ -2308,6 +2334,13 @@ poly_Boolean_free (POLYAREA * ai, POLYAREA * bi, POLYAREA ** res, int action)
 
   *res = NULL;
 
+  if (perf_enabled)
+    {
+      perf_counter[PERF_POLY_BOOLEAN_CALLS]++;
+      perf_counter[PERF_POLY_BOOLEAN_VERTICES] +=
+	vertex_count (a) + vertex_count (b);
+    }
+
   if (!a)
     {
       switch (action)
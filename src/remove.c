@@ -37,6 +37,7 @@
 
 #include "global.h"
 
+#include "autoroute.h"
 #include "data.h"
 #include "draw.h"
 #include "error.h"
@@ -480,8 +481,8 @@ RemovePolygonContour (LayerType *Layer,
         Draw ();
     }
 
-  /* Copy the polygon to the undo list */
-  AddObjectToRemoveContourUndoList (POLYGON_TYPE, Layer, Polygon);
+  /* Copy the contour to the undo list */
+  AddObjectToRemoveContourUndoList (POLYGON_TYPE, Layer, Polygon, contour);
 
   contour_start = (contour == 0) ? 0 : Polygon->HoleIndex[contour - 1];
   contour_end = (contour == Polygon->HoleIndexN) ? Polygon->PointN :
@@ -648,5 +649,7 @@ DestroyObject (DataType *Target, int Type, void *Ptr1,
 	       void *Ptr2, void *Ptr3)
 {
   DestroyTarget = Target;
+  if (Target == PCB->Data)
+    AutoRouteObjectChanged (Type, Ptr1, Ptr2, true);
   return (ObjectOperation (&DestroyFunctions, Type, Ptr1, Ptr2, Ptr3));
 }
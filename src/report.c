@@ -49,6 +49,7 @@
 #include "find.h"
 #include "draw.h"
 #include "pcb-printf.h"
+#include "perf.h"
 #ifdef HAVE_REGEX_H
 #include <regex.h>
 #endif
@@ -948,7 +949,9 @@ ReportNetLengthByName (char *tofind, int x, int y)
  */
 
 static const char report_syntax[] =
-  N_("Report(Object|DrillReport|FoundPins|NetLength|AllNetLengths|[,name])");
+  N_("Report(Object|DrillReport|FoundPins|NetLength|AllNetLengths|[,name])\n"
+     "Report(Perf[,On|Off|Reset])\n"
+     "Report(Undo)");
 
 static const char report_help[] = N_("Produce various report.");
 
@@ -977,10 +980,107 @@ The name and length of the net under the crosshair will be reported to
 the message log.  An optional parameter specifies mm, mil, pcb, or in
 units
 
+@item Perf
+The performance counters will be reported: r-tree searches, polygon
+operations, connection lookups, undo slots, parsed files and the time
+spent redrawing each layer and parsing files.  With a second argument
+of @code{On} or @code{Off} the counters are started or stopped, and
+@code{Reset} sets them back to zero.  The counters can also be started
+at start-up with @code{--perf-counters}.
+
+@item Undo
+The number of operations on the undo and redo lists and the memory
+they hold will be reported, together with the budget set by
+@code{--undo-budget}.
+
 @end table
 
 %end-doc */
 
+/* ---------------------------------------------------------------------------
+ * reports the performance counters, or switches them on, off or back to
+ * zero
+ */
+static int
+ReportPerf (int argc, char **argv, Coord x, Coord y)
+{
+  static DynamicStringType list;
+  char temp[128];
+  int i;
+
+  if (argc == 1)
+    {
+      if (strcasecmp (argv[0], "On") == 0)
+	perf_enabled = true;
+      else if (strcasecmp (argv[0], "Off") == 0)
+	perf_enabled = false;
+      else if (strcasecmp (argv[0], "Reset") == 0)
+	perf_reset ();
+      else
+	AFAIL (report);
+      return 0;
+    }
+
+  DSClearString (&list);
+  if (!perf_enabled)
+    DSAddString (&list, _("Performance counters are off, "
+			  "use Report(Perf, On) to start them.\n\n"));
+  for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+      sprintf (temp, "%-28s %12lu\n",
+	       perf_counter_name (i), perf_counter[i]);
+      DSAddString (&list, temp);
+    }
+  DSAddString (&list, "\n");
+  for (i = 0; i < PERF_TIMER_COUNT; i++)
+    {
+      sprintf (temp, "%-28s %12.6f s %8lu calls\n",
+	       perf_timer_name (i), perf_time[i].Seconds, perf_time[i].Calls);
+      DSAddString (&list, temp);
+    }
+
+  DSAddString (&list, _("\nRedraw time per layer:\n"));
+  for (i = 0; i < MAX_ALL_LAYER; i++)
+    {
+      if (perf_layer_time[i].Calls == 0)
+	continue;
+      sprintf (temp, "%-28.28s %12.6f s %8lu calls\n",
+	       UNKNOWN (PCB->Data->Layer[i].Name),
+	       perf_layer_time[i].Seconds, perf_layer_time[i].Calls);
+      DSAddString (&list, temp);
+    }
+
+  gui->report_dialog (_("Performance Counters"), list.Data);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * reports the size of the undo list
+ */
+static int
+ReportUndo (int argc, char **argv, Coord x, Coord y)
+{
+  size_t undo, redo, bytes;
+  char *msg;
+
+  GetUndoUsage (&undo, &redo, &bytes);
+  if (Settings.UndoBudget > 0)
+    msg = g_strdup_printf (_("Undo entries: %lu\n"
+			     "Redo entries: %lu\n"
+			     "Memory used:  %.1f MB of %d MB\n"),
+			   (unsigned long) undo, (unsigned long) redo,
+			   bytes / 1048576.0, Settings.UndoBudget);
+  else
+    msg = g_strdup_printf (_("Undo entries: %lu\n"
+			     "Redo entries: %lu\n"
+			     "Memory used:  %.1f MB, no budget\n"),
+			   (unsigned long) undo, (unsigned long) redo,
+			   bytes / 1048576.0);
+  gui->report_dialog (_("Undo List"), msg);
+  g_free (msg);
+  return 0;
+}
+
 static int
 Report (int argc, char **argv, Coord x, Coord y)
 {
@@ -1001,6 +1101,10 @@ Report (int argc, char **argv, Coord x, Coord y)
     return ReportAllNetLengths (argc - 1, argv + 1, x, y);
   else if ((strcasecmp (argv[0], "NetLength") == 0) && (argc == 2))
     return ReportNetLengthByName (argv[1], x, y);
+  else if (strcasecmp (argv[0], "Perf") == 0)
+    return ReportPerf (argc - 1, argv + 1, x, y);
+  else if ((strcasecmp (argv[0], "Undo") == 0) && (argc == 1))
+    return ReportUndo (argc - 1, argv + 1, x, y);
   else if (argc == 2)
     AUSAGE (report);
   else
@@ -46,12 +46,17 @@
 
 #include "mymem.h"
 
+#include "perf.h"
 #include "rtree.h"
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
 #endif
 
+#ifdef PCB_POLYBENCH
+#include "polybench.h"
+#endif
+
 #define SLOW_ASSERTS
 /* All rectangles are closed on the bottom left and open on the
  * top right. i.e. they contain one corner point, but not the other.
@@ -483,6 +488,7 @@ __r_search (struct rtree_node *node, const BoxType * query, r_arg * arg)
   /** assert that node is well formed */
   assert (__r_node_is_good (node));
 #endif
+  PERF_COUNT (PERF_RSEARCH_NODES, 1);
   /* the check for bounds is done before entry. This saves the overhead
    * of building/destroying the stack frame for each bounds that fails
    * to intersect, which is the most common condition.
@@ -564,6 +570,7 @@ r_search (rtree_t * rtree, const BoxType * query,
 {
   r_arg arg;
 
+  PERF_COUNT (PERF_RSEARCH_CALLS, 1);
   if (!rtree || rtree->size < 1)
     return 0;
   if (query)
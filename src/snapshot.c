@@ -0,0 +1,1388 @@
+/*!
+ * \file src/snapshot.c
+ *
+ * \brief Binary board snapshots.
+ *
+ * A snapshot holds the same information as a .pcb file in a form that
+ * can be written and read back without any text formatting or parsing.
+ * It is selected by the SNAPSHOT_SUFFIX file name suffix in SavePCB()
+ * and LoadPCB().
+ *
+ * The file starts with an eight byte magic string followed by the
+ * format version and a reserved word.  The rest of the file is a
+ * sequence of sections, each made of a four character tag, the length
+ * of its body and the body itself:
+ *
+ * - STRS: the string table; every string in the other sections is
+ *   stored as an index into it, with 0 standing for NULL.
+ * - HEAD: board name, size, grid, DRC settings, flags, layer groups,
+ *   route styles and board attributes.
+ * - FONT: the symbols of the board font.
+ * - VIAS, ELEM, RATS: vias, elements with their pins, pads and
+ *   silk, and rat lines.
+ * - LAYR: one per layer, with its lines, arcs, text and polygons.
+ * - CLIP: optional, one per layer with polygons; the clipped contours
+ *   of those polygons, so that they need not be clipped again on load.
+ *   Polygons without one are clipped as usual.
+ * - NETS: the netlist.
+ *
+ * All integers are little-endian, coordinates are stored as 64 bit
+ * integers regardless of the size of Coord, angles as IEEE doubles.
+ * Readers skip sections they do not know.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+
+#include "create.h"
+#include "data.h"
+#include "error.h"
+#include "misc.h"
+#include "perf.h"
+#include "polygon.h"
+#include "remove.h"
+#include "rtree.h"
+#include "snapshot.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define SNAPSHOT_MAGIC "PCBSNAP"	/* plus the terminating NUL */
+#define SNAPSHOT_MAGIC_LEN 8
+
+#define TAG(a, b, c, d) \
+  ((guint32) (a) | (guint32) (b) << 8 | (guint32) (c) << 16 | (guint32) (d) << 24)
+
+#define TAG_STRS TAG ('S', 'T', 'R', 'S')
+#define TAG_HEAD TAG ('H', 'E', 'A', 'D')
+#define TAG_FONT TAG ('F', 'O', 'N', 'T')
+#define TAG_VIAS TAG ('V', 'I', 'A', 'S')
+#define TAG_ELEM TAG ('E', 'L', 'E', 'M')
+#define TAG_RATS TAG ('R', 'A', 'T', 'S')
+#define TAG_LAYR TAG ('L', 'A', 'Y', 'R')
+#define TAG_CLIP TAG ('C', 'L', 'I', 'P')
+#define TAG_NETS TAG ('N', 'E', 'T', 'S')
+
+/* ---------------------------------------------------------------------------
+ * writing
+ */
+
+typedef struct
+{
+  GHashTable *index;		/* string -> index in table */
+  GPtrArray *table;		/* the strings, owned by index */
+} SnapshotWriterType;
+
+static void
+put_u8 (GByteArray *b, guint8 v)
+{
+  g_byte_array_append (b, &v, 1);
+}
+
+static void
+put_u32 (GByteArray *b, guint32 v)
+{
+  guint8 buf[4];
+  int i;
+
+  for (i = 0; i < 4; i++)
+    buf[i] = v >> (8 * i);
+  g_byte_array_append (b, buf, 4);
+}
+
+static void
+put_u64 (GByteArray *b, guint64 v)
+{
+  guint8 buf[8];
+  int i;
+
+  for (i = 0; i < 8; i++)
+    buf[i] = v >> (8 * i);
+  g_byte_array_append (b, buf, 8);
+}
+
+static void
+put_coord (GByteArray *b, Coord c)
+{
+  put_u64 (b, (guint64) (gint64) c);
+}
+
+static void
+put_double (GByteArray *b, double d)
+{
+  guint64 v;
+
+  memcpy (&v, &d, sizeof (v));
+  put_u64 (b, v);
+}
+
+static void
+put_flags (GByteArray *b, FlagType *f)
+{
+  put_u64 (b, f->f);
+  put_u8 (b, sizeof (f->t));
+  g_byte_array_append (b, f->t, sizeof (f->t));
+}
+
+static void
+put_string (SnapshotWriterType *w, GByteArray *b, const char *s)
+{
+  gpointer index;
+
+  if (s == NULL)
+    {
+      put_u32 (b, 0);
+      return;
+    }
+  index = g_hash_table_lookup (w->index, s);
+  if (index == NULL)
+    {
+      char *copy = g_strdup (s);
+
+      g_ptr_array_add (w->table, copy);
+      index = GUINT_TO_POINTER (w->table->len);
+      g_hash_table_insert (w->index, copy, index);
+    }
+  put_u32 (b, GPOINTER_TO_UINT (index));
+}
+
+static void
+put_attributes (SnapshotWriterType *w, GByteArray *b, AttributeListType *list)
+{
+  int i;
+
+  put_u32 (b, list->Number);
+  for (i = 0; i < list->Number; i++)
+    {
+      put_string (w, b, list->List[i].name);
+      put_string (w, b, list->List[i].value);
+    }
+}
+
+static void
+write_head (SnapshotWriterType *w, GByteArray *b, PCBType *pcb)
+{
+  int i;
+
+  put_string (w, b, pcb->Name);
+  put_coord (b, pcb->MaxWidth);
+  put_coord (b, pcb->MaxHeight);
+  put_coord (b, pcb->Grid);
+  put_coord (b, pcb->GridOffsetX);
+  put_coord (b, pcb->GridOffsetY);
+  put_coord (b, pcb->CursorX);
+  put_coord (b, pcb->CursorY);
+  put_double (b, pcb->IsleArea);
+  put_double (b, pcb->ThermScale);
+  put_coord (b, pcb->Bloat);
+  put_coord (b, pcb->Shrink);
+  put_coord (b, pcb->minWid);
+  put_coord (b, pcb->minSlk);
+  put_coord (b, pcb->minDrill);
+  put_coord (b, pcb->minRing);
+  put_flags (b, &pcb->Flags);
+  put_string (w, b, LayerGroupsToString (&pcb->LayerGroups));
+  put_u32 (b, NUM_STYLES);
+  for (i = 0; i < NUM_STYLES; i++)
+    {
+      put_string (w, b, pcb->RouteStyle[i].Name);
+      put_coord (b, pcb->RouteStyle[i].Thick);
+      put_coord (b, pcb->RouteStyle[i].Diameter);
+      put_coord (b, pcb->RouteStyle[i].Hole);
+      put_coord (b, pcb->RouteStyle[i].Keepaway);
+    }
+  put_attributes (w, b, &pcb->Attributes);
+}
+
+static void
+write_font (GByteArray *b, FontType *font)
+{
+  Cardinal i, j, n = 0;
+
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    if (font->Symbol[i].Valid)
+      n++;
+  put_u32 (b, n);
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    {
+      SymbolType *symbol = &font->Symbol[i];
+
+      if (!symbol->Valid)
+	continue;
+      put_u32 (b, i);
+      put_coord (b, symbol->Delta);
+      put_u32 (b, symbol->LineN);
+      for (j = 0; j < symbol->LineN; j++)
+	{
+	  put_coord (b, symbol->Line[j].Point1.X);
+	  put_coord (b, symbol->Line[j].Point1.Y);
+	  put_coord (b, symbol->Line[j].Point2.X);
+	  put_coord (b, symbol->Line[j].Point2.Y);
+	  put_coord (b, symbol->Line[j].Thickness);
+	}
+    }
+}
+
+static void
+write_vias (SnapshotWriterType *w, GByteArray *b, DataType *data)
+{
+  GList *n;
+
+  put_u32 (b, g_list_length (data->Via));
+  for (n = data->Via; n != NULL; n = g_list_next (n))
+    {
+      PinType *via = n->data;
+
+      put_coord (b, via->X);
+      put_coord (b, via->Y);
+      put_coord (b, via->Thickness);
+      put_coord (b, via->Clearance);
+      put_coord (b, via->Mask);
+      put_coord (b, via->DrillingHole);
+      put_string (w, b, via->Name);
+      put_flags (b, &via->Flags);
+    }
+}
+
+static void
+write_elements (SnapshotWriterType *w, GByteArray *b, DataType *data)
+{
+  GList *n, *p;
+
+  put_u32 (b, g_list_length (data->Element));
+  for (n = data->Element; n != NULL; n = g_list_next (n))
+    {
+      ElementType *element = n->data;
+
+      put_flags (b, &element->Flags);
+      put_string (w, b, DESCRIPTION_NAME (element));
+      put_string (w, b, NAMEONPCB_NAME (element));
+      put_string (w, b, VALUE_NAME (element));
+      put_coord (b, element->MarkX);
+      put_coord (b, element->MarkY);
+      put_coord (b, DESCRIPTION_TEXT (element).X);
+      put_coord (b, DESCRIPTION_TEXT (element).Y);
+      put_u8 (b, DESCRIPTION_TEXT (element).Direction);
+      put_u32 (b, DESCRIPTION_TEXT (element).Scale);
+      put_flags (b, &DESCRIPTION_TEXT (element).Flags);
+      put_attributes (w, b, &element->Attributes);
+
+      put_u32 (b, element->PinN);
+      for (p = element->Pin; p != NULL; p = g_list_next (p))
+	{
+	  PinType *pin = p->data;
+
+	  put_coord (b, pin->X);
+	  put_coord (b, pin->Y);
+	  put_coord (b, pin->Thickness);
+	  put_coord (b, pin->Clearance);
+	  put_coord (b, pin->Mask);
+	  put_coord (b, pin->DrillingHole);
+	  put_string (w, b, pin->Name);
+	  put_string (w, b, pin->Number);
+	  put_flags (b, &pin->Flags);
+	}
+      put_u32 (b, element->PadN);
+      for (p = element->Pad; p != NULL; p = g_list_next (p))
+	{
+	  PadType *pad = p->data;
+
+	  put_coord (b, pad->Point1.X);
+	  put_coord (b, pad->Point1.Y);
+	  put_coord (b, pad->Point2.X);
+	  put_coord (b, pad->Point2.Y);
+	  put_coord (b, pad->Thickness);
+	  put_coord (b, pad->Clearance);
+	  put_coord (b, pad->Mask);
+	  put_string (w, b, pad->Name);
+	  put_string (w, b, pad->Number);
+	  put_flags (b, &pad->Flags);
+	}
+      put_u32 (b, element->LineN);
+      for (p = element->Line; p != NULL; p = g_list_next (p))
+	{
+	  LineType *line = p->data;
+
+	  put_coord (b, line->Point1.X);
+	  put_coord (b, line->Point1.Y);
+	  put_coord (b, line->Point2.X);
+	  put_coord (b, line->Point2.Y);
+	  put_coord (b, line->Thickness);
+	}
+      put_u32 (b, element->ArcN);
+      for (p = element->Arc; p != NULL; p = g_list_next (p))
+	{
+	  ArcType *arc = p->data;
+
+	  put_coord (b, arc->X);
+	  put_coord (b, arc->Y);
+	  put_coord (b, arc->Width);
+	  put_coord (b, arc->Height);
+	  put_double (b, arc->StartAngle);
+	  put_double (b, arc->Delta);
+	  put_coord (b, arc->Thickness);
+	}
+    }
+}
+
+static void
+write_rats (GByteArray *b, DataType *data)
+{
+  GList *n;
+
+  put_u32 (b, g_list_length (data->Rat));
+  for (n = data->Rat; n != NULL; n = g_list_next (n))
+    {
+      RatType *rat = n->data;
+
+      put_coord (b, rat->Point1.X);
+      put_coord (b, rat->Point1.Y);
+      put_u32 (b, rat->group1);
+      put_coord (b, rat->Point2.X);
+      put_coord (b, rat->Point2.Y);
+      put_u32 (b, rat->group2);
+      put_flags (b, &rat->Flags);
+    }
+}
+
+static void
+write_layer (SnapshotWriterType *w, GByteArray *b, Cardinal number,
+	     LayerType *layer)
+{
+  GList *n;
+  Cardinal i;
+
+  put_u32 (b, number);
+  put_string (w, b, layer->Name);
+  put_u32 (b, layer->Type);
+  put_attributes (w, b, &layer->Attributes);
+
+  put_u32 (b, layer->LineN);
+  for (n = layer->Line; n != NULL; n = g_list_next (n))
+    {
+      LineType *line = n->data;
+
+      put_coord (b, line->Point1.X);
+      put_coord (b, line->Point1.Y);
+      put_coord (b, line->Point2.X);
+      put_coord (b, line->Point2.Y);
+      put_coord (b, line->Thickness);
+      put_coord (b, line->Clearance);
+      put_flags (b, &line->Flags);
+    }
+  put_u32 (b, layer->ArcN);
+  for (n = layer->Arc; n != NULL; n = g_list_next (n))
+    {
+      ArcType *arc = n->data;
+
+      put_coord (b, arc->X);
+      put_coord (b, arc->Y);
+      put_coord (b, arc->Width);
+      put_coord (b, arc->Height);
+      put_coord (b, arc->Thickness);
+      put_coord (b, arc->Clearance);
+      put_double (b, arc->StartAngle);
+      put_double (b, arc->Delta);
+      put_flags (b, &arc->Flags);
+    }
+  put_u32 (b, layer->TextN);
+  for (n = layer->Text; n != NULL; n = g_list_next (n))
+    {
+      TextType *text = n->data;
+
+      put_coord (b, text->X);
+      put_coord (b, text->Y);
+      put_u8 (b, text->Direction);
+      put_u32 (b, text->Scale);
+      put_string (w, b, text->TextString);
+      put_flags (b, &text->Flags);
+    }
+  put_u32 (b, layer->PolygonN);
+  for (n = layer->Polygon; n != NULL; n = g_list_next (n))
+    {
+      PolygonType *polygon = n->data;
+
+      put_flags (b, &polygon->Flags);
+      put_u32 (b, polygon->HoleIndexN);
+      for (i = 0; i < polygon->HoleIndexN; i++)
+	put_u32 (b, polygon->HoleIndex[i]);
+      put_u32 (b, polygon->PointN);
+      for (i = 0; i < polygon->PointN; i++)
+	{
+	  put_coord (b, polygon->Points[i].X);
+	  put_coord (b, polygon->Points[i].Y);
+	}
+    }
+}
+
+/*!
+ * \brief Writes the clipped contours of the polygons of one layer, in
+ * the same order as write_layer() wrote the polygons.
+ */
+static void
+write_clip (GByteArray *b, Cardinal number, LayerType *layer)
+{
+  GList *n;
+
+  put_u32 (b, number);
+  put_u32 (b, layer->PolygonN);
+  for (n = layer->Polygon; n != NULL; n = g_list_next (n))
+    {
+      PolygonType *polygon = n->data;
+      POLYAREA *pa;
+      PLINE *contour;
+      VNODE *v;
+      guint32 islands = 0, contours;
+
+      if ((pa = polygon->Clipped) != NULL)
+	do
+	  islands++;
+	while ((pa = pa->f) != polygon->Clipped);
+      put_u32 (b, islands);
+      if (!islands)
+	continue;
+
+      pa = polygon->Clipped;
+      do
+	{
+	  for (contours = 0, contour = pa->contours; contour;
+	       contour = contour->next)
+	    contours++;
+	  put_u32 (b, contours);
+	  for (contour = pa->contours; contour; contour = contour->next)
+	    {
+	      put_u32 (b, contour->Count);
+	      v = &contour->head;
+	      do
+		{
+		  put_coord (b, v->point[0]);
+		  put_coord (b, v->point[1]);
+		}
+	      while ((v = v->next) != &contour->head);
+	    }
+	}
+      while ((pa = pa->f) != polygon->Clipped);
+    }
+}
+
+static void
+write_nets (SnapshotWriterType *w, GByteArray *b, LibraryType *netlist)
+{
+  int n, p;
+
+  put_u32 (b, netlist->MenuN);
+  for (n = 0; n < netlist->MenuN; n++)
+    {
+      LibraryMenuType *menu = &netlist->Menu[n];
+
+      put_string (w, b, &menu->Name[2]);
+      put_string (w, b, menu->Style);
+      put_u32 (b, menu->EntryN);
+      for (p = 0; p < menu->EntryN; p++)
+	put_string (w, b, menu->Entry[p].ListEntry);
+    }
+}
+
+static bool
+write_section (FILE *FP, guint32 tag, GByteArray *body)
+{
+  GByteArray *head = g_byte_array_new ();
+  bool ok;
+
+  put_u32 (head, tag);
+  put_u64 (head, body->len);
+  ok = fwrite (head->data, 1, head->len, FP) == head->len
+    && fwrite (body->data, 1, body->len, FP) == body->len;
+  g_byte_array_free (head, TRUE);
+  return ok;
+}
+
+/*!
+ * \brief Writes a snapshot of \a pcb to \a Filename.
+ *
+ * If \a clipped is set, the clipped polygon contours are included.
+ *
+ * \return STATUS_OK or STATUS_ERROR.
+ */
+int
+WriteSnapshot (char *Filename, PCBType *pcb, bool clipped)
+{
+  SnapshotWriterType w;
+  GPtrArray *sections = g_ptr_array_new ();
+  GArray *tags = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GByteArray *b, *strings;
+  DataType *data = pcb->Data;
+  FILE *fp;
+  Cardinal i;
+  guint32 tag;
+  bool ok;
+
+  w.index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  w.table = g_ptr_array_new ();
+
+#define NEW_SECTION(t) \
+  (b = g_byte_array_new (), g_ptr_array_add (sections, b), \
+   tag = (t), g_array_append_val (tags, tag))
+
+  NEW_SECTION (TAG_HEAD);
+  write_head (&w, b, pcb);
+  if (pcb->Font.Valid)
+    {
+      NEW_SECTION (TAG_FONT);
+      write_font (b, &pcb->Font);
+    }
+  NEW_SECTION (TAG_VIAS);
+  write_vias (&w, b, data);
+  NEW_SECTION (TAG_ELEM);
+  write_elements (&w, b, data);
+  NEW_SECTION (TAG_RATS);
+  write_rats (b, data);
+  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
+    {
+      LayerType *layer = &data->Layer[i];
+
+      /* same rule as the text format */
+      if (!layer->LineN && !layer->ArcN && !layer->TextN && !layer->PolygonN
+	  && !(layer->Name && *layer->Name))
+	continue;
+      NEW_SECTION (TAG_LAYR);
+      write_layer (&w, b, i, layer);
+      if (clipped && layer->PolygonN)
+	{
+	  NEW_SECTION (TAG_CLIP);
+	  write_clip (b, i, layer);
+	}
+    }
+  if (pcb->NetlistLib.MenuN)
+    {
+      NEW_SECTION (TAG_NETS);
+      write_nets (&w, b, &pcb->NetlistLib);
+    }
+
+#undef NEW_SECTION
+
+  /* the string table is complete only now, but goes first */
+  strings = g_byte_array_new ();
+  put_u32 (strings, w.table->len);
+  for (i = 0; i < w.table->len; i++)
+    {
+      char *s = g_ptr_array_index (w.table, i);
+      guint32 len = strlen (s);
+
+      put_u32 (strings, len);
+      g_byte_array_append (strings, (guint8 *) s, len);
+    }
+
+  ok = false;
+  if ((fp = fopen (Filename, "wb")) == NULL)
+    OpenErrorMessage (Filename);
+  else
+    {
+      GByteArray *head = g_byte_array_new ();
+
+      g_byte_array_append (head, (guint8 *) SNAPSHOT_MAGIC,
+			   SNAPSHOT_MAGIC_LEN);
+      put_u32 (head, SNAPSHOT_VERSION);
+      put_u32 (head, 0);
+      ok = fwrite (head->data, 1, head->len, fp) == head->len
+	&& write_section (fp, TAG_STRS, strings);
+      g_byte_array_free (head, TRUE);
+      for (i = 0; ok && i < sections->len; i++)
+	ok = write_section (fp, g_array_index (tags, guint32, i),
+			    g_ptr_array_index (sections, i));
+      if (fclose (fp) != 0)
+	ok = false;
+      if (!ok)
+	Message (_("Error writing snapshot %s\n"), Filename);
+    }
+
+  for (i = 0; i < sections->len; i++)
+    g_byte_array_free (g_ptr_array_index (sections, i), TRUE);
+  g_ptr_array_free (sections, TRUE);
+  g_array_free (tags, TRUE);
+  g_byte_array_free (strings, TRUE);
+  g_ptr_array_free (w.table, TRUE);
+  g_hash_table_destroy (w.index);
+
+  return ok ? STATUS_OK : STATUS_ERROR;
+}
+
+/* ---------------------------------------------------------------------------
+ * reading
+ */
+
+typedef struct
+{
+  const guint8 *p, *end;	/* unread part of the current section */
+  bool error;
+  char **strings;		/* the string table, [0] is NULL */
+  guint32 stringN;
+  GPtrArray *polygons[MAX_ALL_LAYER];	/* loaded polygons, for CLIP */
+} SnapshotReaderType;
+
+static bool
+have (SnapshotReaderType *r, size_t n)
+{
+  if (r->error || (size_t) (r->end - r->p) < n)
+    {
+      r->error = true;
+      return false;
+    }
+  return true;
+}
+
+static guint8
+get_u8 (SnapshotReaderType *r)
+{
+  if (!have (r, 1))
+    return 0;
+  return *r->p++;
+}
+
+static guint32
+get_u32 (SnapshotReaderType *r)
+{
+  guint32 v = 0;
+  int i;
+
+  if (!have (r, 4))
+    return 0;
+  for (i = 0; i < 4; i++)
+    v |= (guint32) *r->p++ << (8 * i);
+  return v;
+}
+
+static guint64
+get_u64 (SnapshotReaderType *r)
+{
+  guint64 v = 0;
+  int i;
+
+  if (!have (r, 8))
+    return 0;
+  for (i = 0; i < 8; i++)
+    v |= (guint64) *r->p++ << (8 * i);
+  return v;
+}
+
+static Coord
+get_coord (SnapshotReaderType *r)
+{
+  return (Coord) (gint64) get_u64 (r);
+}
+
+static double
+get_double (SnapshotReaderType *r)
+{
+  guint64 v = get_u64 (r);
+  double d;
+
+  memcpy (&d, &v, sizeof (d));
+  return d;
+}
+
+static FlagType
+get_flags (SnapshotReaderType *r)
+{
+  FlagType f;
+  guint8 n;
+
+  memset (&f, 0, sizeof (f));
+  f.f = get_u64 (r);
+  n = get_u8 (r);
+  if (have (r, n))
+    {
+      memcpy (f.t, r->p, MIN (n, sizeof (f.t)));
+      r->p += n;
+    }
+  return f;
+}
+
+static char *
+get_string (SnapshotReaderType *r)
+{
+  guint32 index = get_u32 (r);
+
+  if (index > r->stringN)
+    {
+      r->error = true;
+      return NULL;
+    }
+  return r->strings[index];
+}
+
+/*!
+ * \brief Reads an element count, rejecting counts that cannot possibly
+ * fit in the rest of the section.
+ */
+static guint32
+get_count (SnapshotReaderType *r, size_t element_size)
+{
+  guint32 n = get_u32 (r);
+
+  if ((guint64) n * element_size > (guint64) (r->end - r->p))
+    {
+      r->error = true;
+      return 0;
+    }
+  return n;
+}
+
+static void
+get_attributes (SnapshotReaderType *r, AttributeListType *list)
+{
+  guint32 i, n = get_count (r, 8);
+
+  for (i = 0; i < n && !r->error; i++)
+    {
+      char *name = get_string (r);
+      char *value = get_string (r);
+
+      CreateNewAttribute (list, name, value ? value : (char *) "");
+    }
+}
+
+static void
+read_strings (SnapshotReaderType *r)
+{
+  guint32 i, len;
+
+  r->stringN = get_count (r, 4);
+  r->strings = (char **) calloc (r->stringN + 1, sizeof (char *));
+  for (i = 1; i <= r->stringN && !r->error; i++)
+    {
+      len = get_count (r, 1);
+      if (r->error)
+	break;
+      r->strings[i] = g_strndup ((const char *) r->p, len);
+      r->p += len;
+    }
+}
+
+static void
+read_head (SnapshotReaderType *r, PCBType *pcb)
+{
+  char *groups;
+  guint32 i, n;
+
+  pcb->Name = STRDUP (get_string (r));
+  pcb->MaxWidth = get_coord (r);
+  pcb->MaxHeight = get_coord (r);
+  pcb->Grid = get_coord (r);
+  pcb->GridOffsetX = get_coord (r);
+  pcb->GridOffsetY = get_coord (r);
+  pcb->CursorX = get_coord (r);
+  pcb->CursorY = get_coord (r);
+  pcb->IsleArea = get_double (r);
+  pcb->ThermScale = get_double (r);
+  pcb->Bloat = get_coord (r);
+  pcb->Shrink = get_coord (r);
+  pcb->minWid = get_coord (r);
+  pcb->minSlk = get_coord (r);
+  pcb->minDrill = get_coord (r);
+  pcb->minRing = get_coord (r);
+  pcb->Flags = get_flags (r);
+
+  groups = get_string (r);
+  if (!r->error && groups
+      && ParseGroupString (groups, &pcb->LayerGroups, &pcb->Data->LayerN))
+    {
+      Message (_("illegal layer-group string\n"));
+      r->error = true;
+    }
+
+  n = get_count (r, 36);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      char *name = get_string (r);
+      RouteStyleType style;
+
+      style.Thick = get_coord (r);
+      style.Diameter = get_coord (r);
+      style.Hole = get_coord (r);
+      style.Keepaway = get_coord (r);
+      if (i < NUM_STYLES)
+	{
+	  free (pcb->RouteStyle[i].Name);
+	  pcb->RouteStyle[i] = style;
+	  pcb->RouteStyle[i].Name = STRDUP (name);
+	}
+    }
+  get_attributes (r, &pcb->Attributes);
+}
+
+static void
+read_font (SnapshotReaderType *r, FontType *font)
+{
+  guint32 i, j, n, lines;
+  int index;
+
+  for (index = 0; index <= MAX_FONTPOSITION; index++)
+    free (font->Symbol[index].Line);
+  memset (font->Symbol, 0, sizeof (font->Symbol));
+
+  n = get_count (r, 16);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      SymbolType *symbol;
+
+      index = get_u32 (r);
+      if (index <= 0 || index > MAX_FONTPOSITION)
+	{
+	  r->error = true;
+	  break;
+	}
+      symbol = &font->Symbol[index];
+      symbol->Valid = true;
+      symbol->Delta = get_coord (r);
+      lines = get_count (r, 40);
+      for (j = 0; j < lines && !r->error; j++)
+	{
+	  Coord x1 = get_coord (r);
+	  Coord y1 = get_coord (r);
+	  Coord x2 = get_coord (r);
+	  Coord y2 = get_coord (r);
+
+	  CreateNewLineInSymbol (symbol, x1, y1, x2, y2, get_coord (r));
+	}
+    }
+  font->Valid = true;
+  SetFontInfo (font);
+}
+
+static void
+read_vias (SnapshotReaderType *r, DataType *data)
+{
+  guint32 i, n = get_count (r, 48);
+
+  for (i = 0; i < n && !r->error; i++)
+    {
+      Coord x = get_coord (r);
+      Coord y = get_coord (r);
+      Coord thickness = get_coord (r);
+      Coord clearance = get_coord (r);
+      Coord mask = get_coord (r);
+      Coord drill = get_coord (r);
+      char *name = get_string (r);
+      FlagType flags = get_flags (r);
+
+      if (!r->error)
+	CreateNewVia (data, x, y, thickness, clearance, mask, drill, name,
+		      flags);
+    }
+}
+
+static void
+read_elements (SnapshotReaderType *r, DataType *data, FontType *font)
+{
+  guint32 i, j, n = get_count (r, 64);
+
+  for (i = 0; i < n && !r->error; i++)
+    {
+      ElementType *element;
+      FlagType flags = get_flags (r), text_flags;
+      char *description = get_string (r);
+      char *name = get_string (r);
+      char *value = get_string (r);
+      Coord mark_x = get_coord (r);
+      Coord mark_y = get_coord (r);
+      Coord text_x = get_coord (r);
+      Coord text_y = get_coord (r);
+      BYTE direction = get_u8 (r);
+      int scale = get_u32 (r);
+      guint32 count;
+
+      text_flags = get_flags (r);
+      if (r->error)
+	break;
+      element = CreateNewElement (data, font, flags, description, name,
+				  value, text_x, text_y, direction, scale,
+				  text_flags, false);
+      element->MarkX = mark_x;
+      element->MarkY = mark_y;
+      get_attributes (r, &element->Attributes);
+
+      count = get_count (r, 56);
+      for (j = 0; j < count && !r->error; j++)
+	{
+	  Coord x = get_coord (r);
+	  Coord y = get_coord (r);
+	  Coord thickness = get_coord (r);
+	  Coord clearance = get_coord (r);
+	  Coord mask = get_coord (r);
+	  Coord drill = get_coord (r);
+	  char *pin_name = get_string (r);
+	  char *number = get_string (r);
+
+	  CreateNewPin (element, x, y, thickness, clearance, mask, drill,
+			pin_name, number, get_flags (r));
+	}
+      count = get_count (r, 64);
+      for (j = 0; j < count && !r->error; j++)
+	{
+	  Coord x1 = get_coord (r);
+	  Coord y1 = get_coord (r);
+	  Coord x2 = get_coord (r);
+	  Coord y2 = get_coord (r);
+	  Coord thickness = get_coord (r);
+	  Coord clearance = get_coord (r);
+	  Coord mask = get_coord (r);
+	  char *pad_name = get_string (r);
+	  char *number = get_string (r);
+
+	  CreateNewPad (element, x1, y1, x2, y2, thickness, clearance, mask,
+			pad_name, number, get_flags (r));
+	}
+      count = get_count (r, 40);
+      for (j = 0; j < count && !r->error; j++)
+	{
+	  Coord x1 = get_coord (r);
+	  Coord y1 = get_coord (r);
+	  Coord x2 = get_coord (r);
+	  Coord y2 = get_coord (r);
+
+	  CreateNewLineInElement (element, x1, y1, x2, y2, get_coord (r));
+	}
+      count = get_count (r, 56);
+      for (j = 0; j < count && !r->error; j++)
+	{
+	  Coord x = get_coord (r);
+	  Coord y = get_coord (r);
+	  Coord width = get_coord (r);
+	  Coord height = get_coord (r);
+	  Angle start = get_double (r);
+	  Angle delta = get_double (r);
+
+	  CreateNewArcInElement (element, x, y, width, height, start, delta,
+				 get_coord (r));
+	}
+      SetElementBoundingBox (data, element, font);
+    }
+}
+
+static void
+read_rats (SnapshotReaderType *r, DataType *data)
+{
+  guint32 i, n = get_count (r, 50);
+
+  for (i = 0; i < n && !r->error; i++)
+    {
+      Coord x1 = get_coord (r);
+      Coord y1 = get_coord (r);
+      Cardinal group1 = get_u32 (r);
+      Coord x2 = get_coord (r);
+      Coord y2 = get_coord (r);
+      Cardinal group2 = get_u32 (r);
+      FlagType flags = get_flags (r);
+
+      if (!r->error)
+	CreateNewRat (data, x1, y1, x2, y2, group1, group2,
+		      Settings.RatThickness, flags);
+    }
+}
+
+static void
+read_layer (SnapshotReaderType *r, DataType *data, FontType *font)
+{
+  LayerType *layer;
+  guint32 number, i, j, n;
+  char *name;
+
+  number = get_u32 (r);
+  name = get_string (r);
+  if (r->error || number >= MAX_ALL_LAYER)
+    {
+      r->error = true;
+      return;
+    }
+  layer = &data->Layer[number];
+  free (layer->Name);
+  layer->Name = strdup (EMPTY (name));
+  layer->Type = get_u32 (r);
+  get_attributes (r, &layer->Attributes);
+
+  n = get_count (r, 57);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      Coord x1 = get_coord (r);
+      Coord y1 = get_coord (r);
+      Coord x2 = get_coord (r);
+      Coord y2 = get_coord (r);
+      Coord thickness = get_coord (r);
+      Coord clearance = get_coord (r);
+
+      CreateNewLineOnLayer (layer, x1, y1, x2, y2, thickness, clearance,
+			    get_flags (r));
+    }
+  n = get_count (r, 73);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      Coord x = get_coord (r);
+      Coord y = get_coord (r);
+      Coord width = get_coord (r);
+      Coord height = get_coord (r);
+      Coord thickness = get_coord (r);
+      Coord clearance = get_coord (r);
+      Angle start = get_double (r);
+      Angle delta = get_double (r);
+
+      CreateNewArcOnLayer (layer, x, y, width, height, start, delta,
+			   thickness, clearance, get_flags (r));
+    }
+  n = get_count (r, 30);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      Coord x = get_coord (r);
+      Coord y = get_coord (r);
+      BYTE direction = get_u8 (r);
+      int scale = get_u32 (r);
+      char *string = get_string (r);
+      FlagType flags = get_flags (r);
+
+      if (!r->error)
+	CreateNewText (layer, font, x, y, direction, scale, string, flags);
+    }
+
+  if (!r->polygons[number])
+    r->polygons[number] = g_ptr_array_new ();
+  n = get_count (r, 17);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      PolygonType *polygon;
+      Cardinal hole = 0, holes, *hole_index, points;
+
+      polygon = CreateNewPolygon (layer, get_flags (r));
+      holes = get_count (r, 4);
+      hole_index = (Cardinal *) calloc (holes + 1, sizeof (Cardinal));
+      for (j = 0; j < holes; j++)
+	hole_index[j] = get_u32 (r);
+      points = get_count (r, 16);
+      for (j = 0; j < points && !r->error; j++)
+	{
+	  Coord x = get_coord (r);
+	  Coord y = get_coord (r);
+
+	  if (hole < holes && j == hole_index[hole])
+	    {
+	      CreateNewHoleInPolygon (polygon);
+	      hole++;
+	    }
+	  CreateNewPointInPolygon (polygon, x, y);
+	}
+      free (hole_index);
+
+      if (r->error || polygon->PointN < 3)
+	{
+	  DestroyObject (data, POLYGON_TYPE, layer, polygon, polygon);
+	  g_ptr_array_add (r->polygons[number], NULL);
+	  continue;
+	}
+      SetPolygonBoundingBox (polygon);
+      if (!layer->polygon_tree)
+	layer->polygon_tree = r_create_tree (NULL, 0, 0);
+      r_insert_entry (layer->polygon_tree, (BoxType *) polygon, 0);
+      g_ptr_array_add (r->polygons[number], polygon);
+    }
+}
+
+/*!
+ * \brief Reads one clipped polygon as written by write_clip().
+ *
+ * \return NULL if the polygon was written without contours.
+ */
+static POLYAREA *
+read_polyarea (SnapshotReaderType *r)
+{
+  POLYAREA *list = NULL, *island;
+  guint32 islands, contours, vertices, i, j, k;
+  Vector v;
+
+  islands = get_count (r, 4);
+  for (i = 0; i < islands && !r->error; i++)
+    {
+      if ((island = poly_Create ()) == NULL)
+	{
+	  r->error = true;
+	  break;
+	}
+      contours = get_count (r, 4);
+      for (j = 0; j < contours && !r->error; j++)
+	{
+	  PLINE *contour = NULL;
+
+	  vertices = get_count (r, 16);
+	  if (vertices < 3)
+	    r->error = true;
+	  for (k = 0; k < vertices && !r->error; k++)
+	    {
+	      v[0] = get_coord (r);
+	      v[1] = get_coord (r);
+	      if (contour == NULL)
+		contour = poly_NewContour (v);
+	      else
+		poly_InclVertex (contour->head.prev, poly_CreateNode (v));
+	    }
+	  if (r->error)
+	    {
+	      if (contour)
+		poly_DelContour (&contour);
+	      break;
+	    }
+	  poly_PreContour (contour, FALSE);
+	  poly_InclContour (island, contour);
+	}
+      if (r->error)
+	{
+	  poly_Free (&island);
+	  break;
+	}
+      poly_M_Incl (&list, island);
+    }
+  if (r->error && list)
+    poly_Free (&list);
+  return list;
+}
+
+static void
+read_clip (SnapshotReaderType *r)
+{
+  GPtrArray *polygons;
+  guint32 number, i, n;
+
+  number = get_u32 (r);
+  if (r->error || number >= MAX_ALL_LAYER
+      || (polygons = r->polygons[number]) == NULL)
+    {
+      r->error = true;
+      return;
+    }
+  n = get_count (r, 4);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      POLYAREA *clipped = read_polyarea (r);
+      PolygonType *polygon;
+
+      polygon = i < polygons->len ? g_ptr_array_index (polygons, i) : NULL;
+      if (polygon && clipped)
+	{
+	  if (polygon->Clipped)
+	    poly_Free (&polygon->Clipped);
+	  polygon->Clipped = clipped;
+	  polygon->NoHolesValid = 0;
+	}
+      else if (clipped)
+	poly_Free (&clipped);
+    }
+}
+
+static void
+read_nets (SnapshotReaderType *r, LibraryType *netlist)
+{
+  guint32 i, j, n, connections;
+
+  n = get_count (r, 12);
+  for (i = 0; i < n && !r->error; i++)
+    {
+      LibraryMenuType *menu;
+      char *name = get_string (r);
+      char *style = get_string (r);
+
+      if (r->error)
+	break;
+      menu = CreateNewNet (netlist, EMPTY (name), style);
+      connections = get_count (r, 4);
+      for (j = 0; j < connections && !r->error; j++)
+	{
+	  char *connection = get_string (r);
+
+	  if (!r->error)
+	    CreateNewConnection (menu, connection);
+	}
+    }
+}
+
+/*!
+ * \brief Returns true if \a Filename names a snapshot.
+ */
+bool
+IsSnapshotFile (const char *Filename)
+{
+  size_t len, suffix_len = strlen (SNAPSHOT_SUFFIX);
+
+  if (Filename == NULL)
+    return false;
+  len = strlen (Filename);
+  return len > suffix_len
+    && strcmp (Filename + len - suffix_len, SNAPSHOT_SUFFIX) == 0;
+}
+
+/*!
+ * \brief Loads a snapshot into \a Ptr.
+ *
+ * Does the same set up as the parser does for a complete board, so
+ * that real_load_pcb() can treat both alike.
+ *
+ * \return 0 on success, non-zero on error.
+ */
+int
+ParseSnapshot (PCBType *Ptr, char *Filename)
+{
+  SnapshotReaderType r;
+  PCBType *pcb_save;
+  DataType *data = Ptr->Data;
+  gchar *contents;
+  gsize length;
+  const guint8 *p, *end;
+  bool have_head = false, have_strings = false;
+  double start;
+  guint32 i;
+
+  PERF_START (start);
+  if (!g_file_get_contents (Filename, &contents, &length, NULL))
+    {
+      OpenErrorMessage (Filename);
+      return 1;
+    }
+  p = (const guint8 *) contents;
+  end = p + length;
+
+  memset (&r, 0, sizeof (r));
+  r.p = p;
+  r.end = end;
+  if (length < SNAPSHOT_MAGIC_LEN + 8
+      || memcmp (p, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0)
+    {
+      Message (_("%s is not a pcb snapshot\n"), Filename);
+      g_free (contents);
+      return 1;
+    }
+  r.p += SNAPSHOT_MAGIC_LEN;
+  if (get_u32 (&r) > SNAPSHOT_VERSION)
+    {
+      Message (_("Snapshot %s was written by a newer version of pcb\n"),
+	       Filename);
+      g_free (contents);
+      return 1;
+    }
+  get_u32 (&r);
+
+  /* the same set up as the parser does for a complete layout */
+  data->pcb = Ptr;
+  data->LayerN = 0;
+  if (ParseGroupString (Settings.Groups, &Ptr->LayerGroups, &data->LayerN))
+    r.error = true;
+
+  CreateBeLenient (true);
+  p = r.p;
+  while (p < end && !r.error)
+    {
+      guint32 tag;
+      guint64 len;
+
+      r.p = p;
+      r.end = end;
+      tag = get_u32 (&r);
+      len = get_u64 (&r);
+      if (r.error || len > (guint64) (end - r.p))
+	{
+	  r.error = true;
+	  break;
+	}
+      p = r.p + len;
+      r.end = p;
+
+      if (tag == TAG_STRS && !have_strings)
+	{
+	  read_strings (&r);
+	  have_strings = true;
+	}
+      else if (!have_strings)
+	r.error = true;
+      else if (tag == TAG_HEAD)
+	{
+	  read_head (&r, Ptr);
+	  have_head = true;
+	}
+      else if (!have_head)
+	r.error = true;
+      else if (tag == TAG_FONT)
+	read_font (&r, &Ptr->Font);
+      else if (tag == TAG_VIAS)
+	read_vias (&r, data);
+      else if (tag == TAG_ELEM)
+	read_elements (&r, data, &Ptr->Font);
+      else if (tag == TAG_RATS)
+	read_rats (&r, data);
+      else if (tag == TAG_LAYR)
+	read_layer (&r, data, &Ptr->Font);
+      else if (tag == TAG_CLIP)
+	read_clip (&r);
+      else if (tag == TAG_NETS)
+	read_nets (&r, &Ptr->NetlistLib);
+    }
+  CreateBeLenient (false);
+
+  if (!r.error && !have_head)
+    r.error = true;
+  if (r.error)
+    Message (_("Snapshot %s is damaged\n"), Filename);
+  else
+    {
+      CreateNewPCBPost (Ptr, 0);
+
+      /* clip the polygons that came without their clipped contours */
+      pcb_save = PCB;
+      PCB = Ptr;
+      ALLPOLYGON_LOOP (data);
+      {
+	if (!polygon->Clipped)
+	  InitClip (data, layer, polygon);
+      }
+      ENDALL_LOOP;
+      PCB = pcb_save;
+    }
+
+  for (i = 0; i < MAX_ALL_LAYER; i++)
+    if (r.polygons[i])
+      g_ptr_array_free (r.polygons[i], TRUE);
+  if (r.strings)
+    {
+      for (i = 1; i <= r.stringN; i++)
+	g_free (r.strings[i]);
+      free (r.strings);
+    }
+  g_free (contents);
+
+  PERF_COUNT (PERF_FILES_PARSED, 1);
+  PERF_STOP (PERF_TIME_PARSE, start);
+
+  return r.error ? 1 : 0;
+}
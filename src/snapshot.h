@@ -0,0 +1,51 @@
+/*!
+ * \file src/snapshot.h
+ *
+ * \brief Prototypes for the binary board snapshot format.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PCB_SNAPSHOT_H
+#define PCB_SNAPSHOT_H
+
+#include "global.h"
+
+/*!
+ * \brief File name suffix that selects the snapshot format in
+ * SavePCB() and LoadPCB().
+ */
+#define SNAPSHOT_SUFFIX ".pcbsnap"
+
+/*!
+ * \brief Version written to new snapshots.
+ *
+ * Bump this whenever the layout of an existing section changes; new
+ * sections can be added without a bump since readers skip sections
+ * they do not know.
+ */
+#define SNAPSHOT_VERSION 1
+
+bool IsSnapshotFile (const char *);
+int WriteSnapshot (char *, PCBType *, bool);
+int ParseSnapshot (PCBType *, char *);
+
+#endif /* PCB_SNAPSHOT_H */
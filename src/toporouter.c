@@ -142,6 +142,7 @@ toporouter_vertex_init (toporouter_vertex_t *vertex)
   vertex->gcost = 0.;
   vertex->hcost = 0.;
   vertex->gn = 0;
+  vertex->openhandle = HEAP_NO_HANDLE;
 }
 
 toporouter_vertex_class_t * 
@@ -1118,6 +1119,8 @@ toporouter_free(toporouter_t *r)
   time_delta = endtime.tv_sec - r->starttime.tv_sec +
                (endtime.tv_usec - r->starttime.tv_usec) / 1000000.;
 
+  Message(_("Path search: %u searches, %u expansions, %.2f seconds\n"),
+          r->searches, r->expansions, r->searchtime);
   Message(_("Elapsed time: %.2f seconds\n"), time_delta);
   free(r->layers);  
   free(r);
@@ -2278,7 +2281,9 @@ check_cons_continuation:
           unconstrain(l, c1); unconstrain(l, c2); 
           rem = 1;
           //v1 of c1 is on c2
-          printf("v1 of c1 on c2\n"); 
+#ifdef DEBUG_IMPORT
+          printf("v1 of c1 on c2\n");
+#endif
 
           // replace with 2x constraints
           temp = insert_constraint_edge(r, l, vx(c2v1), vy(c2v1), 0, vx(c1v1), vy(c1v1), 0, c2box);
@@ -2297,7 +2302,9 @@ check_cons_continuation:
           unconstrain(l, c1); unconstrain(l, c2); 
           rem = 1;
           //v2 of c1 is on c2
-          printf("v2 of c1 on c2\n"); 
+#ifdef DEBUG_IMPORT
+          printf("v2 of c1 on c2\n");
+#endif
 
           // replace with 2x constraints
           temp = insert_constraint_edge(r, l, vx(c2v1), vy(c2v1), 0, vx(c1v2), vy(c1v2), 0, c2box);
@@ -2312,7 +2319,9 @@ check_cons_continuation:
           unconstrain(l, c1); unconstrain(l, c2); 
           rem = 1;
           //v1 of c2 is on c1
-          printf("v1 of c2 on c1\n"); 
+#ifdef DEBUG_IMPORT
+          printf("v1 of c2 on c1\n");
+#endif
 
           // replace with 2x constraints
           temp = insert_constraint_edge(r, l, vx(c1v1), vy(c1v1), 0, vx(c2v1), vy(c2v1), 0, c1box);
@@ -2326,7 +2335,9 @@ check_cons_continuation:
           unconstrain(l, c1); unconstrain(l, c2);
           rem = 1;
           //v2 of c2 is on c1
-          printf("v2 of c2 on c1\n"); 
+#ifdef DEBUG_IMPORT
+          printf("v2 of c2 on c1\n");
+#endif
 
           // replace with 2x constraints
           temp = insert_constraint_edge(r, l, vx(c1v1), vy(c1v1), 0, vx(c2v2), vy(c2v2), 0, c1box);
@@ -2351,10 +2362,14 @@ check_cons_continuation:
     //v = i->data;
     //if(r->flags & TOPOROUTER_FLAG_DEBUG_CDTS) 
   //  fprintf(stderr, "\tadding vertex %f,%f\n", v->p.x, v->p.y);
+#ifdef DEBUG_IMPORT
     toporouter_vertex_t *v = TOPOROUTER_VERTEX(gts_delaunay_add_vertex (l->surface, (GtsVertex *)i->data, NULL));
     if(v) {
       printf("conflict: "); print_vertex(v);
     }
+#else
+    gts_delaunay_add_vertex (l->surface, (GtsVertex *)i->data, NULL);
+#endif
 
     i = i->next;
   }
@@ -2368,10 +2383,11 @@ check_cons_continuation:
     GSList *j = conflicts;
     while(j) {
       if(TOPOROUTER_IS_CONSTRAINT(j->data)) {
+#ifdef DEBUG_IMPORT
         toporouter_constraint_t *c2 = TOPOROUTER_CONSTRAINT(j->data);
 
         printf("\tconflict: "); print_constraint(c2);
-      
+#endif
       }
       j = j->next;
     }
@@ -2418,6 +2434,38 @@ check_cons_continuation:
 
 }
 
+void
+build_layer_cdt(toporouter_t *r, toporouter_layer_t *l)
+{
+#ifdef DEBUG_IMPORT    
+  printf("building CDT\n");
+#endif
+  build_cdt(r, l);
+/*      {
+    int i;
+    for(i=0;i<groupcount();i++) {
+      char buffer[256];
+      sprintf(buffer, "build%d.png", i);
+      toporouter_draw_surface(r, r->layers[i].surface, buffer, 2048, 2048, 2, NULL, i, NULL);
+    }
+  }*/
+#ifdef DEBUG_IMPORT    
+  printf("finished building CDT\n");
+#endif
+}
+
+/* builds the CDT of every layer, one after the other: gts keeps the
+ * floating vertex and edge switches in globals that its Delaunay code sets
+ * and clears around every object it destroys, so two layers can't be
+ * triangulated at the same time */
+void
+build_cdts(toporouter_t *r)
+{
+  guint i;
+
+  for(i=0;i<groupcount();i++) build_layer_cdt(r, &r->layers[i]);
+}
+
 gint
 visited_cmp(gconstpointer a, gconstpointer b)
 {
@@ -2640,12 +2688,13 @@ import_geometry(toporouter_t *r)
   /* Allocate space for per layer struct */
   cur_layer = r->layers = (toporouter_layer_t *)malloc(groupcount() * sizeof(toporouter_layer_t));
 
-  /* Foreach layer, read in pad vertices and constraints, and build CDT */
+  /* Foreach layer, read in pad vertices and constraints */
   for (group = 0; group < max_group; group++) {
 #ifdef DEBUG_IMPORT    
     printf("*** LAYER GROUP %d ***\n", group);
 #endif
     if(PCB->LayerGroups.Number[group] > 0){ 
+      cur_layer->surface     = NULL;
       cur_layer->vertices    = NULL;
       cur_layer->constraints = NULL;
 
@@ -2674,27 +2723,12 @@ import_geometry(toporouter_t *r)
       }
       END_LOOP;
 
-
-
-#ifdef DEBUG_IMPORT    
-      printf("building CDT\n");
-#endif
-      build_cdt(r, cur_layer);
-  printf("finished\n");
-/*      {
-    int i;
-    for(i=0;i<groupcount();i++) {
-      char buffer[256];
-      sprintf(buffer, "build%d.png", i);
-      toporouter_draw_surface(r, r->layers[i].surface, buffer, 2048, 2048, 2, NULL, i, NULL);
-    }
-  }*/
-#ifdef DEBUG_IMPORT    
-      printf("finished building CDT\n");
-#endif
       cur_layer++;
     }
   }
+
+  /* then build the CDT of every layer */
+  build_cdts(r);
   
   r->bboxtree = gts_bb_tree_new(r->bboxes);
  
@@ -2801,25 +2835,49 @@ simple_h_cost(toporouter_t *r, toporouter_vertex_t *curpoint, toporouter_vertex_
 }
 
 #define FCOST(x) (x->gcost + x->hcost)
-gdouble     
-route_heap_cmp(gpointer item, gpointer data)
+
+/* the open set of route() is a heap keyed on FCOST; every vertex keeps its
+ * handle in openhandle so that membership is a field test and a cheaper
+ * path is a decrease-key rather than a search and rebuild of the heap */
+#define open_set_contains(v) ((v)->openhandle != HEAP_NO_HANDLE)
+
+void
+open_set_insert(heap_t *openlist, toporouter_vertex_t *v)
 {
-  return FCOST(TOPOROUTER_VERTEX(item));  
+  heap_insert_handle(openlist, FCOST(v), v, &v->openhandle);
 }
 
-#define closelist_insert(p) closelist = g_list_prepend(closelist, p)
+/* empties the open set, resetting the handles of the vertices left in it.
+ * Must be done before temporary points are destroyed. */
+void
+open_set_clear(heap_t *openlist)
+{
+  while(!heap_is_empty(openlist))
+    heap_remove_smallest(openlist);
+}
 
-typedef struct {
-  toporouter_vertex_t *key;
-  toporouter_vertex_t *result;
-}toporouter_heap_search_data_t;
+/* the closed set and the source and destination vertices of route() are
+ * hash sets keyed on the vertex pointer */
+GHashTable *
+vertex_set_new(GList *vertices)
+{
+  GHashTable *set = g_hash_table_new(g_direct_hash, g_direct_equal);
 
-void 
-toporouter_heap_search(gpointer data, gpointer user_data)
+  while(vertices) {
+    g_hash_table_insert(set, vertices->data, vertices->data);
+    vertices = vertices->next;
+  }
+
+  return set;
+}
+
+#define vertex_set_contains(set, v) ((set) && (v) && g_hash_table_lookup(set, v))
+
+void
+vertex_set_free(GHashTable **set)
 {
-  toporouter_vertex_t *v = TOPOROUTER_VERTEX(data);
-  toporouter_heap_search_data_t *heap_search_data = (toporouter_heap_search_data_t *)user_data;
-  if(v == heap_search_data->key) heap_search_data->result = v;
+  if(*set) g_hash_table_destroy(*set);
+  *set = NULL;
 }
 /*
 void 
@@ -3767,13 +3825,13 @@ triangle_all_candidate_points_from_edge(toporouter_t *r, GtsTriangle *t, toporou
     
   if(vertex_bbox(op_v)) boxpoint = TOPOROUTER_VERTEX(vertex_bbox(op_v)->point);
     
-  if(g_list_find(routedata->destvertices, op_v)) {
+  if(vertex_set_contains(routedata->destset, op_v)) {
     rval = g_list_prepend(rval, op_v);
     *dest = op_v;
     return rval;
-  }else if(g_list_find(routedata->destvertices, boxpoint)) {
+  }else if(vertex_set_contains(routedata->destset, boxpoint)) {
     *dest = boxpoint;
-  }else if(g_list_find(routedata->srcvertices, op_v)) {
+  }else if(vertex_set_contains(routedata->srcset, op_v)) {
     rval = g_list_prepend(rval, op_v);
   }
 
@@ -3944,12 +4002,12 @@ triangle_candidate_points_from_edge(toporouter_t *r, GtsTriangle *t, toporouter_
     
     if(vertex_bbox(op_v)) boxpoint = TOPOROUTER_VERTEX(vertex_bbox(op_v)->point);
     
-    if(g_list_find(routedata->destvertices, op_v)) {
+    if(vertex_set_contains(routedata->destset, op_v)) {
       rval = g_list_prepend(rval, op_v);
       *dest = op_v;
-    }else if(g_list_find(routedata->destvertices, boxpoint)) {
+    }else if(vertex_set_contains(routedata->destset, boxpoint)) {
       *dest = boxpoint;
-    }else if(g_list_find(routedata->srcvertices, op_v)) {
+    }else if(vertex_set_contains(routedata->srcset, op_v)) {
       rval = g_list_prepend(rval, op_v);
     }
   }
@@ -4517,7 +4575,7 @@ gcost(toporouter_t *r, toporouter_route_t *data, toporouter_vertex_t *srcv, topo
   
   *n = pv->gn;
 
-  if(g_list_find(data->srcvertices, v)) return 0.; 
+  if(vertex_set_contains(data->srcset, v)) return 0.; 
   
   segcost = tvdistance(pv, v);
 
@@ -4565,22 +4623,29 @@ candidate_is_available(toporouter_vertex_t *pv, toporouter_vertex_t *v)
 GList *
 route(toporouter_t *r, toporouter_route_t *data, guint debug)
 {
-  GtsEHeap *openlist = gts_eheap_new(route_heap_cmp, NULL);
-  GList *closelist = NULL;
+  heap_t *openlist = heap_create();
+  GHashTable *closeset = g_hash_table_new(g_direct_hash, g_direct_equal);
   GList *i, *rval = NULL;
   toporouter_netlist_t *pair = NULL;
   gint count = 0;
+  struct timeval starttime, endtime;
 
   toporouter_vertex_t *srcv = NULL, *destv = NULL, *curpoint = NULL;
   toporouter_layer_t *cur_layer; //, *dest_layer;
 
   g_assert(data->src->c != data->dest->c);
   
+  gettimeofday(&starttime, NULL);
+
   if(data->destvertices) g_list_free(data->destvertices);
   if(data->srcvertices) g_list_free(data->srcvertices);
+  vertex_set_free(&data->destset);
+  vertex_set_free(&data->srcset);
   
   data->destvertices = cluster_vertices(r, data->dest);
   data->srcvertices = cluster_vertices(r, data->src);
+  data->destset = vertex_set_new(data->destvertices);
+  data->srcset = vertex_set_new(data->srcvertices);
 
   closest_cluster_pair(r, data->srcvertices, data->destvertices, &curpoint, &destv);
 
@@ -4612,14 +4677,14 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
     }
   }
 
-  gts_eheap_insert(openlist, curpoint);
+  open_set_insert(openlist, curpoint);
   
-  while(gts_eheap_size(openlist) > 0) {
+  while(!heap_is_empty(openlist)) {
     GList *candidatepoints;
     data->curpoint = curpoint;
     //draw_route_status(r, closelist, openlist, curpoint, data, count++);
 
-    curpoint = TOPOROUTER_VERTEX( gts_eheap_remove_top(openlist, NULL) );
+    curpoint = TOPOROUTER_VERTEX( heap_remove_smallest(openlist) );
     if(curpoint->parent && !(curpoint->flags & VERTEX_FLAG_TEMP)) {
       if(vz(curpoint) != vz(destv)) {
         toporouter_vertex_t *tempv;
@@ -4636,7 +4701,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
 //    destpoint = closest_dest_vertex(r, curpoint, data);
 //    dest_layer = &r->layers[(int)vz(destpoint)];
     
-    if(g_list_find(data->destvertices, curpoint)) {
+    if(vertex_set_contains(data->destset, curpoint)) {
       toporouter_vertex_t *temppoint = curpoint;
       srcv = NULL;
       destv = curpoint;
@@ -4645,7 +4710,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
 
       while(temppoint) {
         data->path = g_list_prepend(data->path, temppoint);   
-        if(g_list_find(data->srcvertices, temppoint)) {
+        if(vertex_set_contains(data->srcset, temppoint)) {
           srcv = temppoint;
           if(r->flags & TOPOROUTER_FLAG_AFTERORDER) break;
         }
@@ -4666,7 +4731,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
       }
       goto route_finish;
     }
-    closelist_insert(curpoint);
+    g_hash_table_insert(closeset, curpoint, curpoint);
 #ifdef DEBUG_ROUTE
     printf("\n\n\n*** ROUTE COUNT = %d\n", count);
 #endif
@@ -4715,16 +4780,11 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
     i = candidatepoints;
     while(i) {
       toporouter_vertex_t *temppoint = TOPOROUTER_VERTEX(i->data);
-      if(!g_list_find(closelist, temppoint) && candidate_is_available(curpoint, temppoint)) { //&& temppoint != curpoint) {
-        toporouter_heap_search_data_t heap_search_data = { temppoint, NULL };
-
+      if(!g_hash_table_lookup(closeset, temppoint) && candidate_is_available(curpoint, temppoint)) { //&& temppoint != curpoint) {
         guint temp_gn;
         gdouble temp_g_cost = gcost(r, data, srcv, temppoint, curpoint, &temp_gn, pair);
       
-
-        gts_eheap_foreach(openlist,toporouter_heap_search, &heap_search_data);
-
-        if(heap_search_data.result) {
+        if(open_set_contains(temppoint)) {
           if(temp_g_cost < temppoint->gcost) {
             
             temppoint->gcost = temp_g_cost;
@@ -4733,7 +4793,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
             temppoint->parent = curpoint;
             curpoint->child = temppoint;
             
-            gts_eheap_update(openlist);
+            heap_decrease_key(openlist, &temppoint->openhandle, FCOST(temppoint));
           }
         }else{
           temppoint->parent = curpoint;
@@ -4744,7 +4804,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
 
           temppoint->hcost = simple_h_cost(r, temppoint, destv);
 //          if(cur_layer != dest_layer) temppoint->hcost += r->viacost;
-          gts_eheap_insert(openlist, temppoint);
+          open_set_insert(openlist, temppoint);
         }
       
       }
@@ -4778,6 +4838,7 @@ route(toporouter_t *r, toporouter_route_t *data, guint debug)
 //  exit(0);
 */
 route_finish:
+  open_set_clear(openlist);
 //  printf(" * finished a*\n");
 /* 
   {
@@ -4807,9 +4868,9 @@ route_finish:
           else
             boxpoint = NULL;
 
-          if(tedge_v2(tv->routingedge) != srcv && g_list_find(data->srcvertices, tedge_v2(tv->routingedge))) 
+          if(tedge_v2(tv->routingedge) != srcv && vertex_set_contains(data->srcset, tedge_v2(tv->routingedge))) 
             restartv = tedge_v2(tv->routingedge);
-          else if(boxpoint != srcv && g_list_find(data->srcvertices, boxpoint)) 
+          else if(boxpoint != srcv && vertex_set_contains(data->srcset, boxpoint)) 
             restartv = boxpoint;
         }
         
@@ -4819,19 +4880,17 @@ route_finish:
           else
             boxpoint = NULL;
 
-          if(tedge_v1(tv->routingedge) != srcv && g_list_find(data->srcvertices, tedge_v1(tv->routingedge))) 
+          if(tedge_v1(tv->routingedge) != srcv && vertex_set_contains(data->srcset, tedge_v1(tv->routingedge))) 
             restartv = tedge_v1(tv->routingedge);
-          else if(boxpoint != srcv && g_list_find(data->srcvertices, boxpoint)) 
+          else if(boxpoint != srcv && vertex_set_contains(data->srcset, boxpoint)) 
             restartv = boxpoint;
           
         }
 
         if(restartv) {
           clean_routing_edges(r, data); 
-          gts_eheap_destroy(openlist);     
-          g_list_free(closelist);
-          openlist = gts_eheap_new(route_heap_cmp, NULL);
-          closelist = NULL;
+          open_set_clear(openlist);
+          g_hash_table_remove_all(closeset);
           g_list_free(data->path);
           printf("ROUTING RESTARTING with new src %f,%f,%f\n", vx(restartv), vy(restartv), vz(restartv));
           curpoint = restartv;
@@ -4849,7 +4908,7 @@ route_finish:
     while(i) {
       toporouter_vertex_t *tv = TOPOROUTER_VERTEX(i->data);
       
-      if(pv && g_list_find(data->srcvertices, tv)) {
+      if(pv && vertex_set_contains(data->srcset, tv)) {
         GList *temp = g_list_copy(i);
         g_list_free(data->path);
         data->path = temp;
@@ -4920,11 +4979,20 @@ routing_return:
   g_list_free(data->srcvertices);
   data->destvertices = NULL;
   data->srcvertices = NULL;
-  gts_eheap_destroy(openlist);     
-  g_list_free(closelist);
+  vertex_set_free(&data->destset);
+  vertex_set_free(&data->srcset);
+  open_set_clear(openlist);
+  heap_destroy(&openlist);
+  g_hash_table_destroy(closeset);
 
   data->alltemppoints = NULL;
 
+  gettimeofday(&endtime, NULL);
+  r->searches++;
+  r->expansions += count;
+  r->searchtime += endtime.tv_sec - starttime.tv_sec +
+                   (endtime.tv_usec - starttime.tv_usec) / 1000000.;
+
   return rval;
 }
 
@@ -6529,6 +6597,7 @@ routedata_create(void)
   routedata->ppathindices = NULL;
 
   routedata->destvertices = routedata->srcvertices = NULL;
+  routedata->destset = routedata->srcset = NULL;
   return routedata;
 }
 /*
@@ -201,6 +201,9 @@ struct _toporouter_vertex_t {
   gdouble gcost, hcost;
   guint gn;
 
+  /* position in the open set of route(), HEAP_NO_HANDLE when not in it */
+  heap_handle_t openhandle;
+
   struct _toporouter_arc_t *arc;
 
   struct _toporouter_oproute_t *oproute;
@@ -285,6 +288,8 @@ struct _toporouter_route_t {
   guint flags;
 
   GList *destvertices, *srcvertices;
+  /* the same vertices, for membership tests during route() */
+  GHashTable *destset, *srcset;
 
   GList *topopath;
 
@@ -428,6 +433,10 @@ struct _toporouter_t {
 
   struct timeval starttime;  
 
+  /* totals over all route() searches, reported by toporouter_free() */
+  guint searches, expansions;
+  gdouble searchtime;
+
   FILE *debug;
 };
 
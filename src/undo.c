@@ -48,6 +48,7 @@
 #include <memory.h>
 #include "global.h"
 
+#include "autoroute.h"
 #include "buffer.h"
 #include "change.h"
 #include "create.h"
@@ -59,6 +60,7 @@
 #include "mirror.h"
 #include "move.h"
 #include "mymem.h"
+#include "perf.h"
 #include "polygon.h"
 #include "remove.h"
 #include "rotate.h"
@@ -96,6 +98,13 @@ typedef struct			/* information about removed polygon points */
   bool last_in_contour;		/* Whether the point was the last in its contour */
 } RemovedPointType;
 
+typedef struct			/* information about a removed/inserted contour */
+{
+  Cardinal Index;		/* index of the contour, holes start at 1 */
+  Cardinal PointN;		/* number of points */
+  PointType *Points;		/* points of a removed contour, else NULL */
+} ContourType;
+
 typedef struct			/* information about rotation */
 {
   Coord CenterX, CenterY;	/* center of rotation */
@@ -131,6 +140,7 @@ typedef struct			/* holds information about an operation */
     Type,			/* type of operation */
     Kind,			/* type of object with given ID */
     ID;				/* object ID */
+  size_t Bytes;			/* memory held by the entry, see ObjectBytes() */
   union				/* some additional information */
   {
     ChangeNameType ChangeName;
@@ -143,7 +153,7 @@ typedef struct			/* holds information about an operation */
     LayerChangeType LayerChange;
     ClearPolyType ClearPoly;
     NetlistChangeType NetlistChange;
-    long int CopyID;
+    ContourType Contour;
   }
   Data;
 } UndoListType;
@@ -157,10 +167,15 @@ static int Serial = 1,		/* serial number */
   SavedSerial;
 static size_t UndoN, RedoN,	/* number of entries */
   UndoMax;
+static size_t UndoBytes = 0;	/* memory held by all entries */
 static bool Locked = false;	/* do not add entries if */
-static bool andDraw = true;
 										/* flag is set; prevents from */
 										/* infinite loops */
+static bool andDraw = true;
+static int Batched = 0;		/* BeginUndoBatch() nesting depth */
+static int BatchSerial;		/* serial the outermost batch began at */
+static size_t BatchUndoN,	/* first entry added by the batch */
+  BatchRedoN;			/* redo entries that predate the batch */
 
 /* ---------------------------------------------------------------------------
  * some local prototypes
@@ -186,6 +201,11 @@ static bool UndoChangeClearSize (UndoListType *);
 static bool UndoChangeMaskSize (UndoListType *);
 static bool UndoClearPoly (UndoListType *);
 static int PerformUndo (UndoListType *);
+static bool BeginReplay (UndoListType *, int, size_t);
+static void EndReplay (bool);
+static void ReleaseUndoEntry (UndoListType *);
+static void SetEntryBytes (UndoListType *, size_t);
+static size_t ObjectBytes (int, void *);
 
 /* ---------------------------------------------------------------------------
  * adds a command plus some data to the undo list
@@ -194,8 +214,9 @@ static UndoListType *
 GetUndoSlot (int CommandType, int ID, int Kind)
 {
   UndoListType *ptr;
+#ifdef DEBUG_ID
   void *ptr1, *ptr2, *ptr3;
-  int type;
+#endif
   static size_t limit = UNDO_WARNING_SIZE;
 
 #ifdef DEBUG_ID
@@ -204,11 +225,15 @@ GetUndoSlot (int CommandType, int ID, int Kind)
 	     Kind);
 #endif
 
+  PERF_COUNT (PERF_UNDO_SLOTS, 1);
+
   /* allocate memory */
   if (UndoN >= UndoMax)
     {
       size_t size;
 
+      PERF_COUNT (PERF_UNDO_GROWS, 1);
+
       UndoMax += STEP_UNDOLIST;
       size = UndoMax * sizeof (UndoListType);
       UndoList = (UndoListType *) realloc (UndoList, size);
@@ -226,23 +251,8 @@ GetUndoSlot (int CommandType, int ID, int Kind)
   /* free structures from the pruned redo list */
 
   for (ptr = &UndoList[UndoN]; RedoN; ptr++, RedoN--)
-    switch (ptr->Type)
-      {
-      case UNDO_CHANGENAME:
-	free (ptr->Data.ChangeName.Name);
-	break;
-      case UNDO_REMOVE:
-	type =
-	  SearchObjectByID (RemoveList, &ptr1, &ptr2, &ptr3, ptr->ID,
-			    ptr->Kind);
-	if (type != NO_TYPE)
-	  {
-	    DestroyObject (RemoveList, type, ptr1, ptr2, ptr3);
-	  }
-	break;
-      default:
-	break;
-      }
+    ReleaseUndoEntry (ptr);
+  BatchRedoN = 0;
 
   if (between_increment_and_restore)
     added_undo_between_increment_and_restore = true;
@@ -253,9 +263,165 @@ GetUndoSlot (int CommandType, int ID, int Kind)
   ptr->Kind = Kind;
   ptr->ID = ID;
   ptr->Serial = Serial;
+  ptr->Bytes = 0;
   return (ptr);
 }
 
+/* ---------------------------------------------------------------------------
+ * releases the data held by an entry which is dropped from the list
+ */
+static void
+ReleaseUndoEntry (UndoListType *ptr)
+{
+  void *ptr1, *ptr2, *ptr3;
+  int type;
+
+  switch (ptr->Type)
+    {
+    case UNDO_CHANGENAME:
+      free (ptr->Data.ChangeName.Name);
+      break;
+    case UNDO_REMOVE:
+      type =
+	SearchObjectByID (RemoveList, &ptr1, &ptr2, &ptr3, ptr->ID,
+			  ptr->Kind);
+      if (type != NO_TYPE)
+	{
+	  DestroyObject (RemoveList, type, ptr1, ptr2, ptr3);
+	}
+      break;
+    case UNDO_REMOVE_CONTOUR:
+    case UNDO_INSERT_CONTOUR:
+      free (ptr->Data.Contour.Points);
+      ptr->Data.Contour.Points = NULL;
+      break;
+    default:
+      break;
+    }
+  SetEntryBytes (ptr, 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * sets the memory accounted to an entry
+ */
+static void
+SetEntryBytes (UndoListType *ptr, size_t bytes)
+{
+  UndoBytes = UndoBytes - ptr->Bytes + bytes;
+  ptr->Bytes = bytes;
+}
+
+/* ---------------------------------------------------------------------------
+ * estimates the memory held by an object in the remove list
+ */
+static size_t
+ObjectBytes (int Type, void *Ptr2)
+{
+  size_t bytes = 0;
+
+  switch (Type)
+    {
+    case VIA_TYPE:
+      bytes = sizeof (PinType);
+      break;
+    case LINE_TYPE:
+      bytes = sizeof (LineType);
+      break;
+    case ARC_TYPE:
+      bytes = sizeof (ArcType);
+      break;
+    case RATLINE_TYPE:
+      bytes = sizeof (RatType);
+      break;
+    case TEXT_TYPE:
+      bytes = sizeof (TextType)
+	+ strlen (EMPTY (((TextType *) Ptr2)->TextString));
+      break;
+    case ELEMENT_TYPE:
+      {
+	ElementType *element = (ElementType *) Ptr2;
+
+	bytes = sizeof (ElementType)
+	  + element->PinN * sizeof (PinType)
+	  + element->PadN * sizeof (PadType)
+	  + element->LineN * sizeof (LineType)
+	  + element->ArcN * sizeof (ArcType);
+      }
+      break;
+    case POLYGON_TYPE:
+      {
+	PolygonType *polygon = (PolygonType *) Ptr2;
+	POLYAREA *pa;
+	PLINE *contour;
+
+	bytes = sizeof (PolygonType)
+	  + polygon->PointMax * sizeof (PointType)
+	  + polygon->HoleIndexMax * sizeof (Cardinal);
+	if ((pa = polygon->Clipped) != NULL)
+	  do
+	    for (contour = pa->contours; contour; contour = contour->next)
+	      bytes += sizeof (PLINE) + contour->Count * sizeof (VNODE);
+	  while ((pa = pa->f) != polygon->Clipped);
+      }
+      break;
+    }
+  return bytes;
+}
+
+/* ---------------------------------------------------------------------------
+ * drops the oldest operations until the list fits into the memory
+ * budget set by Settings.UndoBudget; the latest operation and anything
+ * added by an open batch are always kept
+ */
+static void
+EnforceUndoBudget (void)
+{
+  static bool warned = false;
+  size_t budget = (size_t) Settings.UndoBudget << 20;
+  size_t n = 0;
+  int serial;
+
+  if (budget == 0 || UndoN == 0)
+    return;
+
+  while (n < UndoN
+	 && UndoBytes + (UndoN + RedoN - n) * sizeof (UndoListType) > budget)
+    {
+      serial = UndoList[n].Serial;
+      if (serial == UndoList[UndoN - 1].Serial
+	  || (Batched && serial >= BatchSerial))
+	break;
+      for (; n < UndoN && UndoList[n].Serial == serial; n++)
+	ReleaseUndoEntry (&UndoList[n]);
+    }
+  if (n == 0)
+    return;
+
+  memmove (UndoList, UndoList + n,
+	   (UndoN + RedoN - n) * sizeof (UndoListType));
+  UndoN -= n;
+  BatchUndoN = BatchUndoN > n ? BatchUndoN - n : 0;
+
+  if (!warned)
+    {
+      Message (_("The undo list exceeds its budget of %d MB, "
+		 "the oldest operations can no longer be undone\n"),
+	       Settings.UndoBudget);
+      warned = true;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * reports the number of entries and the memory used by the undo list
+ */
+void
+GetUndoUsage (size_t *undo, size_t *redo, size_t *bytes)
+{
+  *undo = UndoN;
+  *redo = RedoN;
+  *bytes = UndoBytes + UndoMax * sizeof (UndoListType);
+}
+
 /* ---------------------------------------------------------------------------
  * redraws the recovered object
  */
@@ -590,6 +756,7 @@ UndoCopyOrCreate (UndoListType *Entry)
       if (andDraw)
 	EraseObject (type, ptr1, ptr2);
       /* in order to make this re-doable we move it to the RemoveList */
+      SetEntryBytes (Entry, ObjectBytes (type, ptr2));
       MoveObjectToBuffer (RemoveList, PCB->Data, type, ptr1, ptr2, ptr3);
       Entry->Type = UNDO_REMOVE;
       return (true);
@@ -640,6 +807,7 @@ UndoRemove (UndoListType *Entry)
       if (andDraw)
 	DrawRecoveredObject (type, ptr1, ptr2, ptr3);
       MoveObjectToBuffer (PCB->Data, RemoveList, type, ptr1, ptr2, ptr3);
+      SetEntryBytes (Entry, 0);
       Entry->Type = UNDO_CREATE;
       return (true);
     }
@@ -773,66 +941,114 @@ UndoInsertPoint (UndoListType *Entry)
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * recovers a removed polygon contour
+ * returns true on success
+ */
 static bool
-UndoSwapCopiedObject (UndoListType *Entry)
+UndoRemoveContour (UndoListType *Entry)
 {
-  void *ptr1, *ptr2, *ptr3;
-  void *ptr1b, *ptr2b, *ptr3b;
-  AnyObjectType *obj, *obj2;
-  int type;
-  long int swap_id;
-
-  /* lookup entry by it's ID */
-  type =
-    SearchObjectByID (RemoveList, &ptr1, &ptr2, &ptr3, Entry->Data.CopyID,
-		      Entry->Kind);
-  if (type == NO_TYPE)
-    return false;
-
-  type =
-    SearchObjectByID (PCB->Data, &ptr1b, &ptr2b, &ptr3b, Entry->ID,
-		      Entry->Kind);
-  if (type == NO_TYPE)
-    return FALSE;
-
-  obj = (AnyObjectType *)ptr2;
-  obj2 = (AnyObjectType *)ptr2b;
-
-  swap_id = obj->ID;
-  obj->ID = obj2->ID;
-  obj2->ID = swap_id;
-
-  MoveObjectToBuffer (RemoveList, PCB->Data, type, ptr1b, ptr2b, ptr3b);
-
-  if (andDraw)
-    DrawRecoveredObject (Entry->Kind, ptr1, ptr2, ptr3);
+  ContourType *c = &Entry->Data.Contour;
+  LayerType *layer;
+  PolygonType *polygon;
+  void *ptr3;
+  Cardinal start, i;
 
-  obj = (AnyObjectType *)MoveObjectToBuffer (PCB->Data, RemoveList, type, ptr1, ptr2, ptr3);
-  if (Entry->Kind == POLYGON_TYPE)
-    InitClip (PCB->Data, (LayerType *)ptr1b, (PolygonType *)obj);
+  assert (Entry->Kind == POLYGON_TYPE);
+  if (SearchObjectByID (PCB->Data, (void **) &layer, (void **) &polygon,
+			&ptr3, Entry->ID, Entry->Kind) != POLYGON_TYPE
+      || c->Points == NULL || c->Index == 0
+      || c->Index > polygon->HoleIndexN + 1)
+    return (false);
+
+  if (andDraw && layer->On)
+    ErasePolygon (polygon);
+
+  /* make room for the points in front of the contour that follows */
+  start = (c->Index <= polygon->HoleIndexN) ?
+    polygon->HoleIndex[c->Index - 1] : polygon->PointN;
+  if (polygon->PointN + c->PointN > polygon->PointMax)
+    {
+      polygon->PointMax = polygon->PointN + c->PointN;
+      polygon->Points = (PointType *) realloc (polygon->Points,
+				polygon->PointMax * sizeof (PointType));
+    }
+  memmove (polygon->Points + start + c->PointN, polygon->Points + start,
+	   (polygon->PointN - start) * sizeof (PointType));
+  memcpy (polygon->Points + start, c->Points, c->PointN * sizeof (PointType));
+  polygon->PointN += c->PointN;
+
+  /* and insert the hole, shifting the ones behind it */
+  GetHoleIndexMemoryInPolygon (polygon);
+  for (i = polygon->HoleIndexN - 1; i > c->Index - 1; i--)
+    polygon->HoleIndex[i] = polygon->HoleIndex[i - 1] + c->PointN;
+  polygon->HoleIndex[c->Index - 1] = start;
+
+  free (c->Points);
+  c->Points = NULL;
+  SetEntryBytes (Entry, 0);
+
+  InitClip (PCB->Data, layer, polygon);
+  if (andDraw && layer->On)
+    DrawPolygon (layer, polygon);
+  Entry->Type = UNDO_INSERT_CONTOUR;
   return (true);
 }
 
 /* ---------------------------------------------------------------------------
- * recovers an removed polygon point
- * returns true on success
+ * cuts the points of contour 'Index' out of a polygon, keeping them in
+ * the contour record
  */
-static bool
-UndoRemoveContour (UndoListType *Entry)
+static void
+CutContour (PolygonType *polygon, ContourType *c, bool remove)
 {
-  assert (Entry->Kind == POLYGON_TYPE);
-  return UndoSwapCopiedObject (Entry);
+  Cardinal start, end, i;
+
+  start = polygon->HoleIndex[c->Index - 1];
+  end = (c->Index == polygon->HoleIndexN) ?
+    polygon->PointN : polygon->HoleIndex[c->Index];
+  c->PointN = end - start;
+  c->Points = (PointType *) malloc (c->PointN * sizeof (PointType));
+  memcpy (c->Points, polygon->Points + start, c->PointN * sizeof (PointType));
+  if (!remove)
+    return;
+
+  memmove (polygon->Points + start, polygon->Points + end,
+	   (polygon->PointN - end) * sizeof (PointType));
+  polygon->PointN -= c->PointN;
+  for (i = c->Index; i < polygon->HoleIndexN; i++)
+    polygon->HoleIndex[i - 1] = polygon->HoleIndex[i] - c->PointN;
+  polygon->HoleIndexN--;
 }
 
 /* ---------------------------------------------------------------------------
- * recovers an inserted polygon point
+ * removes an inserted polygon contour
  * returns true on success
  */
 static bool
 UndoInsertContour (UndoListType *Entry)
 {
+  ContourType *c = &Entry->Data.Contour;
+  LayerType *layer;
+  PolygonType *polygon;
+  void *ptr3;
+
   assert (Entry->Kind == POLYGON_TYPE);
-  return UndoSwapCopiedObject (Entry);
+  if (SearchObjectByID (PCB->Data, (void **) &layer, (void **) &polygon,
+			&ptr3, Entry->ID, Entry->Kind) != POLYGON_TYPE
+      || c->Index == 0 || c->Index > polygon->HoleIndexN)
+    return (false);
+
+  if (andDraw && layer->On)
+    ErasePolygon (polygon);
+  CutContour (polygon, c, true);
+  SetEntryBytes (Entry, c->PointN * sizeof (PointType));
+
+  InitClip (PCB->Data, layer, polygon);
+  if (andDraw && layer->On)
+    DrawPolygon (layer, polygon);
+  Entry->Type = UNDO_REMOVE_CONTOUR;
+  return (true);
 }
 
 /* ---------------------------------------------------------------------------
@@ -926,6 +1142,14 @@ Undo (bool draw)
   int Types = 0;
   int unique;
   bool error_undoing = false;
+  bool batch;
+
+  /* inside a batch only the steps taken since it began can be undone */
+  if (Batched && UndoN <= BatchUndoN)
+    {
+      Message (_("Undo is not available inside a batch\n"));
+      return 0;
+    }
 
   unique = TEST_FLAG (UNIQUENAMEFLAG, PCB);
   CLEAR_FLAG (UNIQUENAMEFLAG, PCB);
@@ -967,6 +1191,7 @@ Undo (bool draw)
     }
 
   LockUndo (); /* lock undo module to prevent from loops */
+  batch = BeginReplay (ptr, -1, UndoN);
 
   /* Loop over all entries with the correct serial number */
   for (; UndoN && ptr->Serial == Serial; ptr--, UndoN--, RedoN++)
@@ -977,6 +1202,7 @@ Undo (bool draw)
       Types |= undid;
     }
 
+  EndReplay (batch);
   UnlockUndo ();
 
   if (error_undoing)
@@ -992,9 +1218,62 @@ Undo (bool draw)
   return Types;
 }
 
+/*!
+ * \brief Smallest serial group that is replayed as a batch.
+ *
+ * Below this, incrementally plowing each object out of its polygons
+ * is cheaper than re-clipping the whole polygon afterwards.
+ */
+#define UNDO_BATCH_MIN 4
+
+/*!
+ * \brief Prepare to replay the serial group starting at \p ptr.
+ *
+ * \p step is -1 when undoing and 1 when redoing, \p avail the number
+ * of entries that can be walked in that direction.  Large groups get
+ * drawing suspended and polygon clipping deferred, so every handler
+ * only records what it touched.
+ *
+ * \return True if the group is replayed as a batch.
+ */
+static bool
+BeginReplay (UndoListType *ptr, int step, size_t avail)
+{
+  size_t n;
+
+  for (n = 0; n < avail && n < UNDO_BATCH_MIN; n++, ptr += step)
+    if (ptr->Serial != Serial)
+      break;
+  if (n < UNDO_BATCH_MIN)
+    return false;
+
+  SuspendDraw ();
+  DeferPolygonClipping ();
+  return true;
+}
+
+/*!
+ * \brief Finish a batch started by BeginReplay(): re-clip each affected
+ * polygon once and let the final Draw() invalidate the combined area.
+ */
+static void
+EndReplay (bool batch)
+{
+  int reclipped;
+
+  if (!batch)
+    return;
+
+  reclipped = FlushPolygonClipping ();
+  PERF_COUNT (PERF_UNDO_RECLIPS, reclipped);
+  ResumeDraw ();
+}
+
 static int
 PerformUndo (UndoListType *ptr)
 {
+  /* the objects are found by ID here, the autorouter can't follow */
+  AutoRouteForget ();
   switch (ptr->Type)
     {
     case UNDO_CHANGENAME:
@@ -1111,9 +1390,16 @@ Redo (bool draw)
   UndoListType *ptr;
   int Types = 0;
   bool error_undoing = false;
+  bool batch;
 
   andDraw = draw;
 
+  if (Batched && RedoN <= BatchRedoN && RedoN > 0)
+    {
+      Message (_("Redo is not available inside a batch\n"));
+      return 0;
+    }
+
   if (RedoN == 0)
     {
       Message (_("Nothing to redo. Perhaps changes have been made since last undo\n"));
@@ -1140,6 +1426,7 @@ Redo (bool draw)
     }
 
   LockUndo (); /* lock undo module to prevent from loops */
+  batch = BeginReplay (ptr, 1, RedoN);
 
   /* and loop over all entries with the correct serial number */
   for (; RedoN && ptr->Serial == Serial; ptr++, UndoN++, RedoN--)
@@ -1150,6 +1437,8 @@ Redo (bool draw)
       Types |= undid;
     }
 
+  EndReplay (batch);
+
   /* Make next serial number current */
   Serial++;
 
@@ -1205,6 +1494,7 @@ IncrementUndoSerialNumber (void)
       Serial++;
       Bumped = true;
       between_increment_and_restore = true;
+      EnforceUndoBudget ();
     }
 }
 
@@ -1224,6 +1514,9 @@ ClearUndoList (bool Force)
 	{
 	  if (undo->Type == UNDO_CHANGENAME)
 	    free (undo->Data.ChangeName.Name);
+	  else if (undo->Type == UNDO_REMOVE_CONTOUR
+		   || undo->Type == UNDO_INSERT_CONTOUR)
+	    free (undo->Data.Contour.Points);
 	}
       free (UndoList);
       UndoList = NULL;
@@ -1236,10 +1529,15 @@ ClearUndoList (bool Force)
 
       /* reset some counters */
       UndoN = UndoMax = RedoN = 0;
+      UndoBytes = 0;
     }
 
   /* reset counter in any case */
   Serial = 1;
+  BatchSerial = Serial;
+  BatchUndoN = UndoN;
+  BatchRedoN = RedoN;
+  AutoRouteForget ();
 }
 
 /* ---------------------------------------------------------------------------
@@ -1268,6 +1566,7 @@ AddObjectToMirrorUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_MIRROR, OBJECT_ID (Ptr3), Type);
@@ -1285,6 +1584,7 @@ AddObjectToRotateUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_ROTATE, OBJECT_ID (Ptr3), Type);
@@ -1301,13 +1601,17 @@ AddObjectToRotateUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 void
 MoveObjectToRemoveUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
+  UndoListType *undo;
+
   if (Locked)
     return;
 
   if (!RemoveList)
     RemoveList = CreateNewBuffer ();
 
-  GetUndoSlot (UNDO_REMOVE, OBJECT_ID (Ptr3), Type);
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, true);
+  undo = GetUndoSlot (UNDO_REMOVE, OBJECT_ID (Ptr3), Type);
+  SetEntryBytes (undo, ObjectBytes (Type, Ptr2));
   MoveObjectToBuffer (RemoveList, PCB->Data, Type, Ptr1, Ptr2, Ptr3);
 }
 
@@ -1323,6 +1627,7 @@ AddObjectToRemovePointUndoList (int Type,
   Cardinal hole;
   bool last_in_contour = false;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       switch (Type)
@@ -1362,47 +1667,49 @@ AddObjectToRemovePointUndoList (int Type,
 void
 AddObjectToInsertPointUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     GetUndoSlot (UNDO_INSERT_POINT, OBJECT_ID (Ptr3), Type);
 }
 
-static void
-CopyObjectToUndoList (int undo_type, int Type, void *Ptr1, void *Ptr2, void *Ptr3)
+/* ---------------------------------------------------------------------------
+ * adds a contour which is about to be removed from a polygon to the
+ * undo list; only the points of that contour are kept
+ */
+void
+AddObjectToRemoveContourUndoList (int Type, LayerType *Layer,
+				  PolygonType *Polygon, Cardinal contour)
 {
   UndoListType *undo;
-  AnyObjectType *copy;
 
+  AutoRouteObjectChanged (POLYGON_TYPE, Layer, Polygon, false);
   if (Locked)
     return;
 
-  if (!RemoveList)
-    RemoveList = CreateNewBuffer ();
-
-  undo = GetUndoSlot (undo_type, OBJECT_ID (Ptr2), Type);
-  copy = (AnyObjectType *)CopyObjectToBuffer (RemoveList, PCB->Data, Type, Ptr1, Ptr2, Ptr3);
-  undo->Data.CopyID = copy->ID;
+  undo = GetUndoSlot (UNDO_REMOVE_CONTOUR, OBJECT_ID (Polygon), Type);
+  undo->Data.Contour.Index = contour;
+  CutContour (Polygon, &undo->Data.Contour, false);
+  SetEntryBytes (undo, undo->Data.Contour.PointN * sizeof (PointType));
 }
 
 /* ---------------------------------------------------------------------------
- * adds an object to the list of removed contours
- * (Actually just takes a copy of the whole polygon to restore)
+ * adds a contour which has just been inserted into a polygon to the
+ * undo list
  */
 void
-AddObjectToRemoveContourUndoList (int Type,
-				  LayerType *Layer, PolygonType *Polygon)
+AddObjectToInsertContourUndoList (int Type, LayerType *Layer,
+				  PolygonType *Polygon, Cardinal contour)
 {
-  CopyObjectToUndoList (UNDO_REMOVE_CONTOUR, Type, Layer, Polygon, NULL);
-}
+  UndoListType *undo;
 
-/* ---------------------------------------------------------------------------
- * adds an object to the list of insert contours
- * (Actually just takes a copy of the whole polygon to restore)
- */
-void
-AddObjectToInsertContourUndoList (int Type,
-				  LayerType *Layer, PolygonType *Polygon)
-{
-  CopyObjectToUndoList (UNDO_INSERT_CONTOUR, Type, Layer, Polygon, NULL);
+  AutoRouteObjectChanged (POLYGON_TYPE, Layer, Polygon, false);
+  if (Locked)
+    return;
+
+  undo = GetUndoSlot (UNDO_INSERT_CONTOUR, OBJECT_ID (Polygon), Type);
+  undo->Data.Contour.Index = contour;
+  undo->Data.Contour.PointN = 0;
+  undo->Data.Contour.Points = NULL;
 }
 
 /* ---------------------------------------------------------------------------
@@ -1414,6 +1721,7 @@ AddObjectToMoveUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_MOVE, OBJECT_ID (Ptr3), Type);
@@ -1431,6 +1739,7 @@ AddObjectToChangeNameUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_CHANGENAME, OBJECT_ID (Ptr3), Type);
@@ -1446,6 +1755,7 @@ AddObjectToMoveToLayerUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_MOVETOLAYER, OBJECT_ID (Ptr3), Type);
@@ -1460,6 +1770,7 @@ AddObjectToMoveToLayerUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 void
 AddObjectToCreateUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     GetUndoSlot (UNDO_CREATE, OBJECT_ID (Ptr3), Type);
   ClearFromPolygon (PCB->Data, Type, Ptr1, Ptr2);
@@ -1473,6 +1784,7 @@ AddObjectToFlagUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_FLAG, OBJECT_ID (Ptr2), Type);
@@ -1488,6 +1800,7 @@ AddObjectToSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, ptr1, ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_CHANGESIZE, OBJECT_ID (ptr2), Type);
@@ -1578,6 +1891,7 @@ AddObjectTo2ndSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 {
   UndoListType *undo;
 
+  AutoRouteObjectChanged (Type, ptr1, ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_CHANGE2NDSIZE, OBJECT_ID (ptr2), Type);
@@ -1596,6 +1910,7 @@ AddObjectToChangeAnglesUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
   UndoListType *undo;
   ArcType *a = (ArcType *) Ptr3;
 
+  AutoRouteObjectChanged (Type, Ptr1, Ptr2, false);
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_CHANGEANGLES, OBJECT_ID (Ptr3), Type);
@@ -1612,6 +1927,8 @@ AddLayerChangeToUndoList (int old_index, int new_index)
 {
   UndoListType *undo;
 
+  /* layer numbers shift, which the autorouter can't follow */
+  AutoRouteForget ();
   if (!Locked)
     {
       undo = GetUndoSlot (UNDO_LAYERCHANGE, 0, 0);
@@ -1730,6 +2047,51 @@ UnlockUndo (void)
   Locked = false;
 }
 
+/* ---------------------------------------------------------------------------
+ * starts collecting all following operations into a single undo step.
+ * Inside the batch serial numbers still advance, so code that bumps the
+ * serial and undoes its own temporary changes (DRC, connection reports)
+ * only rolls back those; Undo() refuses to reach past the start of the
+ * batch.  Calls may be nested.
+ */
+void
+BeginUndoBatch (void)
+{
+  if (Batched++ > 0)
+    return;
+  BatchSerial = Serial;
+  BatchUndoN = UndoN;
+  BatchRedoN = RedoN;
+}
+
+/* ---------------------------------------------------------------------------
+ * closes a batch; the outermost call renumbers everything the batch
+ * added to the serial it began at and bumps the serial number once,
+ * so the whole batch is a single undo step.  Steps the batch undid
+ * itself can't be redone afterwards.
+ */
+void
+EndUndoBatch (void)
+{
+  size_t n;
+
+  if (Batched == 0 || --Batched > 0)
+    return;
+
+  if (RedoN > BatchRedoN)
+    {
+      for (n = UndoN; n < UndoN + RedoN; n++)
+	ReleaseUndoEntry (&UndoList[n]);
+      RedoN = 0;
+    }
+  for (n = BatchUndoN; n < UndoN; n++)
+    UndoList[n].Serial = BatchSerial;
+  Serial = BatchSerial;
+
+  if (UndoN > 0 && UndoList[UndoN - 1].Serial == Serial)
+    IncrementUndoSerialNumber ();
+}
+
 /* ---------------------------------------------------------------------------
  * return undo lock state
  */
@@ -47,8 +47,10 @@ void ClearUndoList (bool);
 void MoveObjectToRemoveUndoList (int, void *, void *, void *);
 void AddObjectToRemovePointUndoList (int, void *, void *, Cardinal);
 void AddObjectToInsertPointUndoList (int, void *, void *, void *);
-void AddObjectToRemoveContourUndoList (int, LayerType *, PolygonType *);
-void AddObjectToInsertContourUndoList (int, LayerType *, PolygonType *);
+void AddObjectToRemoveContourUndoList (int, LayerType *, PolygonType *,
+				       Cardinal);
+void AddObjectToInsertContourUndoList (int, LayerType *, PolygonType *,
+				       Cardinal);
 void AddObjectToMoveUndoList (int, void *, void *, void *,
 			      Coord, Coord);
 void AddObjectToChangeNameUndoList (int, void *, void *, void *, char *);
@@ -69,5 +71,8 @@ void AddNetlistLibToUndoList (LibraryType *);
 void LockUndo (void);
 void UnlockUndo (void);
 bool Undoing (void);
+void BeginUndoBatch (void);
+void EndUndoBatch (void);
+void GetUndoUsage (size_t *, size_t *, size_t *);
 
 #endif
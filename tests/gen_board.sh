@@ -0,0 +1,296 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+#
+# Writes a synthetic .pcb layout of configurable size to stdout.  Used by
+# run_bench.sh to produce boards large enough to show scaling problems.
+
+usage() {
+cat <<EOF
+
+$0 -- Generate a synthetic pcb layout for benchmarking
+
+$0 -h|--help
+$0 [-e elements] [-l layers] [-p pours] [-n netsize] [-s seed]
+
+OPTIONS
+
+-e | --elements <n>    :  Number of elements to place (default 100).
+                          Even elements are 8 pin through-hole DIPs,
+                          odd ones 8 pad SMD SOs on the top side.
+
+-l | --layers <n>      :  Number of copper layers, 2 to 8 (default 4).
+
+-p | --pours <n>       :  Number of copper layers carrying a full board
+                          ground pour (default: one per inner layer, or
+                          one on the bottom of a two layer board).  The
+                          ground pins have thermals to every pour.
+
+-n | --netsize <n>     :  Pins per signal net (default 4).  Every
+                          element also contributes one pin to GND and
+                          one to VCC.
+
+-s | --seed <n>        :  Random seed (default 1).  The same options
+                          always produce the same board.
+
+The board is written to stdout.  The first ground pour starts at the
+origin so that Connection(Find) in the batch HID, which looks at (0,0),
+floods the whole ground net.
+
+EOF
+}
+
+elements=100
+layers=4
+pours=
+netsize=4
+seed=1
+
+while test -n "$1"
+  do
+  case "$1"
+      in
+
+      -e|--elements)
+	  elements="$2"
+	  shift 2
+	  ;;
+
+      -l|--layers)
+	  layers="$2"
+	  shift 2
+	  ;;
+
+      -p|--pours)
+	  pours="$2"
+	  shift 2
+	  ;;
+
+      -n|--netsize)
+	  netsize="$2"
+	  shift 2
+	  ;;
+
+      -s|--seed)
+	  seed="$2"
+	  shift 2
+	  ;;
+
+      -h|--help)
+	  usage
+	  exit 0
+	  ;;
+
+      *)
+	  echo "unknown option: $1" 1>&2
+	  exit 1
+	  ;;
+
+  esac
+done
+
+if test $layers -lt 2 || test $layers -gt 8 ; then
+    echo "$0:  the number of copper layers must be between 2 and 8" 1>&2
+    exit 1
+fi
+
+if test -z "$pours" ; then
+    if test $layers -gt 2 ; then
+	pours=`expr $layers - 2`
+    else
+	pours=1
+    fi
+fi
+
+AWK=${AWK:-awk}
+
+${AWK} -v elements=$elements -v layers=$layers -v pours=$pours \
+    -v netsize=$netsize -v seed=$seed '
+
+# All coordinates are in mils.
+BEGIN {
+    srand (seed);
+
+    pitch = 500;
+    cols = int (sqrt (elements));
+    if (cols * cols < elements)
+	cols++;
+    rows = int ((elements + cols - 1) / cols);
+    width = cols * pitch + pitch;
+    height = rows * pitch + pitch;
+
+    # Pours go on the inner layers first, then on the bottom and top.
+    # Layer numbers are 1 based as in the file format.
+    npour = 0;
+    for (l = 2; l < layers && npour < pours; l++)
+	pour[++npour] = l;
+    if (npour < pours)
+	pour[++npour] = layers;
+    if (npour < pours)
+	pour[++npour] = 1;
+
+    therm = "";
+    for (i = 1; i <= npour; i++)
+	therm = therm (i > 1 ? "," : "") (pour[i] - 1);
+
+    header();
+    for (e = 0; e < elements; e++)
+	element(e);
+    for (l = 1; l <= layers; l++)
+	layer(l);
+    printf ("Layer(%d \"silk\" \"silk\")\n(\n)\n", layers + 1);
+    printf ("Layer(%d \"silk\" \"silk\")\n(\n)\n", layers + 2);
+    netlist();
+}
+
+function header(    groups, l) {
+    groups = "1,c";
+    for (l = 2; l < layers; l++)
+	groups = groups ":" l;
+    groups = groups ":" layers ",s";
+
+    printf ("# release: pcb benchmark generator\n\n");
+    printf ("FileVersion[20091103]\n\n");
+    printf ("PCB[\"benchmark %d elements %d layers\" %dmil %dmil]\n\n",
+	    elements, layers, width, height);
+    printf ("Grid[25.00mil 0.0000 0.0000 0]\n");
+    printf ("PolyArea[3100.006200]\n");
+    printf ("Thermal[0.500000]\n");
+    printf ("DRC[10.00mil 10.00mil 10.00mil 7.00mil 15.00mil 10.00mil]\n");
+    printf ("Flags(\"nameonpcb,clearnew,snappin\")\n");
+    printf ("Groups(\"%s\")\n", groups);
+    printf ("Styles[\"Signal,10.00mil,36.00mil,20.00mil,10.00mil:");
+    printf ("Power,25.00mil,60.00mil,35.00mil,10.00mil:");
+    printf ("Fat,40.00mil,60.00mil,35.00mil,10.00mil:");
+    printf ("Skinny,6.00mil,24.02mil,11.81mil,6.00mil\"]\n\n");
+}
+
+# Pin 4 of every element goes to GND, pin 8 to VCC, the rest to signal
+# nets.  Pins are recorded in order so that nets can be formed from
+# neighbouring elements.
+function element(e,    x, y, i, name, flags) {
+    x = pitch + (e % cols) * pitch;
+    y = pitch + int (e / cols) * pitch;
+    name = "U" (e + 1);
+
+    if (e % 2 == 0)
+      {
+	printf ("Element[\"\" \"Dual in-line package, narrow (300 mil)\" ");
+	printf ("\"%s\" \"DIP8\" %dmil %dmil 50.00mil -50.00mil 0 100 \"\"]\n(\n",
+		name, x, y);
+	for (i = 1; i <= 8; i++)
+	  {
+	    flags = (i == 1) ? "square" : "";
+	    if (i == 4)
+	      flags = "thermal(" therm ")";
+	    if (i <= 4)
+		printf ("\tPin[0.0000 %dmil 60.00mil 30.00mil 66.00mil 28.00mil \"%d\" \"%d\" \"%s\"]\n",
+			(i - 1) * 100, i, i, flags);
+	    else
+		printf ("\tPin[300.00mil %dmil 60.00mil 30.00mil 66.00mil 28.00mil \"%d\" \"%d\" \"%s\"]\n",
+			(8 - i) * 100, i, i, flags);
+	  }
+	printf ("\tElementLine [-50.00mil -50.00mil 350.00mil -50.00mil 10.00mil]\n");
+	printf ("\tElementLine [350.00mil -50.00mil 350.00mil 350.00mil 10.00mil]\n");
+	printf ("\tElementLine [350.00mil 350.00mil -50.00mil 350.00mil 10.00mil]\n");
+	printf ("\tElementLine [-50.00mil 350.00mil -50.00mil -50.00mil 10.00mil]\n");
+	printf (")\n\n");
+      }
+    else
+      {
+	printf ("Element[\"\" \"Small outline package, narrow (150mil)\" ");
+	printf ("\"%s\" \"SO8\" %dmil %dmil 0.0000 -60.00mil 0 100 \"\"]\n(\n",
+		name, x + 150, y + 150);
+	for (i = 1; i <= 8; i++)
+	  {
+	    if (i <= 4)
+		printf ("\tPad[-135.00mil %dmil -70.00mil %dmil 20.00mil 10.00mil 30.00mil \"%d\" \"%d\" \"square\"]\n",
+			(i - 1) * 50 - 75, (i - 1) * 50 - 75, i, i);
+	    else
+		printf ("\tPad[70.00mil %dmil 135.00mil %dmil 20.00mil 10.00mil 30.00mil \"%d\" \"%d\" \"square,edge2\"]\n",
+			(8 - i) * 50 - 75, (8 - i) * 50 - 75, i, i);
+	  }
+	printf ("\tElementLine [-155.00mil -95.00mil 155.00mil -95.00mil 10.00mil]\n");
+	printf ("\tElementLine [-155.00mil 95.00mil 155.00mil 95.00mil 10.00mil]\n");
+	printf (")\n\n");
+      }
+
+    for (i = 1; i <= 8; i++)
+      {
+	if (i == 4)
+	    gnd[++ngnd] = name "-" i;
+	else if (i == 8)
+	    vcc[++nvcc] = name "-" i;
+	else
+	    sig[++nsig] = name "-" i;
+      }
+}
+
+function layer(l,    name, i, is_pour) {
+    if (l == 1)
+	name = "top";
+    else if (l == layers)
+	name = "bottom";
+    else
+	name = "inner" (l - 1);
+
+    printf ("Layer(%d \"%s\" \"copper\")\n(\n", l, name);
+    is_pour = 0;
+    for (i = 1; i <= npour; i++)
+	if (pour[i] == l)
+	    is_pour = 1;
+    if (is_pour)
+      {
+	printf ("\tPolygon(\"clearpoly\")\n\t(\n");
+	printf ("\t\t[0.0000 0.0000] [%dmil 0.0000] [%dmil %dmil] [0.0000 %dmil]\n",
+		width, width, height, height);
+	printf ("\t)\n");
+      }
+    printf (")\n");
+}
+
+# Signal nets take consecutive runs of netsize pins from a list that is
+# only shuffled locally, so most nets stay within a few elements of each
+# other the way a real design does.
+function netlist(    i, j, k, t, window, n) {
+    window = 8 * cols;
+    for (i = 1; i < nsig; i++)
+      {
+	j = i + int (rand () * window);
+	if (j > nsig)
+	    j = nsig;
+	t = sig[i]; sig[i] = sig[j]; sig[j] = t;
+      }
+
+    printf ("NetList()\n(\n");
+    printf ("\tNet(\"GND\" \"Power\")\n\t(\n");
+    for (i = 1; i <= ngnd; i++)
+	printf ("\t\tConnect(\"%s\")\n", gnd[i]);
+    printf ("\t)\n");
+    printf ("\tNet(\"VCC\" \"Power\")\n\t(\n");
+    for (i = 1; i <= nvcc; i++)
+	printf ("\t\tConnect(\"%s\")\n", vcc[i]);
+    printf ("\t)\n");
+
+    n = 0;
+    for (i = 1; i + 1 <= nsig; i += netsize)
+      {
+	printf ("\tNet(\"N%d\" \"Signal\")\n\t(\n", ++n);
+	for (k = i; k < i + netsize && k <= nsig; k++)
+	    printf ("\t\tConnect(\"%s\")\n", sig[k]);
+	printf ("\t)\n");
+      }
+    printf (")\n");
+}
+'
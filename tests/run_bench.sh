@@ -0,0 +1,206 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+
+usage() {
+cat <<EOF
+
+$0 -- Run the pcb whole-board benchmarks
+
+$0 -h|--help
+$0 [-d | --debug] [-e | --elements "n1 n2 ..."] [-l | --layers n]
+   [-p | --pours n] [-n | --netsize n] [-s | --seed n]
+   [-S | --stages "stage1 stage2 ..."] [-o | --output file.csv]
+
+OVERVIEW
+
+For every requested board size a synthetic layout is written with
+gen_board.sh and loaded into pcb running the batch HID.  A fixed
+sequence of actions is then executed on it and the wall time and peak
+resident set size after each stage are appended to a CSV file.
+
+The batch HID must be the configured GUI (configure --with-gui=batch).
+
+OPTIONS
+
+-d | --debug           :  Keep the pcb log and print the action script.
+
+-e | --elements <list> :  Board sizes in elements (default "100 1000").
+
+-l | --layers <n>      :  Copper layers per board (default 4).
+
+-p | --pours <n>       :  Ground pours per board (default: see gen_board.sh).
+
+-n | --netsize <n>     :  Pins per signal net (default 4).
+
+-s | --seed <n>        :  Random seed for the generator (default 1).
+
+-S | --stages <list>   :  Stages to run, in this order (default all):
+                          load find drc rats autoroute gerber png save
+                          The load stage is always run.
+
+-o | --output <file>   :  CSV file to append results to (default
+                          bench/bench.csv).  The header is written
+                          when the file does not exist yet.
+
+EOF
+}
+
+do_debug=no
+sizes="100 1000"
+layers=4
+pours=
+netsize=4
+seed=1
+stages="load find drc rats autoroute gerber png save"
+csv=
+
+while test -n "$1"
+  do
+  case "$1"
+      in
+
+      -d|--debug)
+	  do_debug=yes
+	  shift
+	  ;;
+
+      -h|--help)
+	  usage
+	  exit 0
+	  ;;
+
+      -e|--elements)
+	  sizes="$2"
+	  shift 2
+	  ;;
+
+      -l|--layers)
+	  layers="$2"
+	  shift 2
+	  ;;
+
+      -p|--pours)
+	  pours="$2"
+	  shift 2
+	  ;;
+
+      -n|--netsize)
+	  netsize="$2"
+	  shift 2
+	  ;;
+
+      -s|--seed)
+	  seed="$2"
+	  shift 2
+	  ;;
+
+      -S|--stages)
+	  stages="$2"
+	  shift 2
+	  ;;
+
+      -o|--output)
+	  csv="$2"
+	  shift 2
+	  ;;
+
+      *)
+	  echo "unknown option: $1"
+	  exit 1
+	  ;;
+
+  esac
+done
+
+# Source directory
+srcdir=${srcdir:-.}
+
+# The pcb wrapper script, run from the build tests directory
+PCB=${PCB:-../src/pcbtest.sh}
+
+AWK=${AWK:-awk}
+
+BENCHDIR=${BENCHDIR:-bench}
+csv=${csv:-${BENCHDIR}/bench.csv}
+
+mkdir -p ${BENCHDIR}
+
+if test ! -f "${csv}" ; then
+    echo "board,elements,layers,netsize,stage,seconds,elapsed,peak_rss_kb" > "${csv}"
+fi
+
+pour_args=
+if test -n "$pours" ; then
+    pour_args="-p $pours"
+fi
+
+for elements in $sizes ; do
+    board="${BENCHDIR}/bench-${elements}e-${layers}l"
+    echo "Benchmarking ${board}.pcb"
+
+    ${srcdir}/gen_board.sh -e $elements -l $layers $pour_args \
+	-n $netsize -s $seed > ${board}.pcb || exit 1
+
+    script=${board}.actions
+    echo "Benchmark(start)" > $script
+    echo "LoadFrom(Layout, ${board}.pcb)" >> $script
+    echo "Benchmark(load)" >> $script
+    for stage in $stages ; do
+	case $stage in
+	    load)
+		continue
+		;;
+	    find)
+		echo "Connection(Find)" >> $script
+		;;
+	    drc)
+		echo "DRC()" >> $script
+		;;
+	    rats)
+		echo "AddRats(AllRats)" >> $script
+		;;
+	    autoroute)
+		echo "AutoRoute(AllRats)" >> $script
+		;;
+	    gerber|png)
+		echo "ExportLayout($stage)" >> $script
+		;;
+	    save)
+		echo "SaveTo(LayoutAs, ${board}-saved.pcb)" >> $script
+		;;
+	    *)
+		echo "unknown stage: $stage"
+		exit 1
+		;;
+	esac
+	echo "Benchmark($stage)" >> $script
+    done
+
+    if test $do_debug = yes ; then
+	cat $script
+    fi
+
+    ${PCB} < $script 2> ${board}.log | \
+	${AWK} -v board=`basename $board` -v elements=$elements \
+	    -v layers=$layers -v netsize=$netsize '
+	/^benchmark: / && $2 != "start" {
+	    printf ("%s,%d,%d,%d,%s,%s,%s,%s\n", board, elements, layers,
+		    netsize, $2, $3, $4, $5);
+	}' | tee -a "${csv}"
+
+    if test $do_debug = no ; then
+	rm -f ${board}.log
+    fi
+done
@@ -172,6 +172,9 @@ top_srcdir=${top_srcdir:-.}
 # so we need to look 3 levels up and then down to src
 PCB=${PCB:-../../../src/pcbtest.sh}
 
+# the client for the server tests, also run from the test directory
+SOCKCLIENT=${SOCKCLIENT:-../../sockclient}
+
 # The gerbv executible 
 GERBV=${GERBV:-gerbv}
 GERBV_DEFAULT_FLAGS=${GERBV_DEFAULT_FLAGS:---export=png --window=640x480}
@@ -532,6 +535,19 @@ compare_pcb() {
     run_diff "$f1" "$f2" || test_failed=yes
 }
 
+##########################################################################
+#
+# compare server replies
+#
+
+compare_reply() {
+    local f1="$1"
+    local f2="$2"
+    compare_check "compare_reply" "$f1" "$f2" || return 1
+
+    run_diff "$f1" "$f2" || test_failed=yes
+}
+
 ##########################################################################
 #
 # The main program loop
@@ -585,9 +601,26 @@ for t in $all_tests ; do
 	pcb_flags="--fab-author Fab_Author ${pcb_flags}"
     fi
 
-    if test "X${hid}" = "Xaction" ; then
+    answers_file=""
+    if test "X${hid}" = "Xserver" ; then
 	script_file=${files%.pcb}.script
-	pcb_flags="--action-script ../../${INDIR}/${script_file}"
+	reply_file=${files%.pcb}.replies
+	pcb_flags="--server-socket pcb.sock ${args}"
+	case " ${HIDLIST:-batch} " in
+	    *\ batch\ *)
+		;;
+	    *)
+		echo "${t} needs pcb configured with --with-gui=batch.  Skipping test"
+		skip=`expr $skip + 1`
+		continue
+		;;
+	esac
+    elif test "X${hid}" = "Xaction" ; then
+	script_file=${files%.pcb}.script
+	pcb_flags="--action-script ../../${INDIR}/${script_file} ${args}"
+	if test -f ${INDIR}/${files%.pcb}.answers ; then
+	    answers_file=../../${INDIR}/${files%.pcb}.answers
+	fi
     else
 	# hidden here, still in effect for all HID tests
 	pcb_flags="-x ${hid} ${pcb_flags}"
@@ -637,8 +670,35 @@ for t in $all_tests ; do
     # run PCB
     #
 
-    echo "(cd ${rundir} && ${PCB} ${pcb_flags} ${files})"
-    (cd ${rundir} && ${PCB} ${pcb_flags} ${files})
+    if test "X${hid}" = "Xserver" ; then
+	echo "(cd ${rundir} && exec ${PCB} ${pcb_flags} ${files}) &"
+	(cd ${rundir} && exec ${PCB} ${pcb_flags} ${files}) &
+	pcb_pid=$!
+	echo "(cd ${rundir} && ${SOCKCLIENT} pcb.sock < ../../${INDIR}/${script_file} > ${reply_file})"
+	(cd ${rundir} && ${SOCKCLIENT} pcb.sock < ../../${INDIR}/${script_file} > ${reply_file})
+	client_rc=$?
+	# the script ends with StopServer(), unless the client gave up
+	if test $client_rc -ne 0 ; then
+	    kill $pcb_pid 2>/dev/null
+	fi
+	wait $pcb_pid
+	pcb_rc=$?
+	if test $client_rc -eq 77 ; then
+	    echo "${SOCKCLIENT} can't run on this platform.  Skipping test"
+	    skip=`expr $skip + 1`
+	    continue
+	elif test $client_rc -ne 0 ; then
+	    echo "${SOCKCLIENT} returned ${client_rc}.  This is a failure."
+	    fail=`expr $fail + 1`
+	    continue
+	fi
+    elif test "X${answers_file}" != "X" ; then
+	echo "(cd ${rundir} && ${PCB} ${pcb_flags} ${files} < ${answers_file})"
+	(cd ${rundir} && ${PCB} ${pcb_flags} ${files} < ${answers_file})
+    else
+	echo "(cd ${rundir} && ${PCB} ${pcb_flags} ${files})"
+	(cd ${rundir} && ${PCB} ${pcb_flags} ${files})
+    fi
     pcb_rc=$?
 
     if test $pcb_rc -ne 0 ; then
@@ -711,6 +771,11 @@ for t in $all_tests ; do
 		    compare_pcb ${refdir}/${fn} ${rundir}/${fn}
 		    ;;
 
+		# server replies
+		reply)
+		    compare_reply ${refdir}/${fn} ${rundir}/${fn}
+		    ;;
+
 		# unknown
 		*)
 		    echo "internal error:  $type is not a known file type"
@@ -720,7 +785,7 @@ for t in $all_tests ; do
 
 	done
 
-	if test "X${hid}" != "Xaction" ; then
+	if test "X${hid}" != "Xaction" && test "X${hid}" != "Xserver" ; then
 	    # clean up the input files we'd copied over
 	    for f in $files ; do
 		rm -f ${rundir}/${f}
@@ -0,0 +1,132 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+ */
+
+/* Client for the testsuite's server tests.  Sends the lines read from
+   stdin to the batch GUI's --server-socket one at a time, and copies
+   each reply, up to and including its "pcb-status:" line, to stdout.
+
+   Usage:  sockclient SOCKET < requests > replies
+
+   Exits with 77 when the platform has no UNIX domain sockets, so the
+   test can be skipped.  */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_SYS_UN_H)
+#include <sys/socket.h>
+#include <sys/un.h>
+#define HAVE_SOCKETS
+#endif
+
+#ifdef HAVE_SOCKETS
+
+/* the server may still be loading the layout, give it 10 seconds */
+#define CONNECT_TRIES 100
+
+static int
+connect_server (const char *path)
+{
+  struct sockaddr_un addr;
+  int sock, i;
+
+  if (strlen (path) >= sizeof (addr.sun_path))
+    {
+      fprintf (stderr, "sockclient: socket path %s is too long\n", path);
+      return -1;
+    }
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  for (i = 0; i < CONNECT_TRIES; i++)
+    {
+      sock = socket (AF_UNIX, SOCK_STREAM, 0);
+      if (sock < 0)
+	break;
+      if (connect (sock, (struct sockaddr *) &addr, sizeof (addr)) == 0)
+	return sock;
+      close (sock);
+      usleep (100000);
+    }
+  fprintf (stderr, "sockclient: cannot connect to %s: %s\n", path,
+	   strerror (errno));
+  return -1;
+}
+
+int
+main (int argc, char **argv)
+{
+  char line[1000];
+  FILE *reply;
+  int sock;
+
+  if (argc != 2)
+    {
+      fprintf (stderr, "Usage:  %s SOCKET < requests > replies\n", argv[0]);
+      return 1;
+    }
+
+  if ((sock = connect_server (argv[1])) < 0)
+    return 1;
+  if ((reply = fdopen (dup (sock), "r")) == NULL)
+    return 1;
+
+  while (fgets (line, sizeof (line), stdin) != NULL)
+    {
+      if (write (sock, line, strlen (line)) < 0)
+	{
+	  perror ("sockclient: write");
+	  return 1;
+	}
+      /* the reply ends with the status of the line */
+      do
+	{
+	  if (fgets (line, sizeof (line), reply) == NULL)
+	    {
+	      fprintf (stderr, "sockclient: the server hung up\n");
+	      return 1;
+	    }
+	  fputs (line, stdout);
+	}
+      while (strncmp (line, "pcb-status: ", 12) != 0);
+    }
+
+  fclose (reply);
+  close (sock);
+  return 0;
+}
+
+#else
+
+int
+main (int argc, char **argv)
+{
+  fprintf (stderr, "sockclient: no UNIX domain sockets on this platform\n");
+  return 77;
+}
+
+#endif